@@ -1,22 +1,81 @@
-QT += charts printsupport
+QT += charts printsupport concurrent network svg
 
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 HEADERS += \
+    ipcaxismapping.h \
+    ipcfft.h \
+    ipcimagestreamwriter.h \
     ipcmarker.h \
     ipcmarkertable.h \
+    ipcmemorybudget.h \
+    ipcquantilesketch.h \
     ipcrange.h \
-    ipcscope.h
+    ipcrefreshscheduler.h \
+    ipcreportbuilder.h \
+    ipcrollbuffer.h \
+    ipcsampleconverter.h \
+    ipcscope.h \
+    ipcscopelinkgroup.h \
+    ipcscopemodel.h \
+    ipcscopepool.h \
+    ipcscopeserver.h \
+    ipcsharedtracering.h \
+    ipcspatialindex.h \
+    ipcspectrum.h \
+    ipcstatistics.h \
+    ipcstatisticstable.h \
+    ipctracebuffer.h \
+    ipctracehistory.h \
+    ipctracer.h \
+    ipctrigger.h \
+    ipcunittransform.h \
+    ipcviewportculler.h \
+    ipcwelchestimator.h
 
 SOURCES += \
+        ipcfft.cpp \
+        ipcimagestreamwriter.cpp \
         ipcmarker.cpp \
         ipcmarkertable.cpp \
+        ipcmemorybudget.cpp \
+        ipcquantilesketch.cpp \
         ipcrange.cpp \
+        ipcrefreshscheduler.cpp \
+        ipcreportbuilder.cpp \
+        ipcrollbuffer.cpp \
+        ipcsampleconverter.cpp \
         ipcscope.cpp \
+        ipcscopelinkgroup.cpp \
+        ipcscopemodel.cpp \
+        ipcscopepool.cpp \
+        ipcscopeserver.cpp \
+        ipcsharedtracering.cpp \
+        ipcspatialindex.cpp \
+        ipcspectrum.cpp \
+        ipcstatistics.cpp \
+        ipcstatisticstable.cpp \
+        ipctracebuffer.cpp \
+        ipctracehistory.cpp \
+        ipctracer.cpp \
+        ipctrigger.cpp \
+        ipcunittransform.cpp \
+        ipcviewportculler.cpp \
+        ipcwelchestimator.cpp \
         main.cpp
 
+# POSIX shared memory (shm_open) lives in librt on older glibc
+unix:!macx: LIBS += -lrt
+
+# zlib compresses the streamed png and tiff exports (stored deflate blocks and PackBits without it)
+unix: DEFINES += IPC_HAVE_ZLIB
+unix: LIBS += -lz
+
+# Tracing spans (see IPCTracer), off until IPCTracer::setEnabled(true). Remove to compile them out.
+DEFINES += IPC_TRACING
+
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
@@ -0,0 +1,105 @@
+#ifndef IPCAXISMAPPING_H
+#define IPCAXISMAPPING_H
+
+#include <QtGlobal>
+#include <QPointF>
+#include <QRectF>
+#include <cmath>
+#include <limits>
+
+/*
+ * Axis scales as types. The per point loops mapping graph's coordinates to pixels or pixel columns are templates on the
+ * scale of each axis, instantiated for the four scope types, and the instance is picked once per call: the scale isn't
+ * tested in the inner loops, and the linear instances are branch free and can be vectorized by the compiler.
+ */
+struct IPCLinearScale
+{
+    static const bool isLog = false;
+    static inline double toAxis(double value){return value;}
+    static inline double fromAxis(double value){return value;}
+};
+
+struct IPCLogScale
+{
+    static const bool isLog = true;
+    // Non positive values are at minus infinity
+    static inline double toAxis(double value)
+    {
+        return (value > 0) ? std::log10(value) : -std::numeric_limits<double>::infinity();
+    }
+    static inline double fromAxis(double value){return std::pow(10.0, value);}
+};
+
+/*
+ * Mapping from graph's coordinates to pixels of the plot area. The top of the range is the minimum y value.
+ */
+template <typename XScale, typename YScale>
+class IPCAxisMapping
+{
+public:
+    IPCAxisMapping(const QRectF &plotArea, const QRectF &range) :
+        mLeft(plotArea.left()),
+        mBottom(plotArea.bottom()),
+        mX0(XScale::toAxis(range.left())),
+        mY0(YScale::toAxis(range.top())),
+        mKx(plotArea.width() / (XScale::toAxis(range.right()) - mX0)),
+        mKy(plotArea.height() / (YScale::toAxis(range.bottom()) - mY0))
+    {
+    }
+
+    bool isValid() const {return std::isfinite(mKx) && std::isfinite(mKy) && std::isfinite(mX0) && std::isfinite(mY0);}
+    double pixelX(double x) const {return mLeft + (XScale::toAxis(x) - mX0)*mKx;}
+    double pixelY(double y) const {return mBottom - (YScale::toAxis(y) - mY0)*mKy;}
+    QPointF pixel(const QPointF &point) const {return QPointF(pixelX(point.x()), pixelY(point.y()));}
+    // x value under a pixel column
+    double key(double pixelX) const {return XScale::fromAxis((pixelX - mLeft)/mKx + mX0);}
+
+    // Map count points, pixels may be points
+    void map(const QPointF *points, int count, QPointF *pixels) const
+    {
+        for(int i = 0; i < count; i++){
+            pixels[i] = QPointF(pixelX(points[i].x()), pixelY(points[i].y()));
+        }
+    }
+
+private:
+    double mLeft;
+    double mBottom;
+    double mX0;
+    double mY0;
+    double mKx;
+    double mKy;
+};
+
+/*
+ * Mapping from x values to pixel columns, width columns spanning [xMin, xMax]. Columns are clamped to [-1, width].
+ */
+template <typename XScale>
+class IPCColumnMapping
+{
+public:
+    IPCColumnMapping(double xMin, double xMax, int width) :
+        mOffset(axisValue(xMin)),
+        mScale(width / (axisValue(xMax) - axisValue(xMin))),
+        mWidth(width)
+    {
+    }
+
+    // False when the span is empty
+    bool isValid() const {return mScale > 0 && std::isfinite(mScale);}
+    int column(double x) const
+    {
+        return (int)qBound(-1.0, std::floor((XScale::toAxis(x) - mOffset)*mScale), (double)mWidth);
+    }
+    int width() const {return mWidth;}
+
+private:
+    // Bounds of a log span at or below 0 are taken as 1
+    static double axisValue(double x){return (XScale::isLog && !(x > 0)) ? 0 : XScale::toAxis(x);}
+
+    double mOffset;
+    double mScale;
+    int mWidth;
+};
+
+#endif // IPCAXISMAPPING_H
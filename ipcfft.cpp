@@ -0,0 +1,335 @@
+#include "ipcfft.h"
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QtConcurrent>
+#include <QDebug>
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Cache of the plans, shared by all the instances
+static QMutex planMutex;
+static QHash<int, QSharedPointer<const void> > planCache;
+
+#ifdef __SSE2__
+/*!
+ * \brief cmul. Complex product of two [re, im] pairs.
+ */
+static inline __m128d cmul(__m128d a, __m128d b)
+{
+    __m128d re = _mm_mul_pd(a, _mm_unpacklo_pd(b, b));                                  // [ar.br, ai.br]
+    __m128d im = _mm_mul_pd(_mm_shuffle_pd(a, a, 1), _mm_unpackhi_pd(b, b));            // [ai.bi, ar.bi]
+    return _mm_add_pd(re, _mm_xor_pd(im, _mm_set_pd(0.0, -0.0)));                       // [ar.br - ai.bi, ai.br + ar.bi]
+}
+
+/*!
+ * \brief mulMinusI. Product by -i of a [re, im] pair.
+ */
+static inline __m128d mulMinusI(__m128d a)
+{
+    return _mm_xor_pd(_mm_shuffle_pd(a, a, 1), _mm_set_pd(-0.0, 0.0));                  // [ai, -ar]
+}
+
+/*!
+ * \brief radix4. Radix-4 butterflies j in [jBegin, jEnd) of the block starting at base, combining 4 transforms of size m.
+ */
+static void radix4(std::complex<double> *base, int m, const std::complex<double> *twiddles, int stride, int jBegin, int jEnd)
+{
+    double *p0 = reinterpret_cast<double *>(base);
+    double *p1 = reinterpret_cast<double *>(base + m);
+    double *p2 = reinterpret_cast<double *>(base + 2*m);
+    double *p3 = reinterpret_cast<double *>(base + 3*m);
+    const double *w = reinterpret_cast<const double *>(twiddles);
+    for(int j = jBegin; j < jEnd; j++){
+        __m128d a0 = _mm_loadu_pd(p0 + 2*j);
+        __m128d a1 = cmul(_mm_loadu_pd(p1 + 2*j), _mm_loadu_pd(w + 4*j*stride));
+        __m128d a2 = cmul(_mm_loadu_pd(p2 + 2*j), _mm_loadu_pd(w + 2*j*stride));
+        __m128d a3 = cmul(_mm_loadu_pd(p3 + 2*j), _mm_loadu_pd(w + 6*j*stride));
+        __m128d s01 = _mm_add_pd(a0, a1);
+        __m128d d01 = _mm_sub_pd(a0, a1);
+        __m128d s23 = _mm_add_pd(a2, a3);
+        __m128d d23 = mulMinusI(_mm_sub_pd(a2, a3));
+        _mm_storeu_pd(p0 + 2*j, _mm_add_pd(s01, s23));
+        _mm_storeu_pd(p1 + 2*j, _mm_add_pd(d01, d23));
+        _mm_storeu_pd(p2 + 2*j, _mm_sub_pd(s01, s23));
+        _mm_storeu_pd(p3 + 2*j, _mm_sub_pd(d01, d23));
+    }
+}
+
+/*!
+ * \brief radix2. Radix-2 butterflies of size 2 over count pairs.
+ */
+static void radix2(std::complex<double> *data, int begin, int end)
+{
+    double *p = reinterpret_cast<double *>(data);
+    for(int i = begin; i < end; i += 2){
+        __m128d a = _mm_loadu_pd(p + 2*i);
+        __m128d b = _mm_loadu_pd(p + 2*i + 2);
+        _mm_storeu_pd(p + 2*i, _mm_add_pd(a, b));
+        _mm_storeu_pd(p + 2*i + 2, _mm_sub_pd(a, b));
+    }
+}
+#else
+/*!
+ * \brief cmul. Complex product, written out to avoid the NaN handling of std::complex.
+ */
+static inline std::complex<double> cmul(const std::complex<double> &a, const std::complex<double> &b)
+{
+    return std::complex<double>(a.real()*b.real() - a.imag()*b.imag(), a.imag()*b.real() + a.real()*b.imag());
+}
+
+/*!
+ * \brief radix4. Radix-4 butterflies j in [jBegin, jEnd) of the block starting at base, combining 4 transforms of size m.
+ */
+static void radix4(std::complex<double> *base, int m, const std::complex<double> *twiddles, int stride, int jBegin, int jEnd)
+{
+    std::complex<double> *p0 = base;
+    std::complex<double> *p1 = base + m;
+    std::complex<double> *p2 = base + 2*m;
+    std::complex<double> *p3 = base + 3*m;
+    for(int j = jBegin; j < jEnd; j++){
+        std::complex<double> a0 = p0[j];
+        std::complex<double> a1 = cmul(p1[j], twiddles[2*j*stride]);
+        std::complex<double> a2 = cmul(p2[j], twiddles[j*stride]);
+        std::complex<double> a3 = cmul(p3[j], twiddles[3*j*stride]);
+        std::complex<double> s01 = a0 + a1;
+        std::complex<double> d01 = a0 - a1;
+        std::complex<double> s23 = a2 + a3;
+        std::complex<double> d = a2 - a3;
+        std::complex<double> d23(d.imag(), -d.real());     // -i.(a2 - a3)
+        p0[j] = s01 + s23;
+        p1[j] = d01 + d23;
+        p2[j] = s01 - s23;
+        p3[j] = d01 - d23;
+    }
+}
+
+/*!
+ * \brief radix2. Radix-2 butterflies of size 2 over count pairs.
+ */
+static void radix2(std::complex<double> *data, int begin, int end)
+{
+    for(int i = begin; i < end; i += 2){
+        std::complex<double> a = data[i];
+        std::complex<double> b = data[i+1];
+        data[i] = a + b;
+        data[i+1] = a - b;
+    }
+}
+#endif
+
+/*!
+ * \brief runStages. Run the stages combining transforms of size from firstM (included) up to the block size lastSize,
+ * on the data range [begin, end). firstM is 1 or 2 depending on the radix-2 stage.
+ */
+static void runStages(std::complex<double> *data, int begin, int end, int firstM, int lastSize, int size,
+                      const std::complex<double> *twiddles)
+{
+    for(int m = firstM; 4*m <= lastSize; m *= 4){
+        int stride = size / (4*m);
+        for(int block = begin; block < end; block += 4*m){
+            radix4(data + block, m, twiddles, stride, 0, m);
+        }
+    }
+}
+
+IPCFft::IPCFft(int size) :
+    mSize(0)
+{
+    if(size > 0){
+        setSize(size);
+    }
+}
+
+/*!
+ * \brief IPCFft::setSize. Set the size of the transform, a power of two.
+ * \param size
+ */
+void IPCFft::setSize(int size)
+{
+    if(!isPowerOfTwo(size)){
+        qDebug() << Q_FUNC_INFO << "size is not a power of two:" << size;
+        return;
+    }
+    mSize = size;
+    mPlan = plan(size);
+    mHalfPlan = (size >= 2) ? plan(size/2) : QSharedPointer<const Plan>();
+}
+
+/*!
+ * \brief IPCFft::plan. Return the plan of a size, computed on first use.
+ * \param size
+ * \return
+ */
+QSharedPointer<const IPCFft::Plan> IPCFft::plan(int size)
+{
+    QMutexLocker locker(&planMutex);
+    QSharedPointer<const void> cached = planCache.value(size);
+    if(cached){
+        return cached.staticCast<const Plan>();
+    }
+    QSharedPointer<Plan> p(new Plan);
+    p->size = size;
+    p->log2Size = 0;
+    while((1 << p->log2Size) < size){
+        p->log2Size++;
+    }
+    p->twiddles.resize(size);
+    for(int k = 0; k < size; k++){
+        double angle = -2.0*M_PI*k/size;
+        p->twiddles[k] = std::complex<double>(std::cos(angle), std::sin(angle));
+    }
+    p->bitReverse.resize(size);
+    for(int i = 0; i < size; i++){
+        int r = 0;
+        for(int b = 0; b < p->log2Size; b++){
+            r |= ((i >> b) & 1) << (p->log2Size - 1 - b);
+        }
+        p->bitReverse[i] = r;
+    }
+    planCache.insert(size, p);
+    return p;
+}
+
+/*!
+ * \brief IPCFft::runTransform. In-place forward transform. Above ParallelSize, the data is split into as many
+ * contiguous chunks as threads: the first stages run on each chunk independently, then the butterflies of each
+ * remaining stage are shared between the threads.
+ * \param plan
+ * \param data
+ */
+void IPCFft::runTransform(const Plan &plan, std::complex<double> *data)
+{
+    const int n = plan.size;
+    if(n <= 1){
+        return;
+    }
+    const int *rev = plan.bitReverse.constData();
+    const std::complex<double> *twiddles = plan.twiddles.constData();
+    // With an odd number of radix-2 stages, one radix-2 stage comes first
+    const int firstM = (plan.log2Size % 2) ? 2 : 1;
+
+    int tasks = 1;
+    if(n >= ParallelSize){
+        while(2*tasks <= QThread::idealThreadCount()){
+            tasks *= 2;
+        }
+    }
+    if(tasks == 1){
+        for(int i = 0; i < n; i++){
+            if(i < rev[i]){
+                std::swap(data[i], data[rev[i]]);
+            }
+        }
+        if(firstM == 2){
+            radix2(data, 0, n);
+        }
+        runStages(data, 0, n, firstM, n, n, twiddles);
+        return;
+    }
+
+    // Chunk size: largest block size of the stage sequence fitting n/tasks
+    int chunk = firstM;
+    while(4*chunk <= n/tasks){
+        chunk *= 4;
+    }
+    QVector<int> taskIdx(n/chunk);
+    for(int t = 0; t < taskIdx.size(); t++){
+        taskIdx[t] = t;
+    }
+    // Bit reversal: each pair is swapped by the task owning its lower index
+    QtConcurrent::blockingMap(taskIdx, [&](int t){
+        for(int i = t*chunk; i < (t+1)*chunk; i++){
+            if(i < rev[i]){
+                std::swap(data[i], data[rev[i]]);
+            }
+        }
+    });
+    // Stages local to the chunks
+    QtConcurrent::blockingMap(taskIdx, [&](int t){
+        if(firstM == 2){
+            radix2(data, t*chunk, (t+1)*chunk);
+        }
+        runStages(data, t*chunk, (t+1)*chunk, firstM, chunk, n, twiddles);
+    });
+    // Remaining stages: the n/4 butterflies of each stage are split between the tasks
+    QVector<int> stageTasks(tasks);
+    for(int t = 0; t < tasks; t++){
+        stageTasks[t] = t;
+    }
+    for(int m = chunk; 4*m <= n; m *= 4){
+        const int stride = n / (4*m);
+        const int butterflies = n / 4;
+        const int perTask = butterflies / tasks;
+        QtConcurrent::blockingMap(stageTasks, [&](int t){
+            int q = t*perTask;
+            const int qEnd = (t+1)*perTask;
+            while(q < qEnd){
+                int block = q / m;
+                int j = q % m;
+                int jEnd = qMin(m, j + (qEnd - q));
+                radix4(data + block*4*m, m, twiddles, stride, j, jEnd);
+                q += jEnd - j;
+            }
+        });
+    }
+}
+
+/*!
+ * \brief IPCFft::transform. In-place forward transform of size() values: X[k] = sum x[n].exp(-2i.pi.k.n/size).
+ * \param data
+ */
+void IPCFft::transform(std::complex<double> *data) const
+{
+    if(!mPlan){
+        qDebug() << Q_FUNC_INFO << "size isn't set";
+        return;
+    }
+    runTransform(*mPlan, data);
+}
+
+/*!
+ * \brief IPCFft::transformReal. Forward transform of size() real values, computed with a complex transform of half
+ * the size: the even samples are the real parts, the odd samples the imaginary parts.
+ * \param data
+ * \return
+ */
+QVector<std::complex<double> > IPCFft::transformReal(const double *data) const
+{
+    QVector<std::complex<double> > result;
+    if(!mPlan){
+        qDebug() << Q_FUNC_INFO << "size isn't set";
+        return result;
+    }
+    const int n = mSize;
+    if(n == 1){
+        result.append(std::complex<double>(data[0], 0));
+        return result;
+    }
+    const int h = n/2;
+    QVector<std::complex<double> > z(h);
+    std::complex<double> *zp = z.data();
+    for(int i = 0; i < h; i++){
+        zp[i] = std::complex<double>(data[2*i], data[2*i+1]);
+    }
+    runTransform(*mHalfPlan, zp);
+
+    // Split the spectra of the even and odd samples, then combine them
+    const std::complex<double> *w = mPlan->twiddles.constData();
+    result.resize(h + 1);
+    std::complex<double> *x = result.data();
+    x[0] = std::complex<double>(zp[0].real() + zp[0].imag(), 0);
+    x[h] = std::complex<double>(zp[0].real() - zp[0].imag(), 0);
+    for(int k = 1; k < h; k++){
+        std::complex<double> a = zp[k];
+        std::complex<double> b = std::conj(zp[h-k]);
+        std::complex<double> even = 0.5*(a + b);
+        std::complex<double> d = a - b;
+        std::complex<double> odd(0.5*d.imag(), -0.5*d.real());     // -i.(a - b)/2
+        const std::complex<double> &wk = w[k];
+        x[k] = even + std::complex<double>(wk.real()*odd.real() - wk.imag()*odd.imag(), wk.real()*odd.imag() + wk.imag()*odd.real());
+    }
+    return result;
+}
@@ -0,0 +1,47 @@
+#ifndef IPCFFT_H
+#define IPCFFT_H
+
+#include <QVector>
+#include <QSharedPointer>
+#include <complex>
+
+/*
+ * Forward FFT of power of two sizes, without external dependency. The transform is an in-place decimation in time:
+ * a bit reversal, an optional radix-2 stage, then radix-4 stages, with SSE2 butterflies when available. Twiddle
+ * factors and bit reversal tables are computed once per size and shared by all the instances. Large transforms run
+ * their stages on several cores.
+ */
+class IPCFft
+{
+public:
+    explicit IPCFft(int size = 0);
+
+    void setSize(int size);
+    int size() const {return mSize;}
+
+    // In-place forward transform of size() complex values
+    void transform(std::complex<double> *data) const;
+    // Forward transform of size() real values. Returns the size()/2+1 bins from DC to Nyquist.
+    QVector<std::complex<double> > transformReal(const double *data) const;
+
+    static bool isPowerOfTwo(int n) {return (n > 0) && ((n & (n - 1)) == 0);}
+    // Size from which the stages run on several cores
+    static const int ParallelSize = 1 << 16;
+
+private:
+    struct Plan {
+        int size;
+        int log2Size;
+        QVector<std::complex<double> > twiddles;   // exp(-2i.pi.k/size), k < size
+        QVector<int> bitReverse;
+    };
+    static QSharedPointer<const Plan> plan(int size);
+    static void runTransform(const Plan &plan, std::complex<double> *data);
+
+    int mSize;
+    QSharedPointer<const Plan> mPlan;
+    // Plan of the half size complex transform used by transformReal()
+    QSharedPointer<const Plan> mHalfPlan;
+};
+
+#endif // IPCFFT_H
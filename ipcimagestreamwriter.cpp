@@ -0,0 +1,555 @@
+#include "ipcimagestreamwriter.h"
+#include <QFileInfo>
+#include <QDebug>
+#include <cstring>
+#ifdef IPC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Size from which the pending compressed data is written as an IDAT chunk
+static const int IdatChunkSize = 1 << 18;
+// Largest stored deflate block
+static const int StoredBlockSize = 65535;
+
+/*!
+ * \brief put16. Append a 16 bits value, big or little endian.
+ */
+static void put16(QByteArray &out, quint16 value, bool bigEndian)
+{
+    if(bigEndian){
+        out.append(char(value >> 8)).append(char(value));
+    } else{
+        out.append(char(value)).append(char(value >> 8));
+    }
+}
+
+/*!
+ * \brief put32. Append a 32 bits value, big or little endian.
+ */
+static void put32(QByteArray &out, quint32 value, bool bigEndian)
+{
+    if(bigEndian){
+        put16(out, quint16(value >> 16), true);
+        put16(out, quint16(value), true);
+    } else{
+        put16(out, quint16(value), false);
+        put16(out, quint16(value >> 16), false);
+    }
+}
+
+/*!
+ * \brief crc32. Update the CRC-32 (PNG chunks) of data.
+ */
+static quint32 crc32Update(quint32 crc, const uchar *data, int len)
+{
+    static const QVector<quint32> table = []() {
+        QVector<quint32> t(256);
+        for(quint32 n = 0; n < 256; n++){
+            quint32 c = n;
+            for(int k = 0; k < 8; k++){
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for(int i = 0; i < len; i++){
+        crc = table.at((crc ^ data[i]) & 0xFF) ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/*!
+ * \brief adler32Update. Update the Adler-32 checksum (zlib streams) of data.
+ */
+static quint32 adler32Update(quint32 adler, const uchar *data, int len)
+{
+    quint32 a = adler & 0xFFFF;
+    quint32 b = adler >> 16;
+    while(len > 0){
+        // 5552 bytes is the largest block that can't overflow 32 bits before the modulo
+        int block = qMin(len, 5552);
+        len -= block;
+        while(block-- > 0){
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+/*!
+ * \brief packBits. Append a PackBits (TIFF compression 32773) encoding of one row.
+ */
+static void packBits(QByteArray &out, const uchar *src, int len)
+{
+    int i = 0;
+    while(i < len){
+        int run = 1;
+        while((i + run < len) && (run < 128) && (src[i + run] == src[i])){
+            run++;
+        }
+        if(run >= 2){
+            out.append(char(1 - run));
+            out.append(char(src[i]));
+            i += run;
+        } else{
+            // Literal bytes, up to the next run of 3
+            int start = i;
+            int count = 0;
+            while((i < len) && (count < 128)){
+                if((i + 2 < len) && (src[i] == src[i + 1]) && (src[i + 1] == src[i + 2])){
+                    break;
+                }
+                i++;
+                count++;
+            }
+            out.append(char(count - 1));
+            out.append(reinterpret_cast<const char *>(src + start), count);
+        }
+    }
+}
+
+/*!
+ * \brief IPCImageStreamWriter::IPCImageStreamWriter. Constructor.
+ * \param format
+ */
+IPCImageStreamWriter::IPCImageStreamWriter(Format format) :
+    mFormat(format),
+    mFile(nullptr),
+    mWidth(0),
+    mHeight(0),
+    mDotsPerInch(96),
+    mRowsWritten(0),
+    mDeflate(nullptr),
+    mAdler(1),
+    mRowsPerStrip(0)
+{
+
+}
+
+IPCImageStreamWriter::~IPCImageStreamWriter()
+{
+    cancel();
+}
+
+/*!
+ * \brief IPCImageStreamWriter::formatForFileName. Return TIFF for .tif and .tiff files, PNG otherwise.
+ * \param fileName
+ */
+IPCImageStreamWriter::Format IPCImageStreamWriter::formatForFileName(const QString &fileName)
+{
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    return (suffix == "tif" || suffix == "tiff") ? ifTiff : ifPng;
+}
+
+/*!
+ * \brief IPCImageStreamWriter::fail. Record an error, drop the file and return false.
+ * \param error
+ */
+bool IPCImageStreamWriter::fail(const QString &error)
+{
+    mError = error;
+    qDebug() << Q_FUNC_INFO << error;
+    cancel();
+    return false;
+}
+
+/*!
+ * \brief IPCImageStreamWriter::open. Create the file and write the header. The file only replaces an existing one once
+ * close() succeeds.
+ * \param fileName
+ * \param width
+ * \param height
+ * \param dotsPerInch
+ * \return
+ */
+bool IPCImageStreamWriter::open(const QString &fileName, int width, int height, int dotsPerInch)
+{
+    cancel();
+    mError.clear();
+    if(width <= 0 || height <= 0){
+        return fail("Invalid image size");
+    }
+    mWidth = width;
+    mHeight = height;
+    mDotsPerInch = qMax(1, dotsPerInch);
+    mRowsWritten = 0;
+    mFile = new QSaveFile(fileName);
+    if(!mFile->open(QIODevice::WriteOnly)){
+        return fail(QString("Couldn't open %1: %2").arg(fileName, mFile->errorString()));
+    }
+    if(mFormat == ifPng){
+        return writePngHeader();
+    }
+    // TIFF header, little endian. The offset of the IFD is written by close().
+    QByteArray header("II");
+    put16(header, 42, false);
+    put32(header, 0, false);
+    mStripOffsets.clear();
+    mStripByteCounts.clear();
+    mRowsPerStrip = 0;
+    if(mFile->write(header) != header.size()){
+        return fail(mFile->errorString());
+    }
+    return true;
+}
+
+/*!
+ * \brief IPCImageStreamWriter::writeBand. Append the rows of a band.
+ * \param band
+ * \return
+ */
+bool IPCImageStreamWriter::writeBand(const QImage &band)
+{
+    if(!mFile){
+        mError = "Writer isn't open";
+        return false;
+    }
+    if(band.width() != mWidth || band.height() <= 0 || mRowsWritten + band.height() > mHeight){
+        return fail("Band doesn't fit the image");
+    }
+    QImage rgba = (band.format() == QImage::Format_RGBA8888) ? band : band.convertToFormat(QImage::Format_RGBA8888);
+    bool ok = (mFormat == ifPng) ? writePngRows(rgba) : writeTiffStrip(rgba);
+    if(ok){
+        mRowsWritten += band.height();
+    }
+    return ok;
+}
+
+/*!
+ * \brief IPCImageStreamWriter::close. Write the trailer and commit the file.
+ * \return
+ */
+bool IPCImageStreamWriter::close()
+{
+    if(!mFile){
+        mError = "Writer isn't open";
+        return false;
+    }
+    if(mRowsWritten != mHeight){
+        return fail(QString("Only %1 of %2 rows written").arg(mRowsWritten).arg(mHeight));
+    }
+    bool ok = (mFormat == ifPng) ? writePngTrailer() : writeTiffTrailer();
+    if(!ok){
+        return false;
+    }
+    ok = mFile->commit();
+    if(!ok){
+        mError = mFile->errorString();
+    }
+    delete mFile;
+    mFile = nullptr;
+    return ok;
+}
+
+/*!
+ * \brief IPCImageStreamWriter::cancel. Drop the file being written, the previous file (if any) is left untouched.
+ */
+void IPCImageStreamWriter::cancel()
+{
+#ifdef IPC_HAVE_ZLIB
+    if(mDeflate){
+        deflateEnd(static_cast<z_stream *>(mDeflate));
+        delete static_cast<z_stream *>(mDeflate);
+    }
+#endif
+    mDeflate = nullptr;
+    mIdat.clear();
+    mStored.clear();
+    if(mFile){
+        mFile->cancelWriting();
+        delete mFile;
+        mFile = nullptr;
+    }
+}
+
+/*!
+ * \brief IPCImageStreamWriter::writePngChunk. Write a PNG chunk: length, type, data and CRC.
+ * \param type
+ * \param data
+ * \return
+ */
+bool IPCImageStreamWriter::writePngChunk(const char *type, const QByteArray &data)
+{
+    QByteArray chunk;
+    chunk.reserve(data.size() + 12);
+    put32(chunk, quint32(data.size()), true);
+    chunk.append(type, 4);
+    chunk.append(data);
+    quint32 crc = crc32Update(0, reinterpret_cast<const uchar *>(chunk.constData()) + 4, data.size() + 4);
+    put32(chunk, crc, true);
+    if(mFile->write(chunk) != chunk.size()){
+        return fail(mFile->errorString());
+    }
+    return true;
+}
+
+/*!
+ * \brief IPCImageStreamWriter::writePngHeader. Write the signature, IHDR and pHYs, and start the deflate stream.
+ * \return
+ */
+bool IPCImageStreamWriter::writePngHeader()
+{
+    static const char signature[8] = {char(0x89), 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if(mFile->write(signature, 8) != 8){
+        return fail(mFile->errorString());
+    }
+    QByteArray ihdr;
+    put32(ihdr, quint32(mWidth), true);
+    put32(ihdr, quint32(mHeight), true);
+    ihdr.append(char(8));       // Bit depth
+    ihdr.append(char(6));       // RGBA
+    ihdr.append(char(0));       // Deflate
+    ihdr.append(char(0));       // Adaptive filtering
+    ihdr.append(char(0));       // No interlace
+    QByteArray phys;
+    quint32 dotsPerMeter = quint32(qRound(mDotsPerInch / 0.0254));
+    put32(phys, dotsPerMeter, true);
+    put32(phys, dotsPerMeter, true);
+    phys.append(char(1));       // Meter
+    if(!writePngChunk("IHDR", ihdr) || !writePngChunk("pHYs", phys)){
+        return false;
+    }
+#ifdef IPC_HAVE_ZLIB
+    z_stream *stream = new z_stream;
+    memset(stream, 0, sizeof(z_stream));
+    if(deflateInit(stream, 6) != Z_OK){
+        delete stream;
+        return fail("Couldn't initialize the deflate stream");
+    }
+    mDeflate = stream;
+#else
+    // zlib header: deflate, 32K window, no compression level hint
+    mIdat.append(char(0x78)).append(char(0x01));
+    mAdler = 1;
+#endif
+    return true;
+}
+
+/*!
+ * \brief IPCImageStreamWriter::flushIdat. Write the pending compressed data as IDAT chunks.
+ * \param final Write everything, instead of full chunks only
+ * \return
+ */
+bool IPCImageStreamWriter::flushIdat(bool final)
+{
+    while(mIdat.size() >= IdatChunkSize || (final && !mIdat.isEmpty())){
+        int size = qMin(mIdat.size(), IdatChunkSize);
+        if(!writePngChunk("IDAT", mIdat.left(size))){
+            return false;
+        }
+        mIdat.remove(0, size);
+    }
+    return true;
+}
+
+/*!
+ * \brief IPCImageStreamWriter::writePngRows. Compress the rows of a band, each with the filter type None.
+ * \param band RGBA8888 rows
+ * \return
+ */
+bool IPCImageStreamWriter::writePngRows(const QImage &band)
+{
+    const int rowBytes = 4 * mWidth;
+    QByteArray row(rowBytes + 1, 0);
+    for(int y = 0; y < band.height(); y++){
+        memcpy(row.data() + 1, band.constScanLine(y), rowBytes);
+#ifdef IPC_HAVE_ZLIB
+        z_stream *stream = static_cast<z_stream *>(mDeflate);
+        stream->next_in = reinterpret_cast<Bytef *>(row.data());
+        stream->avail_in = uInt(row.size());
+        uchar out[1 << 16];
+        do{
+            stream->next_out = out;
+            stream->avail_out = sizeof(out);
+            deflate(stream, Z_NO_FLUSH);
+            mIdat.append(reinterpret_cast<const char *>(out), int(sizeof(out) - stream->avail_out));
+        } while(stream->avail_out == 0);
+#else
+        mAdler = adler32Update(mAdler, reinterpret_cast<const uchar *>(row.constData()), row.size());
+        mStored.append(row);
+        // Full stored blocks; the last one is written by the trailer, with the final flag
+        while(mStored.size() > StoredBlockSize){
+            mIdat.append(char(0));
+            put16(mIdat, quint16(StoredBlockSize), false);
+            put16(mIdat, quint16(~StoredBlockSize), false);
+            mIdat.append(mStored.constData(), StoredBlockSize);
+            mStored.remove(0, StoredBlockSize);
+        }
+#endif
+        if(!flushIdat(false)){
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief IPCImageStreamWriter::writePngTrailer. End the deflate stream, then write the last IDAT chunks and IEND.
+ * \return
+ */
+bool IPCImageStreamWriter::writePngTrailer()
+{
+#ifdef IPC_HAVE_ZLIB
+    z_stream *stream = static_cast<z_stream *>(mDeflate);
+    uchar out[1 << 16];
+    int status;
+    do{
+        stream->next_out = out;
+        stream->avail_out = sizeof(out);
+        status = deflate(stream, Z_FINISH);
+        mIdat.append(reinterpret_cast<const char *>(out), int(sizeof(out) - stream->avail_out));
+    } while(status == Z_OK);
+    deflateEnd(stream);
+    delete stream;
+    mDeflate = nullptr;
+    if(status != Z_STREAM_END){
+        return fail("Deflate stream error");
+    }
+#else
+    mIdat.append(char(1));
+    put16(mIdat, quint16(mStored.size()), false);
+    put16(mIdat, quint16(~mStored.size()), false);
+    mIdat.append(mStored);
+    mStored.clear();
+    put32(mIdat, mAdler, true);
+#endif
+    return flushIdat(true) && writePngChunk("IEND", QByteArray());
+}
+
+/*!
+ * \brief IPCImageStreamWriter::writeTiffStrip. Compress a band as one strip. All the bands but the last one must have
+ * the same height.
+ * \param band RGBA8888 rows
+ * \return
+ */
+bool IPCImageStreamWriter::writeTiffStrip(const QImage &band)
+{
+    if(mRowsPerStrip == 0){
+        mRowsPerStrip = band.height();
+    }
+    bool last = (mRowsWritten + band.height() == mHeight);
+    if(band.height() > mRowsPerStrip || (band.height() < mRowsPerStrip && !last)){
+        return fail("All the bands but the last one must have the same height");
+    }
+    const int rowBytes = 4 * mWidth;
+    QByteArray strip;
+#ifdef IPC_HAVE_ZLIB
+    QByteArray raw;
+    raw.reserve(rowBytes * band.height());
+    for(int y = 0; y < band.height(); y++){
+        raw.append(reinterpret_cast<const char *>(band.constScanLine(y)), rowBytes);
+    }
+    uLongf size = compressBound(uLong(raw.size()));
+    strip.resize(int(size));
+    if(compress2(reinterpret_cast<Bytef *>(strip.data()), &size, reinterpret_cast<const Bytef *>(raw.constData()),
+                 uLong(raw.size()), 6) != Z_OK){
+        return fail("Strip compression error");
+    }
+    strip.resize(int(size));
+#else
+    for(int y = 0; y < band.height(); y++){
+        packBits(strip, band.constScanLine(y), rowBytes);
+    }
+#endif
+    qint64 offset = mFile->pos();
+    if(offset + strip.size() > 0xFFFFFFFFLL){
+        return fail("Image too large for a TIFF file");
+    }
+    if(mFile->write(strip) != strip.size()){
+        return fail(mFile->errorString());
+    }
+    mStripOffsets.append(quint32(offset));
+    mStripByteCounts.append(quint32(strip.size()));
+    return true;
+}
+
+/*!
+ * \brief IPCImageStreamWriter::writeTiffTrailer. Write the IFD after the strips, and its offset in the header.
+ * \return
+ */
+bool IPCImageStreamWriter::writeTiffTrailer()
+{
+    const int stripCount = mStripOffsets.size();
+    qint64 base = mFile->pos();
+    QByteArray data;
+    // Word alignment of the values written out of the IFD
+    if(base & 1){
+        data.append(char(0));
+    }
+    auto offset = [&]() {return quint32(base + data.size());};
+    quint32 bitsOffset = offset();
+    for(int i = 0; i < 4; i++){
+        put16(data, 8, false);
+    }
+    quint32 resolutionOffset = offset();
+    put32(data, quint32(mDotsPerInch), false);
+    put32(data, 1, false);
+    quint32 stripOffsetsOffset = offset();
+    if(stripCount > 1){
+        foreach(quint32 value, mStripOffsets){
+            put32(data, value, false);
+        }
+    }
+    quint32 stripByteCountsOffset = offset();
+    if(stripCount > 1){
+        foreach(quint32 value, mStripByteCounts){
+            put32(data, value, false);
+        }
+    }
+    quint32 ifdOffset = offset();
+
+    // Entries sorted by tag: tag, type (3 SHORT, 4 LONG, 5 RATIONAL), count, value or offset
+    struct Entry { quint16 tag; quint16 type; quint32 count; quint32 value; };
+#ifdef IPC_HAVE_ZLIB
+    const quint16 compression = 8;          // Deflate
+#else
+    const quint16 compression = 32773;      // PackBits
+#endif
+    const Entry entries[] = {
+        {256, 4, 1, quint32(mWidth)},
+        {257, 4, 1, quint32(mHeight)},
+        {258, 3, 4, bitsOffset},
+        {259, 3, 1, compression},
+        {262, 3, 1, 2},                     // RGB
+        {273, 4, quint32(stripCount), stripCount > 1 ? stripOffsetsOffset : mStripOffsets.first()},
+        {277, 3, 1, 4},                     // Samples per pixel
+        {278, 4, 1, quint32(mRowsPerStrip)},
+        {279, 4, quint32(stripCount), stripCount > 1 ? stripByteCountsOffset : mStripByteCounts.first()},
+        {282, 5, 1, resolutionOffset},
+        {283, 5, 1, resolutionOffset},
+        {284, 3, 1, 1},                     // Chunky
+        {296, 3, 1, 2},                     // Inch
+        {338, 3, 1, 2},                     // Unassociated alpha
+    };
+    const int entryCount = int(sizeof(entries) / sizeof(Entry));
+    put16(data, quint16(entryCount), false);
+    for(int i = 0; i < entryCount; i++){
+        const Entry &entry = entries[i];
+        put16(data, entry.tag, false);
+        put16(data, entry.type, false);
+        put32(data, entry.count, false);
+        if(entry.type == 3 && entry.count == 1){
+            // A SHORT value is left justified in the value field
+            put16(data, quint16(entry.value), false);
+            put16(data, 0, false);
+        } else{
+            put32(data, entry.value, false);
+        }
+    }
+    put32(data, 0, false);      // No next IFD
+
+    if(base + data.size() > 0xFFFFFFFFLL){
+        return fail("Image too large for a TIFF file");
+    }
+    QByteArray header;
+    put32(header, ifdOffset, false);
+    if(mFile->write(data) != data.size() || !mFile->seek(4) || mFile->write(header) != header.size()){
+        return fail(mFile->errorString());
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef IPCIMAGESTREAMWRITER_H
+#define IPCIMAGESTREAMWRITER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QImage>
+#include <QSaveFile>
+
+/*
+ * Streaming encoder of RGBA images of any size, written band by band from top to bottom: only the current band is held
+ * in memory. PNG is deflate compressed with zlib when built with IPC_HAVE_ZLIB, and written as stored deflate blocks
+ * otherwise. TIFF strips, one per band, are deflate compressed with zlib and PackBits compressed otherwise.
+ */
+class IPCImageStreamWriter
+{
+public:
+    enum Format { ifPng    /// PNG, 8 bits RGBA
+                 ,ifTiff   /// TIFF, 8 bits RGBA, one strip per band
+                };
+
+    explicit IPCImageStreamWriter(Format format = ifPng);
+    ~IPCImageStreamWriter();
+
+    bool open(const QString &fileName, int width, int height, int dotsPerInch = 96);
+    // Append rows. The band must be as wide as the image, any format.
+    bool writeBand(const QImage &band);
+    // Write the trailer and commit the file. Fails if some rows are missing.
+    bool close();
+    void cancel();
+
+    // Getters
+    Format format() const {return mFormat;}
+    int rowsWritten() const {return mRowsWritten;}
+    QString errorString() const {return mError;}
+
+    static Format formatForFileName(const QString &fileName);
+
+private:
+    bool writePngHeader();
+    bool writePngRows(const QImage &band);
+    bool writePngTrailer();
+    bool writePngChunk(const char *type, const QByteArray &data);
+    bool flushIdat(bool final);
+    bool writeTiffStrip(const QImage &band);
+    bool writeTiffTrailer();
+    bool fail(const QString &error);
+
+    Format mFormat;
+    QSaveFile *mFile;
+    int mWidth;
+    int mHeight;
+    int mDotsPerInch;
+    int mRowsWritten;
+    QString mError;
+    // PNG: compressed data waiting for an IDAT chunk, and the deflate state
+    QByteArray mIdat;
+    void *mDeflate;
+    quint32 mAdler;
+    QByteArray mStored;
+    // TIFF: offsets and sizes of the strips, rows per strip
+    QVector<quint32> mStripOffsets;
+    QVector<quint32> mStripByteCounts;
+    int mRowsPerStrip;
+};
+
+#endif // IPCIMAGESTREAMWRITER_H
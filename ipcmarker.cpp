@@ -1,4 +1,33 @@
 #include "ipcmarker.h"
+#include "ipcaxismapping.h"
+
+/*!
+ * \brief axisValue. Value in the axis space of a scale. Non positive values on a log scale are kept as they are.
+ */
+template <typename Scale>
+static inline double axisValue(double value)
+{
+    return (Scale::isLog && !(value > 0)) ? value : Scale::toAxis(value);
+}
+
+/*!
+ * \brief interpolate. Value at x of the line through (x1, y1) and (x2, y2), drawn straight in the axis space.
+ */
+template <typename XScale, typename YScale>
+static double interpolate(double x1, double y1, double x2, double y2, double x)
+{
+    x1 = axisValue<XScale>(x1);
+    x2 = axisValue<XScale>(x2);
+    x = axisValue<XScale>(x);
+    y1 = axisValue<YScale>(y1);
+    y2 = axisValue<YScale>(y2);
+    double slope = 0;
+    if (!qFuzzyCompare(x1, x2)){
+        slope = (y2 - y1)/(x2 - x1);
+    }
+    double y = y1 + (x - x1)*slope;
+    return YScale::isLog ? YScale::fromAxis(y) : y;
+}
 
 IPCMarker::IPCMarker(QChart *parentChart, QXYSeries *targetGraph) :
     QGraphicsItem(parentChart),    
@@ -7,7 +36,8 @@ IPCMarker::IPCMarker(QChart *parentChart, QXYSeries *targetGraph) :
     mGraphKey(0),
     mInterpolating(true),
     mXLog(false),
-    mYLog(false)
+    mYLog(false),
+    mInterpolate(&interpolate<IPCLinearScale, IPCLinearScale>)
 {
     mParentChart = parentChart;
     mTargetGraph = targetGraph;
@@ -61,11 +91,14 @@ void IPCMarker::setFont(const QFont &font)
 }
 
 /*!
- * \brief IPCMarker::setGraph. Attach the marker to a graph.
+ * \brief IPCMarker::setGraph. Attach the marker to a graph. If the graph's series only holds the visible part of the data
+ * (viewport culling), sourcePoints gives the full data used to position the marker.
  * \param graph
+ * \param sourcePoints
  */
-void IPCMarker::setGraph(QAbstractSeries *graph)
+void IPCMarker::setGraph(QAbstractSeries *graph, const QVector<QPointF> &sourcePoints)
 {
+    mSourcePoints = sourcePoints;
     if (graph){
         if (graph->chart() == mParentChart){
             mTargetGraph = graph;
@@ -78,6 +111,22 @@ void IPCMarker::setGraph(QAbstractSeries *graph)
     }
 }
 
+/*!
+ * \brief IPCMarker::setLogScale. Set the scales of the axes, which select the interpolation.
+ * \param xLog
+ * \param yLog
+ */
+void IPCMarker::setLogScale(bool xLog, bool yLog)
+{
+    mXLog = xLog;
+    mYLog = yLog;
+    if(xLog){
+        mInterpolate = yLog ? &interpolate<IPCLogScale, IPCLogScale> : &interpolate<IPCLogScale, IPCLinearScale>;
+    } else{
+        mInterpolate = yLog ? &interpolate<IPCLinearScale, IPCLogScale> : &interpolate<IPCLinearScale, IPCLinearScale>;
+    }
+}
+
 /*!
  * \brief IPCMarker::setGraphKey. Move the marker to the key value (abcissa value)
  * \param key
@@ -106,18 +155,21 @@ void IPCMarker::updatePosition()
                 qDebug() << Q_FUNC_INFO << " series is neither Area nor Line nor Scatter.";
                 return;
             }
-            if (series->pointsVector().size() > 1){
-                QVector<QPointF>::const_iterator first = series->pointsVector().constBegin();
-                QVector<QPointF>::const_iterator last = series->pointsVector().constEnd()-1;
+            const QVector<QPointF> points = mSourcePoints.isEmpty() ? series->pointsVector() : mSourcePoints;
+            // Only the values read are converted to the shown unit
+            const bool transformed = !mSourcePoints.isEmpty() && !mValueTransform.isIdentity();
+            auto shown = [&](double y){return transformed ? mValueTransform.apply(y) : y;};
+            if (points.size() > 1){
+                QVector<QPointF>::const_iterator first = points.constBegin();
+                QVector<QPointF>::const_iterator last = points.constEnd()-1;
                 if (mGraphKey <= first->x()){
                     mPos.setX(first->x());
-                    mPos.setY(first->y());
+                    mPos.setY(shown(first->y()));
                 } else if (mGraphKey >= last->x()){
                     mPos.setX(last->x());
-                    mPos.setY(last->y());
+                    mPos.setY(shown(last->y()));
                 } else{
                     /* Find the lower bound */
-                    QVector<QPointF> points = series->pointsVector();
                     QPointF keyPoint(mGraphKey, 0);
 
                     QVector<QPointF>::const_iterator it = std::lower_bound(points.constBegin(), points.constEnd(), keyPoint, QPointFLessThan);
@@ -134,57 +186,24 @@ void IPCMarker::updatePosition()
                     // Note that the marker position is in the graph's coordinate, NOT the Chart's pixel coordinate.
                     if (mInterpolating)
                     {
-                        // interpolate between the two iterators around mGraphKey:
-                        double slope = 0;
-                        double x1 = prevIt->x();
-                        double x2 = it->x();
-                        double y1 = prevIt->y();
-                        double y2 = it->y();
-                        double x = mGraphKey;
-                        if(mXLog){
-                            if(x1 > 0){
-                                x1 = log10(x1);
-                            }
-                            if(x2 > 0){
-                                x2 = log10(x2);
-                            }
-                            if(x > 0){
-                                x = log10(x);
-                            }
-                        }
-                        if(mYLog){
-                            if(y1 > 0){
-                                y1 = log10(y1);
-                            }
-                            if(y2 > 0){
-                                y2 = log10(y2);
-                            }
-                        }
-                        if (!qFuzzyCompare(x1, x2)){
-                            slope = (y2 - y1)/(x2 - x1);
-                        }
-                        double y = y1 + (x - x1)*slope;
+                        // interpolate between the two iterators around mGraphKey, for the axis scales set
                         mPos.setX(mGraphKey);
-                        if(mYLog){
-                            mPos.setY(pow(10, y));
-                        }else {
-                            mPos.setY(y);
-                        }
+                        mPos.setY(mInterpolate(prevIt->x(), shown(prevIt->y()), it->x(), shown(it->y()), mGraphKey));
                     } else{
                         // Find the iterator with key closest to mGraphKey:
                         if (mGraphKey < (prevIt->x()+it->x())*0.5){
                             mPos.setX(prevIt->x());
-                            mPos.setY(prevIt->y());
+                            mPos.setY(shown(prevIt->y()));
                         } else{
                             mPos.setX(it->x());
-                            mPos.setY(it->y());
+                            mPos.setY(shown(it->y()));
                         }
                     }
                 }
-            } else if (series->pointsVector().size() == 1){
-                QVector<QPointF>::const_iterator it = series->pointsVector().constBegin();
+            } else if (points.size() == 1){
+                QVector<QPointF>::const_iterator it = points.constBegin();
                 mPos.setX(it->x());
-                mPos.setY(it->y());
+                mPos.setY(shown(it->y()));
             }
         }
         prepareGeometryChange();
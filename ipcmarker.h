@@ -2,6 +2,7 @@
 #define IPCMARKER_H
 
 #include <QtCharts>
+#include "ipcunittransform.h"
 
 using namespace QtCharts;
 
@@ -38,10 +39,12 @@ public:
     void setFont(const QFont &font);
     void setSize(double size){mSize = size;}
     void setStyle(MarkerStyle style){mStyle = style;}
-    void setGraph(QAbstractSeries *graph);
+    void setGraph(QAbstractSeries *graph, const QVector<QPointF> &sourcePoints = QVector<QPointF>());
+    void setSourcePoints(const QVector<QPointF> &points){mSourcePoints = points;}
+    void setValueTransform(const IPCUnitTransform &transform){mValueTransform = transform;}
     void setGraphKey(double key);
     void setInterpolating(bool enabled){mInterpolating = enabled;}
-    void setLogScale(bool xLog, bool yLog){mXLog = xLog; mYLog = yLog;}
+    void setLogScale(bool xLog, bool yLog);
 
     // Getters
     QString name() const {return mName;}
@@ -57,6 +60,7 @@ public:
     QAbstractSeries *graph(){return mTargetGraph;}
     double graphKey() const {return mGraphKey;}
     bool interpolating() const {return mInterpolating;}
+    IPCUnitTransform valueTransform() const {return mValueTransform;}
     QPointF pos() const {return mPos;}
 
     // Update the position when the graph data changes
@@ -87,8 +91,14 @@ private:
     bool mInterpolating;
     bool mXLog; // Indicate the x axis is log scale, used to correctly interpolate
     bool mYLog; // Indicate that the y axis is log scale
+    // Interpolation specialized for the axis scales, chosen by setLogScale()
+    double (*mInterpolate)(double x1, double y1, double x2, double y2, double x);
     // Marker position
     QPointF mPos;
+    // Full data of the graph when the series only holds the visible points. Empty to use the series points.
+    QVector<QPointF> mSourcePoints;
+    // Transform from the unit of the source points to the shown unit. The series points are already shown values.
+    IPCUnitTransform mValueTransform;
 
 };
 
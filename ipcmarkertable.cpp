@@ -1,4 +1,5 @@
 #include "ipcmarkertable.h"
+#include "ipctracer.h"
 
 IPCMarkerTable::IPCMarkerTable(QWidget *parent) :
     QTableWidget(0,5,parent),
@@ -80,6 +81,7 @@ void IPCMarkerTable::setFont(const QFont &font)
  */
 void IPCMarkerTable::setMarkerPos(int markerIdx, QPointF pos)
 {
+    IPC_TRACE_SPAN("IPCMarkerTable::setMarkerPos");
     if((markerIdx < 0)||(markerIdx > this->rowCount()-1)){
         qDebug() << Q_FUNC_INFO << "index out of range.";
     }
@@ -282,6 +284,7 @@ void IPCMarkerTable::clearMarkers()
  */
 void IPCMarkerTable::resizeToContents()
 {
+    IPC_TRACE_SPAN("IPCMarkerTable::resizeToContents");
     int nbCol = this->columnCount();
     int nbRow = this->rowCount();
     int tableWidth = 0;
@@ -315,6 +318,76 @@ void IPCMarkerTable::resizeToContents()
     return;
 }
 
+/*!
+ * \brief IPCMarkerTable::cells. Return the text, color and font of the cells of the visible columns.
+ * \return
+ */
+IPCMarkerTable::Cells IPCMarkerTable::cells() const
+{
+    Cells result;
+    for(int row = 0; row < this->rowCount(); row++){
+        QList<Cell> rowCells;
+        for(int column = 0; column < this->columnCount(); column++){
+            if(this->isColumnHidden(column)){
+                continue;
+            }
+            Cell cell;
+            QTableWidgetItem *item = this->item(row, column);
+            if(item){
+                cell.text = item->text();
+                cell.color = item->foreground().color();
+                cell.font = item->font();
+            }
+            rowCells.append(cell);
+        }
+        result.append(rowCells);
+    }
+    return result;
+}
+
+/*!
+ * \brief IPCMarkerTable::paintCells. Paint cells with the painter's font engine, instead of laying out an html table:
+ * text stays text in vector outputs. Cells are padded and spaced as in printed tables, from the painter's origin.
+ * \param painter
+ * \param cells
+ */
+void IPCMarkerTable::paintCells(QPainter *painter, const Cells &cells)
+{
+    const double padding = 2;
+    const double spacing = 5;
+    QVector<double> widths;
+    QVector<double> heights(cells.size(), 0);
+    for(int row = 0; row < cells.size(); row++){
+        const QList<Cell> &rowCells = cells.at(row);
+        if(widths.size() < rowCells.size()){
+            widths.resize(rowCells.size());
+        }
+        for(int column = 0; column < rowCells.size(); column++){
+            QFontMetricsF metrics(rowCells.at(column).font);
+            widths[column] = qMax(widths.at(column), metrics.horizontalAdvance(rowCells.at(column).text));
+            heights[row] = qMax(heights.at(row), metrics.height());
+        }
+    }
+    painter->save();
+    double y = spacing;
+    for(int row = 0; row < cells.size(); row++){
+        const QList<Cell> &rowCells = cells.at(row);
+        double x = spacing;
+        for(int column = 0; column < rowCells.size(); column++){
+            const Cell &cell = rowCells.at(column);
+            if(!cell.text.isEmpty()){
+                painter->setFont(cell.font);
+                painter->setPen(cell.color);
+                painter->drawText(QRectF(x + padding, y + padding, widths.at(column), heights.at(row)),
+                                  Qt::AlignLeft | Qt::AlignVCenter, cell.text);
+            }
+            x += widths.at(column) + 2*padding + spacing;
+        }
+        y += heights.at(row) + 2*padding + spacing;
+    }
+    painter->restore();
+}
+
 /*!
  * \brief IPCMarkerTable::mousePressEvent. Register the clicked point in order to move the widget later in MouseMoveEvent() method.
  * \param event
@@ -5,6 +5,7 @@
 #include <QHeaderView>
 #include <QScrollBar>
 #include <QMouseEvent>
+#include <QPainter>
 #include <QDebug>
 
 class IPCMarkerTable : public QTableWidget
@@ -19,6 +20,14 @@ public:
                         };
     Q_ENUMS(KeyDisplayType)
 
+    // Snapshot of one cell, for printing
+    struct Cell {
+        QString text;
+        QColor color;
+        QFont font;
+    };
+    typedef QList<QList<Cell> > Cells;
+
     // Resize to contents
     void resizeToContents();
     // Add one marker entry
@@ -40,6 +49,11 @@ public:
     int precision() const{return mPrecision;}
     QColor color() const{return mColor;}
     QFont font() const{return mFont;}
+    // Visible cells, by row
+    Cells cells() const;
+
+    // Paint cells as vector text, in any thread
+    static void paintCells(QPainter *painter, const Cells &cells);
 protected:
     void viewSetup();
     void freqTextFormat(double x, int precision, int len, QString &xString, QString &xUnitString);
@@ -0,0 +1,196 @@
+#include "ipcmemorybudget.h"
+#include "ipcscope.h"
+#include <QCoreApplication>
+#include <QPointer>
+#include <algorithm>
+
+// A history is never shortened below this size
+static const qint64 MinHistoryBytes = 1024*1024;
+
+IPCMemoryBudget::IPCMemoryBudget(QObject *parent) :
+    QObject(parent),
+    mBudget(0)
+{
+    mTimer = new QTimer(this);
+    mTimer->setInterval(1000);
+    connect(mTimer, &QTimer::timeout, this, &IPCMemoryBudget::enforce);
+}
+
+/*!
+ * \brief IPCMemoryBudget::instance. Return the accounting shared by the application. It is created on first call and
+ * deleted with the application object.
+ * \return
+ */
+IPCMemoryBudget *IPCMemoryBudget::instance()
+{
+    static QPointer<IPCMemoryBudget> budget;
+    if(!budget){
+        budget = new IPCMemoryBudget(QCoreApplication::instance());
+    }
+    return budget;
+}
+
+/*!
+ * \brief IPCMemoryBudget::registerScope. Account a scope.
+ * \param scope
+ */
+void IPCMemoryBudget::registerScope(IPCScope *scope)
+{
+    mScopes.insert(scope);
+}
+
+/*!
+ * \brief IPCMemoryBudget::unregisterScope. Stop accounting a scope.
+ * \param scope
+ */
+void IPCMemoryBudget::unregisterScope(IPCScope *scope)
+{
+    mScopes.remove(scope);
+}
+
+/*!
+ * \brief IPCMemoryBudget::setBudget. Set the memory budget of all the scopes, in bytes. 0 (default) means no budget. The
+ * budget is checked every check interval.
+ * \param bytes
+ */
+void IPCMemoryBudget::setBudget(qint64 bytes)
+{
+    mBudget = qMax(Q_INT64_C(0), bytes);
+    if(mBudget > 0){
+        mTimer->start();
+        enforce();
+    } else{
+        mTimer->stop();
+    }
+}
+
+/*!
+ * \brief IPCMemoryBudget::setCheckInterval. Set the interval between two budget checks. Default is 1 s.
+ * \param msec
+ */
+void IPCMemoryBudget::setCheckInterval(int msec)
+{
+    mTimer->setInterval(qMax(1, msec));
+}
+
+/*!
+ * \brief IPCMemoryBudget::memoryUsage. Return the memory used by a category, over all the scopes. Data shared between
+ * graphs or scopes is counted once.
+ * \param category
+ * \return
+ */
+qint64 IPCMemoryBudget::memoryUsage(Category category) const
+{
+    QSet<const void *> counted;
+    qint64 usage = 0;
+    foreach(IPCScope *scope, mScopes){
+        if(category == mcCulling){
+            usage += scope->zoomHistoryMemoryUsage();
+        }
+        for(int i = 0; i < scope->graphCount(); i++){
+            usage += scope->graphMemoryUsage(i, category, &counted);
+        }
+    }
+    return usage;
+}
+
+/*!
+ * \brief IPCMemoryBudget::memoryUsage. Return the memory used by all the scopes. Data shared between graphs, scopes or
+ * categories is counted once.
+ * \return
+ */
+qint64 IPCMemoryBudget::memoryUsage() const
+{
+    QSet<const void *> counted;
+    qint64 usage = 0;
+    foreach(IPCScope *scope, mScopes){
+        usage += scope->zoomHistoryMemoryUsage();
+        for(int i = 0; i < scope->graphCount(); i++){
+            for(int c = 0; c < mcCount; c++){
+                usage += scope->graphMemoryUsage(i, (Category)c, &counted);
+            }
+        }
+    }
+    return usage;
+}
+
+/*!
+ * \brief IPCMemoryBudget::enforce. Reclaim memory until the usage fits the budget, one step after the other: halve the
+ * largest histories, compress the histories kept without compression, then drop the rebuildable caches. Return true
+ * if the usage fits the budget.
+ * \return
+ */
+bool IPCMemoryBudget::enforce()
+{
+    if(mBudget <= 0){
+        return true;
+    }
+    qint64 usage = memoryUsage();
+    if(usage <= mBudget){
+        return true;
+    }
+
+    struct GraphRef {
+        IPCScope *scope;
+        int graphIdx;
+        qint64 historyBytes;
+    };
+    QList<GraphRef> graphs;
+    foreach(IPCScope *scope, mScopes){
+        for(int i = 0; i < scope->graphCount(); i++){
+            IPCTraceHistory *history = scope->graphHistory(i);
+            graphs.append(GraphRef{scope, i, history ? history->memoryUsage() : 0});
+        }
+    }
+    // Largest histories first
+    std::sort(graphs.begin(), graphs.end(), [](const GraphRef &a, const GraphRef &b){return a.historyBytes > b.historyBytes;});
+
+    // 1. History depth
+    for(int i = 0; (i < graphs.count()) && (usage > mBudget); i++){
+        IPCTraceHistory *history = graphs.at(i).scope->graphHistory(graphs.at(i).graphIdx);
+        qint64 before = history ? history->memoryUsage() : 0;
+        if(before <= MinHistoryBytes){
+            continue;
+        }
+        history->setMemoryBudget(qMax(MinHistoryBytes, qMin(history->memoryBudget(), before)/2));
+        qint64 freed = before - history->memoryUsage();
+        usage -= freed;
+        emit budgetAction(graphs.at(i).scope, graphs.at(i).graphIdx, baHistoryDepthReduced, freed);
+    }
+
+    // 2. Half precision histories
+    for(int i = 0; (i < graphs.count()) && (usage > mBudget); i++){
+        IPCTraceHistory *history = graphs.at(i).scope->graphHistory(graphs.at(i).graphIdx);
+        if(!history || (history->compression() != IPCTraceHistory::hcNone)){
+            continue;
+        }
+        qint64 freed = history->compressStoredFrames(IPCTraceHistory::hcFloat16);
+        usage -= freed;
+        emit budgetAction(graphs.at(i).scope, graphs.at(i).graphIdx, baHistoryCompressed, freed);
+    }
+
+    // 3. Rebuildable caches: the zoom history renders, then the culling grids and hover indexes
+    foreach(IPCScope *scope, mScopes){
+        if(usage <= mBudget){
+            break;
+        }
+        qint64 freed = scope->releaseZoomRenders();
+        if(freed > 0){
+            usage -= freed;
+            emit budgetAction(scope, -1, baCachesDropped, freed);
+        }
+    }
+    for(int i = 0; (i < graphs.count()) && (usage > mBudget); i++){
+        qint64 freed = graphs.at(i).scope->releaseCaches(graphs.at(i).graphIdx);
+        if(freed > 0){
+            usage -= freed;
+            emit budgetAction(graphs.at(i).scope, graphs.at(i).graphIdx, baCachesDropped, freed);
+        }
+    }
+
+    if(usage > mBudget){
+        emit budgetExceeded(usage, mBudget);
+        return false;
+    }
+    return true;
+}
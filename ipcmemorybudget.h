@@ -0,0 +1,72 @@
+#ifndef IPCMEMORYBUDGET_H
+#define IPCMEMORYBUDGET_H
+
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+
+class IPCScope;
+
+/*
+ * Process wide memory accounting of the scopes, with an optional budget. Scopes register themselves on construction.
+ * When the budget is exceeded, the memory is reclaimed step by step until the usage fits: the trace histories are
+ * shortened, then the histories kept without compression are converted to half precision floats, then the culling
+ * grids, hover indexes and zoom history renders are dropped (they are rebuilt on demand). Each step taken is signaled.
+ */
+class IPCMemoryBudget : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IPCMemoryBudget(QObject *parent = nullptr);
+
+    enum Category { mcTraces        /// Graph data, and live data kept aside while a history frame is shown
+                   ,mcTraceModes    /// Held or averaged traces
+                   ,mcHistory       /// Trace histories
+                   ,mcCulling       /// Culled points handed to the renderer, culling grids and zoom history renders
+                   ,mcHoverIndex    /// Hover readout indexes
+                   ,mcSession       /// Restored traces not decoded yet
+                   ,mcCount
+                  };
+    Q_ENUMS(Category)
+
+    enum Action { baHistoryDepthReduced  /// A trace history kept fewer frames
+                 ,baHistoryCompressed    /// A trace history switched to half precision floats
+                 ,baCachesDropped        /// The culling grid and hover index of a graph, or the zoom history
+                                         /// renders of a scope (graph index -1), were dropped
+                };
+    Q_ENUMS(Action)
+
+    // Shared accounting of the application
+    static IPCMemoryBudget *instance();
+
+    // Registration
+    void registerScope(IPCScope *scope);
+    void unregisterScope(IPCScope *scope);
+
+    // Setters
+    void setBudget(qint64 bytes);
+    void setCheckInterval(int msec);
+
+    // Getters
+    qint64 budget() const {return mBudget;}
+    int checkInterval() const {return mTimer->interval();}
+    int scopeCount() const {return mScopes.count();}
+    qint64 memoryUsage(Category category) const;
+    qint64 memoryUsage() const;
+
+public slots:
+    bool enforce();
+
+signals:
+    void budgetAction(IPCScope *scope, int graphIdx, IPCMemoryBudget::Action action, qint64 freedBytes);
+    // Emitted when the usage still exceeds the budget once every step was taken
+    void budgetExceeded(qint64 usage, qint64 budget);
+
+private:
+    QSet<IPCScope *> mScopes;
+    // 0 when there is no budget
+    qint64 mBudget;
+    QTimer *mTimer;
+};
+
+#endif // IPCMEMORYBUDGET_H
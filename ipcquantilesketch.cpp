@@ -0,0 +1,299 @@
+#include "ipcquantilesketch.h"
+#include <QDebug>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+
+// Digits of the radix sort, in bits. Six passes cover the 64 bits of a key.
+static const int RadixBits = 11;
+static const int RadixPasses = 6;
+
+/*!
+ * \brief orderedKey. Return an integer key ordered as the value: the sign bit of a positive value is set, all the bits
+ * of a negative value are flipped.
+ * \param value
+ * \return
+ */
+static inline quint64 orderedKey(double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) ? ~bits : (bits | (Q_UINT64_C(1) << 63));
+}
+
+/*!
+ * \brief keyValue. Return the value of an ordered key.
+ * \param key
+ * \return
+ */
+static inline double keyValue(quint64 key)
+{
+    quint64 bits = (key >> 63) ? (key & ~(Q_UINT64_C(1) << 63)) : ~key;
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/*!
+ * \brief radixSort. Sort keys, least significant digit first, skipping the digits all keys share. About three times as
+ * fast as std::sort on the buffer of a sketch.
+ * \param keys
+ * \param count
+ * \param scratch count keys
+ * \return keys or scratch, whichever holds the sorted keys
+ */
+static quint64 *radixSort(quint64 *keys, int count, quint64 *scratch)
+{
+    static const int Buckets = 1 << RadixBits;
+    int histograms[RadixPasses][Buckets];
+    std::memset(histograms, 0, sizeof(histograms));
+    for(int i = 0; i < count; i++){
+        quint64 key = keys[i];
+        for(int pass = 0; pass < RadixPasses; pass++){
+            histograms[pass][(key >> (pass*RadixBits)) & (Buckets - 1)]++;
+        }
+    }
+    quint64 *source = keys;
+    quint64 *destination = scratch;
+    for(int pass = 0; pass < RadixPasses; pass++){
+        const int shift = pass*RadixBits;
+        int *histogram = histograms[pass];
+        if(histogram[(source[0] >> shift) & (Buckets - 1)] == count){
+            continue;
+        }
+        // Bucket counts to bucket offsets
+        int offset = 0;
+        for(int i = 0; i < Buckets; i++){
+            int bucketCount = histogram[i];
+            histogram[i] = offset;
+            offset += bucketCount;
+        }
+        for(int i = 0; i < count; i++){
+            quint64 key = source[i];
+            destination[histogram[(key >> shift) & (Buckets - 1)]++] = key;
+        }
+        std::swap(source, destination);
+    }
+    return source;
+}
+
+/*!
+ * \brief IPCQuantileSketch::IPCQuantileSketch. Constructor.
+ * \param compression Bound on the number of centroids (about compression/2 are used). Higher is more accurate.
+ */
+IPCQuantileSketch::IPCQuantileSketch(double compression) :
+    mCompression(compression),
+    mTotalWeight(0),
+    mMin(qQNaN()),
+    mMax(qQNaN())
+{
+    if(!(mCompression >= 10)){
+        qDebug() << Q_FUNC_INFO << "Compression must be at least 10:" << compression;
+        mCompression = 10;
+    }
+    // Large enough for the radix sort passes to pay off
+    mBufferSize = qMax(4096, qRound(mCompression * 8));
+}
+
+/*!
+ * \brief IPCQuantileSketch::add. Add a value. NaN values are ignored.
+ * \param value
+ */
+void IPCQuantileSketch::add(double value)
+{
+    add(&value, 1);
+}
+
+/*!
+ * \brief IPCQuantileSketch::add. Add count values. NaN values are ignored.
+ * \param values
+ * \param count
+ */
+void IPCQuantileSketch::add(const double *values, int count)
+{
+    int i = 0;
+    while(i < count){
+        // Fill the buffer, then merge it
+        int end = qMin(count, i + mBufferSize - mBuffer.size());
+        double low = mMin;
+        double high = mMax;
+        for(; i < end; i++){
+            double value = values[i];
+            if(std::isnan(value)){
+                continue;
+            }
+            mBuffer.append(orderedKey(value));
+            // NaN bounds of an empty sketch always lose the comparison
+            low = (value < low || std::isnan(low)) ? value : low;
+            high = (value > high || std::isnan(high)) ? value : high;
+        }
+        mMin = low;
+        mMax = high;
+        if(mBuffer.size() >= mBufferSize){
+            compress();
+        }
+    }
+}
+
+/*!
+ * \brief IPCQuantileSketch::merge. Add the values of another sketch. The result keeps the compression of this
+ * sketch.
+ * \param other
+ */
+void IPCQuantileSketch::merge(const IPCQuantileSketch &other)
+{
+    if(other.count() == 0){
+        return;
+    }
+    compress();
+    other.compress();
+    mScratch.resize(mCentroids.size() + other.mCentroids.size());
+    std::merge(mCentroids.constBegin(), mCentroids.constEnd(),
+               other.mCentroids.constBegin(), other.mCentroids.constEnd(),
+               mScratch.begin(), [](const Centroid &a, const Centroid &b) {return a.mean < b.mean;});
+    mergeSorted(mScratch, mTotalWeight + other.mTotalWeight);
+    mMin = (std::isnan(mMin) || other.mMin < mMin) ? other.mMin : mMin;
+    mMax = (std::isnan(mMax) || other.mMax > mMax) ? other.mMax : mMax;
+}
+
+/*!
+ * \brief IPCQuantileSketch::reset. Remove all the values.
+ */
+void IPCQuantileSketch::reset()
+{
+    mCentroids.clear();
+    mBuffer.clear();
+    mTotalWeight = 0;
+    mMin = qQNaN();
+    mMax = qQNaN();
+}
+
+/*!
+ * \brief IPCQuantileSketch::weightLimit. Return the cumulative weight the centroid starting at weightSoFar may extend
+ * to: one unit of the k1 scale function k(q) = compression/(2pi)*asin(2q-1) further.
+ * \param weightSoFar
+ * \param totalWeight
+ * \return
+ */
+double IPCQuantileSketch::weightLimit(double weightSoFar, double totalWeight) const
+{
+    double q = weightSoFar / totalWeight;
+    double k = mCompression / (2*M_PI) * std::asin(qBound(-1.0, 2*q - 1, 1.0)) + 1;
+    if(k >= mCompression / 4){
+        return totalWeight;
+    }
+    return (std::sin(k * 2*M_PI / mCompression) + 1) / 2 * totalWeight;
+}
+
+/*!
+ * \brief IPCQuantileSketch::mergeSorted. Replace the centroids by centroids sorted by mean, merging neighbours as long
+ * as the merged centroid stays within its weight limit.
+ * \param centroids Sorted by mean, must not be mCentroids
+ * \param totalWeight
+ */
+void IPCQuantileSketch::mergeSorted(const QVector<Centroid> &centroids, double totalWeight) const
+{
+    mCentroids.clear();
+    mTotalWeight = totalWeight;
+    if(centroids.isEmpty()){
+        return;
+    }
+    Centroid current = centroids.first();
+    double weightSoFar = 0;
+    double limit = weightLimit(0, totalWeight);
+    for(int i = 1; i < centroids.size(); i++){
+        const Centroid &next = centroids.at(i);
+        if(weightSoFar + current.weight + next.weight <= limit){
+            current.weight += next.weight;
+            current.mean += (next.mean - current.mean) * next.weight / current.weight;
+        } else{
+            weightSoFar += current.weight;
+            mCentroids.append(current);
+            limit = weightLimit(weightSoFar, totalWeight);
+            current = next;
+        }
+    }
+    mCentroids.append(current);
+}
+
+/*!
+ * \brief IPCQuantileSketch::compress. Sort the buffered values and merge them with the centroids.
+ */
+void IPCQuantileSketch::compress() const
+{
+    if(mBuffer.isEmpty()){
+        return;
+    }
+    mSortScratch.resize(mBuffer.size());
+    const quint64 *key = radixSort(mBuffer.data(), mBuffer.size(), mSortScratch.data());
+    const quint64 *keyEnd = key + mBuffer.size();
+    // Merge of two sorted lists, the buffered values being unit weight centroids
+    mScratch.resize(mCentroids.size() + mBuffer.size());
+    Centroid *out = mScratch.data();
+    const Centroid *centroid = mCentroids.constData();
+    const Centroid *centroidEnd = centroid + mCentroids.size();
+    while(key != keyEnd){
+        double value = keyValue(*key);
+        if((centroid != centroidEnd) && (centroid->mean <= value)){
+            *out++ = *centroid++;
+        } else{
+            out->mean = value;
+            out->weight = 1;
+            out++;
+            key++;
+        }
+    }
+    while(centroid != centroidEnd){
+        *out++ = *centroid++;
+    }
+    double totalWeight = mTotalWeight + mBuffer.size();
+    mBuffer.clear();
+    mergeSorted(mScratch, totalWeight);
+}
+
+/*!
+ * \brief IPCQuantileSketch::quantile. Return the value below which a fraction q of the values fall. The centroid means
+ * are taken at the middle of their weight, the minimum at 0 and the maximum at the total weight, and the quantile is
+ * interpolated linearly between them: quantiles of a few values are exact.
+ * \param q In [0, 1]
+ * \return
+ */
+double IPCQuantileSketch::quantile(double q) const
+{
+    if(count() == 0){
+        return qQNaN();
+    }
+    compress();
+    if(q <= 0){
+        return mMin;
+    }
+    if(q >= 1){
+        return mMax;
+    }
+    const double index = q * mTotalWeight;
+    double leftPos = 0;
+    double leftValue = mMin;
+    double weightSoFar = 0;
+    foreach(const Centroid &centroid, mCentroids){
+        double pos = weightSoFar + centroid.weight / 2;
+        if(index < pos){
+            double t = (index - leftPos) / (pos - leftPos);
+            return leftValue + t * (centroid.mean - leftValue);
+        }
+        leftPos = pos;
+        leftValue = centroid.mean;
+        weightSoFar += centroid.weight;
+    }
+    double t = (mTotalWeight > leftPos) ? (index - leftPos) / (mTotalWeight - leftPos) : 1;
+    return leftValue + t * (mMax - leftValue);
+}
+
+/*!
+ * \brief IPCQuantileSketch::centroidCount. Return the number of centroids once the buffered values are merged.
+ * \return
+ */
+int IPCQuantileSketch::centroidCount() const
+{
+    compress();
+    return mCentroids.size();
+}
@@ -0,0 +1,55 @@
+#ifndef IPCQUANTILESKETCH_H
+#define IPCQUANTILESKETCH_H
+
+#include <QtGlobal>
+#include <QVector>
+
+/*
+ * Streaming quantile estimator, a merging t-digest. Values are buffered, and the buffer is radix sorted and merged into
+ * a sorted list of centroids (mean, weight) when full. The weight a centroid may take is bounded by the k1 scale
+ * function, so centroids stay small in the tails: the rank error of a quantile is under a part per thousand, and
+ * shrinks towards the minimum and maximum. The memory is bounded by the compression, whatever the number of values, and
+ * two sketches merge into the sketch of both inputs, so sketches of frames or threads can be combined.
+ */
+class IPCQuantileSketch
+{
+public:
+    IPCQuantileSketch(double compression = 100);
+
+    void add(double value);
+    void add(const double *values, int count);
+    void merge(const IPCQuantileSketch &other);
+    void reset();
+
+    // Getters
+    double compression() const {return mCompression;}
+    double count() const {return mTotalWeight + mBuffer.size();}
+    double min() const {return mMin;}
+    double max() const {return mMax;}
+    // Value below which a fraction q of the values fall, NaN when empty
+    double quantile(double q) const;
+    int centroidCount() const;
+
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+    // Merge the buffered values into the centroids. Logically const, the sketch state is unchanged.
+    void compress() const;
+    void mergeSorted(const QVector<Centroid> &centroids, double totalWeight) const;
+    double weightLimit(double weightSoFar, double totalWeight) const;
+
+    double mCompression;
+    int mBufferSize;
+    mutable QVector<Centroid> mCentroids;
+    mutable double mTotalWeight;
+    // Buffered values, as order preserving integer keys
+    mutable QVector<quint64> mBuffer;
+    mutable QVector<quint64> mSortScratch;
+    mutable QVector<Centroid> mScratch;
+    double mMin;
+    double mMax;
+};
+
+#endif // IPCQUANTILESKETCH_H
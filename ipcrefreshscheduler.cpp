@@ -0,0 +1,166 @@
+#include "ipcrefreshscheduler.h"
+#include "ipcscope.h"
+#include <QApplication>
+#include <QScreen>
+#include <algorithm>
+
+IPCRefreshScheduler::IPCRefreshScheduler(QObject *parent) :
+    QObject(parent),
+    mMaxRefreshRate(60),
+    mMaxScopesPerFrame(0)
+{
+    // Align the frame rate on the display refresh rate
+    QScreen *screen = QGuiApplication::primaryScreen();
+    if(screen && screen->refreshRate() > 1){
+        mMaxRefreshRate = screen->refreshRate();
+    }
+    mFrameTimer.setSingleShot(true);
+    mFrameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&mFrameTimer, &QTimer::timeout, this, &IPCRefreshScheduler::onFrame);
+}
+
+/*!
+ * \brief IPCRefreshScheduler::instance. Return the scheduler shared by the application. It is created on first use
+ * and deleted with the application object.
+ * \return
+ */
+IPCRefreshScheduler *IPCRefreshScheduler::instance()
+{
+    static QPointer<IPCRefreshScheduler> sInstance;
+    if(!sInstance){
+        sInstance = new IPCRefreshScheduler(QCoreApplication::instance());
+    }
+    return sInstance;
+}
+
+/*!
+ * \brief IPCRefreshScheduler::registerScope. Add a scope to the scheduler. The scope is refreshed at the next frame.
+ * \param scope
+ * \param priority
+ */
+void IPCRefreshScheduler::registerScope(IPCScope *scope, Priority priority)
+{
+    if(!scope){
+        qDebug() << Q_FUNC_INFO << "null scope.";
+        return;
+    }
+    mPriorityHash.insert(scope, priority);
+    requestRefresh(scope);
+}
+
+/*!
+ * \brief IPCRefreshScheduler::unregisterScope. Remove a scope from the scheduler.
+ * \param scope
+ */
+void IPCRefreshScheduler::unregisterScope(IPCScope *scope)
+{
+    mPriorityHash.remove(scope);
+    mDirtySet.remove(scope);
+}
+
+/*!
+ * \brief IPCRefreshScheduler::setPriority. Change the priority of a registered scope.
+ * \param scope
+ * \param priority
+ */
+void IPCRefreshScheduler::setPriority(IPCScope *scope, Priority priority)
+{
+    if(!mPriorityHash.contains(scope)){
+        qDebug() << Q_FUNC_INFO << "scope isn't registered.";
+        return;
+    }
+    mPriorityHash.insert(scope, priority);
+}
+
+/*!
+ * \brief IPCRefreshScheduler::setMaxRefreshRate. Set the maximum number of frames per second.
+ * \param rate
+ */
+void IPCRefreshScheduler::setMaxRefreshRate(double rate)
+{
+    if(rate <= 0){
+        qDebug() << Q_FUNC_INFO << "Non positive rate:" << rate;
+        return;
+    }
+    mMaxRefreshRate = rate;
+}
+
+/*!
+ * \brief IPCRefreshScheduler::requestRefresh. Mark a scope dirty. Several requests before the next frame collapse into one repaint.
+ * \param scope
+ */
+void IPCRefreshScheduler::requestRefresh(IPCScope *scope)
+{
+    if(!mPriorityHash.contains(scope)){
+        return;
+    }
+    mDirtySet.insert(scope);
+    scheduleFrame();
+}
+
+/*!
+ * \brief IPCRefreshScheduler::scheduleFrame. Start the frame timer so that two frames are at least 1/maxRefreshRate apart.
+ */
+void IPCRefreshScheduler::scheduleFrame()
+{
+    if(mFrameTimer.isActive() || mDirtySet.isEmpty()){
+        return;
+    }
+    int interval = qRound(1000.0 / mMaxRefreshRate);
+    int delay = 0;
+    if(mLastFrame.isValid()){
+        delay = qMax(0, interval - (int)mLastFrame.elapsed());
+    }
+    mFrameTimer.start(delay);
+}
+
+/*!
+ * \brief IPCRefreshScheduler::rank. Order in which the scopes are served: focused scopes first, then by priority.
+ * Hidden scopes have a negative rank, they are not repainted.
+ * \param scope
+ * \return
+ */
+int IPCRefreshScheduler::rank(IPCScope *scope) const
+{
+    if(!scope->isVisible() || scope->visibleRegion().isEmpty()){
+        return -1;
+    }
+    QWidget *focusWidget = QApplication::focusWidget();
+    if(focusWidget && (focusWidget == scope || scope->isAncestorOf(focusWidget))){
+        return rpHigh + 1;
+    }
+    return mPriorityHash.value(scope, rpNormal);
+}
+
+/*!
+ * \brief IPCRefreshScheduler::onFrame. Repaint the dirty scopes in one pass.
+ */
+void IPCRefreshScheduler::onFrame()
+{
+    mLastFrame.start();
+
+    QList<QPair<int, IPCScope *> > rankedList;
+    foreach(IPCScope *scope, mDirtySet){
+        int r = rank(scope);
+        if(r >= 0){
+            rankedList.append(qMakePair(r, scope));
+        }
+    }
+    std::stable_sort(rankedList.begin(), rankedList.end(),
+                     [](const QPair<int, IPCScope *> &a, const QPair<int, IPCScope *> &b){return a.first > b.first;});
+
+    int count = rankedList.length();
+    if(mMaxScopesPerFrame > 0){
+        count = qMin(count, mMaxScopesPerFrame);
+    }
+    for(int i = 0; i < count; i++){
+        IPCScope *scope = rankedList.at(i).second;
+        mDirtySet.remove(scope);
+        // The updates of all the scopes are merged into one paint pass per window
+        scope->viewport()->update();
+    }
+    // Scopes left over (rate cap) are served at the next frame. Hidden scopes stay dirty until they are shown.
+    if(rankedList.length() > count){
+        scheduleFrame();
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef IPCREFRESHSCHEDULER_H
+#define IPCREFRESHSCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class IPCScope;
+
+/*
+ * A refresh scheduler coordinates the repaints of many scopes. Registered scopes do not repaint their viewport
+ * on each change anymore, they are marked dirty instead. Once per display frame, the scheduler repaints the dirty
+ * scopes in one pass: focused scopes first, then by priority. Hidden scopes stay dirty until they are shown.
+ */
+class IPCRefreshScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IPCRefreshScheduler(QObject *parent = nullptr);
+
+    enum Priority { rpLow       /// Served after the other scopes
+                   ,rpNormal    /// Default priority
+                   ,rpHigh      /// Served before the other scopes (focused scopes are always served first)
+                  };
+    Q_ENUMS(Priority)
+
+    // Shared scheduler of the application
+    static IPCRefreshScheduler *instance();
+
+    // Registration
+    void registerScope(IPCScope *scope, Priority priority = rpNormal);
+    void unregisterScope(IPCScope *scope);
+    bool isRegistered(IPCScope *scope) const {return mPriorityHash.contains(scope);}
+    void requestRefresh(IPCScope *scope);
+
+    // Setters
+    void setPriority(IPCScope *scope, Priority priority);
+    void setMaxRefreshRate(double rate);
+    void setMaxScopesPerFrame(int count){mMaxScopesPerFrame = count;}
+
+    // Getters
+    Priority priority(IPCScope *scope) const {return mPriorityHash.value(scope, rpNormal);}
+    double maxRefreshRate() const {return mMaxRefreshRate;}
+    int maxScopesPerFrame() const {return mMaxScopesPerFrame;}
+    int dirtyCount() const {return mDirtySet.count();}
+
+private slots:
+    void onFrame();
+
+private:
+    void scheduleFrame();
+    int rank(IPCScope *scope) const;
+
+    // Registered scopes and their priority
+    QHash<IPCScope *, Priority> mPriorityHash;
+    // Scopes waiting for a repaint
+    QSet<IPCScope *> mDirtySet;
+    // Frame timer and time of the last frame
+    QTimer mFrameTimer;
+    QElapsedTimer mLastFrame;
+    // Maximum number of frames per second
+    double mMaxRefreshRate;
+    // Maximum number of scopes repainted in one frame, 0 for no limit
+    int mMaxScopesPerFrame;
+};
+
+#endif // IPCREFRESHSCHEDULER_H
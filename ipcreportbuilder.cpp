@@ -0,0 +1,192 @@
+#include "ipcreportbuilder.h"
+#include <QPainter>
+#include <QFontMetricsF>
+#include <QThread>
+#include <QtConcurrent>
+#include <QtPrintSupport/QPrinter>
+#include <QDebug>
+
+/*!
+ * \brief IPCReportBuilder::IPCReportBuilder. Constructor. Two plots per A4 portrait page by default.
+ */
+IPCReportBuilder::IPCReportBuilder() :
+    mColumns(1),
+    mRows(2),
+    mPageSize(QPageSize::A4),
+    mOrientation(QPageLayout::Portrait),
+    mMargins(15, 15, 15, 15)
+{
+
+}
+
+/*!
+ * \brief IPCReportBuilder::setGrid. Set the number of plots per page, as columns and rows.
+ * \param columns
+ * \param rows
+ */
+void IPCReportBuilder::setGrid(int columns, int rows)
+{
+    if(columns < 1 || rows < 1){
+        qDebug() << Q_FUNC_INFO << "invalid grid:" << columns << rows;
+        return;
+    }
+    mColumns = columns;
+    mRows = rows;
+}
+
+/*!
+ * \brief IPCReportBuilder::addScope. Snapshot a scope as currently shown: view, caption and marker table. Must be called
+ * in the GUI thread. The scope can be modified or deleted afterwards. Return the index of the plot.
+ * \param scope
+ * \param caption
+ */
+int IPCReportBuilder::addScope(IPCScope *scope, const QString &caption)
+{
+    if(!scope){
+        qDebug() << Q_FUNC_INFO << "null scope";
+        return -1;
+    }
+    Plot plot;
+    plot.picture = scope->toPicture();
+    plot.size = scope->size();
+    plot.caption = caption.isEmpty() ? scope->name() : caption;
+    // The table isn't created for a scope without markers
+    if(scope->markerCount() > 0){
+        IPCMarkerTable *table = scope->markerTable();
+        if(!table->isHidden()){
+            plot.tablePos = table->pos();
+            plot.table = table->cells();
+        }
+    }
+    mPlots.append(plot);
+    return mPlots.size() - 1;
+}
+
+/*!
+ * \brief IPCReportBuilder::clear. Remove all the plots.
+ */
+void IPCReportBuilder::clear()
+{
+    mPlots.clear();
+}
+
+/*!
+ * \brief IPCReportBuilder::pageCount. Return the number of pages of the report.
+ */
+int IPCReportBuilder::pageCount() const
+{
+    int perPage = mColumns*mRows;
+    return (mPlots.size() + perPage - 1)/perPage;
+}
+
+/*!
+ * \brief IPCReportBuilder::composePage. Record a page: plots scaled to their grid cell with their caption and marker
+ * table, then the title and page number in the footer. Thread safe, each page is composed by one thread.
+ * \param page
+ * \param paintRect Printable area, in device pixels
+ */
+QPicture IPCReportBuilder::composePage(int page, const QRectF &paintRect) const
+{
+    QPicture picture;
+    QPainter painter(&picture);
+    QFontMetricsF captionMetrics(mCaptionFont);
+    const double lineHeight = captionMetrics.height();
+    const double footerHeight = 1.5*lineHeight;
+    const double cellWidth = paintRect.width()/mColumns;
+    const double cellHeight = (paintRect.height() - footerHeight)/mRows;
+    const int perPage = mColumns*mRows;
+
+    painter.setFont(mCaptionFont);
+    for(int slot = 0; slot < perPage; slot++){
+        int plotIdx = page*perPage + slot;
+        if(plotIdx > mPlots.size()-1){
+            break;
+        }
+        const Plot &plot = mPlots.at(plotIdx);
+        QRectF cell(paintRect.left() + (slot % mColumns)*cellWidth, paintRect.top() + (slot / mColumns)*cellHeight,
+                    cellWidth, cellHeight);
+        cell.adjust(lineHeight/2, lineHeight/2, -lineHeight/2, -lineHeight/2);
+        if(!plot.caption.isEmpty()){
+            painter.setPen(Qt::black);
+            painter.drawText(QRectF(cell.left(), cell.top(), cell.width(), lineHeight), Qt::AlignHCenter | Qt::AlignVCenter,
+                             captionMetrics.elidedText(plot.caption, Qt::ElideRight, cell.width()));
+            cell.setTop(cell.top() + lineHeight);
+        }
+        if(plot.size.isEmpty() || cell.isEmpty()){
+            continue;
+        }
+        double scale = qMin(cell.width()/plot.size.width(), cell.height()/plot.size.height());
+        painter.save();
+        painter.translate(cell.center());
+        painter.scale(scale, scale);
+        painter.translate(-plot.size.width()/2, -plot.size.height()/2);
+        painter.setClipRect(QRectF(QPointF(0, 0), plot.size));
+        painter.drawPicture(0, 0, plot.picture);
+        if(!plot.table.isEmpty()){
+            painter.translate(plot.tablePos);
+            IPCMarkerTable::paintCells(&painter, plot.table);
+        }
+        painter.restore();
+    }
+
+    QRectF footer(paintRect.left(), paintRect.bottom() - footerHeight, paintRect.width(), footerHeight);
+    painter.setPen(Qt::black);
+    if(!mTitle.isEmpty()){
+        painter.drawText(footer, Qt::AlignLeft | Qt::AlignBottom, mTitle);
+    }
+    painter.drawText(footer, Qt::AlignRight | Qt::AlignBottom, QString("%1 / %2").arg(page + 1).arg(pageCount()));
+    painter.end();
+    return picture;
+}
+
+/*!
+ * \brief IPCReportBuilder::write. Write the report to a PDF file. Pages are composed in parallel, by batches, and
+ * printed in order through a single printer.
+ * \param fileName
+ * \return
+ */
+bool IPCReportBuilder::write(const QString &fileName)
+{
+    if(mPlots.isEmpty()){
+        qDebug() << Q_FUNC_INFO << "no plot to write";
+        return false;
+    }
+    // Screen resolution, as the scopes were recorded, like IPCScope::savePdf()
+    QPrinter printer(QPrinter::ScreenResolution);
+    printer.setOutputFileName(fileName);
+    printer.setOutputFormat(QPrinter::PdfFormat);
+    printer.setColorMode(QPrinter::Color);
+    printer.setPageLayout(QPageLayout(QPageSize(mPageSize), mOrientation, mMargins, QPageLayout::Millimeter));
+    printer.printEngine()->setProperty(QPrintEngine::PPK_Creator, mCreator);
+    printer.printEngine()->setProperty(QPrintEngine::PPK_DocumentName, mTitle);
+
+    QPainter painter;
+    if(!painter.begin(&printer)){
+        qDebug() << Q_FUNC_INFO << "Couldn't open" << fileName;
+        return false;
+    }
+    // The painter origin is the top left of the printable area
+    const QRectF paintRect(QPointF(0, 0), printer.pageLayout().paintRectPixels(printer.resolution()).size());
+    const int pages = pageCount();
+    // Batches bound the memory held by composed pages
+    const int batch = 2*qMax(1, QThread::idealThreadCount());
+    for(int first = 0; first < pages; first += batch){
+        QVector<int> pageIdx(qMin(batch, pages - first));
+        for(int i = 0; i < pageIdx.size(); i++){
+            pageIdx[i] = first + i;
+        }
+        QVector<QPicture> pagePictures(pageIdx.size());
+        QtConcurrent::blockingMap(pageIdx, [&](int page){
+            pagePictures[page - first] = composePage(page, paintRect);
+        });
+        for(int i = 0; i < pagePictures.size(); i++){
+            if((first + i > 0) && !printer.newPage()){
+                qDebug() << Q_FUNC_INFO << "Couldn't add page" << first + i;
+                painter.end();
+                return false;
+            }
+            painter.drawPicture(0, 0, pagePictures.at(i));
+        }
+    }
+    return painter.end();
+}
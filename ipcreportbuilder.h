@@ -0,0 +1,71 @@
+#ifndef IPCREPORTBUILDER_H
+#define IPCREPORTBUILDER_H
+
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QPicture>
+#include <QFont>
+#include <QMarginsF>
+#include <QPageSize>
+#include <QPageLayout>
+#include "ipcscope.h"
+
+/*
+ * Multi-page PDF report of many scopes, laid out on a grid of plots per page. Scopes are snapshotted by addScope(), in
+ * the GUI thread: the view is recorded into a QPicture and the marker table is kept as text, painted natively instead
+ * of through HTML (see IPCMarkerTable::paintCells()). write() composes the pages in parallel, then streams them to a
+ * single PDF, through a single painter, so fonts and other resources are embedded once for the whole report.
+ */
+class IPCReportBuilder
+{
+public:
+    IPCReportBuilder();
+
+    // Layout
+    void setGrid(int columns, int rows);
+    void setPageSize(QPageSize::PageSizeId size){mPageSize = size;}
+    void setPageOrientation(QPageLayout::Orientation orientation){mOrientation = orientation;}
+    // Margins, in millimeters
+    void setMargins(const QMarginsF &margins){mMargins = margins;}
+    void setCaptionFont(const QFont &font){mCaptionFont = font;}
+    // Document properties
+    void setTitle(const QString &title){mTitle = title;}
+    void setCreator(const QString &creator){mCreator = creator;}
+
+    // Content. The caption defaults to the name of the scope.
+    int addScope(IPCScope *scope, const QString &caption = QString());
+    void clear();
+
+    // Getters
+    int columns() const {return mColumns;}
+    int rows() const {return mRows;}
+    int plotCount() const {return mPlots.size();}
+    int pageCount() const;
+
+    bool write(const QString &fileName);
+
+private:
+    // Snapshot of a scope
+    struct Plot {
+        QPicture picture;
+        QSizeF size;
+        QString caption;
+        QPointF tablePos;
+        IPCMarkerTable::Cells table;
+    };
+
+    QPicture composePage(int page, const QRectF &paintRect) const;
+
+    QList<Plot> mPlots;
+    int mColumns;
+    int mRows;
+    QPageSize::PageSizeId mPageSize;
+    QPageLayout::Orientation mOrientation;
+    QMarginsF mMargins;
+    QFont mCaptionFont;
+    QString mTitle;
+    QString mCreator;
+};
+
+#endif // IPCREPORTBUILDER_H
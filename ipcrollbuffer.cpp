@@ -0,0 +1,109 @@
+#include "ipcrollbuffer.h"
+#include <QDebug>
+
+/*!
+ * \brief IPCRollBuffer::IPCRollBuffer. Constructor.
+ * \param capacity Maximum number of points held
+ */
+IPCRollBuffer::IPCRollBuffer(int capacity) :
+    mHead(0),
+    mCount(0),
+    mAppendCount(0)
+{
+    setCapacity(capacity);
+}
+
+/*!
+ * \brief IPCRollBuffer::setCapacity. Change the capacity, keeping the most recent points.
+ * \param capacity
+ */
+void IPCRollBuffer::setCapacity(int capacity)
+{
+    if(capacity < 0){
+        qDebug() << Q_FUNC_INFO << "Negative capacity:" << capacity;
+        return;
+    }
+    int kept = qMin(mCount, capacity);
+    QVector<QPointF> points(capacity);
+    for(int i = 0; i < kept; i++){
+        points[i] = at(mCount - kept + i);
+    }
+    mPoints = points;
+    mHead = 0;
+    mCount = kept;
+}
+
+/*!
+ * \brief IPCRollBuffer::append. Append a point, overwriting the oldest one if the buffer is full.
+ * \param point
+ */
+void IPCRollBuffer::append(const QPointF &point)
+{
+    const int capacity = mPoints.size();
+    if(capacity == 0){
+        return;
+    }
+    if(mCount < capacity){
+        int idx = mHead + mCount;
+        mPoints[idx < capacity ? idx : idx - capacity] = point;
+        mCount++;
+    } else{
+        mPoints[mHead] = point;
+        mHead = (mHead + 1 < capacity) ? mHead + 1 : 0;
+    }
+    mAppendCount++;
+}
+
+/*!
+ * \brief IPCRollBuffer::clear. Remove all the points, keeping the capacity.
+ */
+void IPCRollBuffer::clear()
+{
+    mHead = 0;
+    mCount = 0;
+}
+
+/*!
+ * \brief IPCRollBuffer::at. Return a point, index 0 being the oldest.
+ * \param i
+ */
+const QPointF &IPCRollBuffer::at(int i) const
+{
+    int idx = mHead + i;
+    return mPoints.at(idx < mPoints.size() ? idx : idx - mPoints.size());
+}
+
+/*!
+ * \brief IPCRollBuffer::lowerBound. Return the index of the first point with x >= x, searching from index from.
+ * \param x
+ * \param from
+ */
+int IPCRollBuffer::lowerBound(double x, int from) const
+{
+    int low = qMax(0, from);
+    int high = mCount;
+    while(low < high){
+        int middle = low + (high - low) / 2;
+        if(at(middle).x() < x){
+            low = middle + 1;
+        } else{
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/*!
+ * \brief IPCRollBuffer::points. Return the points from index from to the most recent one, oldest first.
+ * \param from
+ */
+QVector<QPointF> IPCRollBuffer::points(int from) const
+{
+    from = qBound(0, from, mCount);
+    QVector<QPointF> result(mCount - from);
+    QPointF *out = result.data();
+    for(int i = from; i < mCount; i++){
+        *out++ = at(i);
+    }
+    return result;
+}
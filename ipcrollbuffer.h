@@ -0,0 +1,40 @@
+#ifndef IPCROLLBUFFER_H
+#define IPCROLLBUFFER_H
+
+#include <QVector>
+#include <QPointF>
+
+/*
+ * Fixed capacity ring of points, for graphs in roll mode. Appending is O(1): once full, each new point overwrites
+ * the oldest one. Points are expected in increasing x order (time), which allows binary searches on x.
+ */
+class IPCRollBuffer
+{
+public:
+    explicit IPCRollBuffer(int capacity = 0);
+
+    void setCapacity(int capacity);
+    void append(const QPointF &point);
+    void clear();
+
+    // Getters. Index 0 is the oldest point.
+    int capacity() const {return mPoints.size();}
+    int count() const {return mCount;}
+    bool isEmpty() const {return mCount == 0;}
+    const QPointF &at(int i) const;
+    const QPointF &first() const {return at(0);}
+    const QPointF &last() const {return at(mCount - 1);}
+    quint64 appendCount() const {return mAppendCount;}
+    int lowerBound(double x, int from = 0) const;
+    QVector<QPointF> points(int from = 0) const;
+    qint64 memoryUsage() const {return (qint64)mPoints.capacity()*sizeof(QPointF);}
+
+private:
+    QVector<QPointF> mPoints;
+    // Index of the oldest point, and number of points held
+    int mHead;
+    int mCount;
+    quint64 mAppendCount;
+};
+
+#endif // IPCROLLBUFFER_H
@@ -0,0 +1,177 @@
+#include "ipcsampleconverter.h"
+#include <cstring>
+// The SSE2 stores write a point as two doubles
+#if defined(__SSE2__) && !defined(QT_COORD_TYPE)
+#define IPC_SAMPLE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef IPC_SAMPLE_SSE2
+/*
+ * Two consecutive samples, converted to doubles.
+ */
+static inline __m128d loadPair(const double *p)
+{
+    return _mm_loadu_pd(p);
+}
+
+static inline __m128d loadPair(const float *p)
+{
+    return _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(p))));
+}
+
+static inline __m128d loadPair(const qint32 *p)
+{
+    return _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+}
+
+static inline __m128d loadPair(const qint16 *p)
+{
+    qint32 bits;
+    memcpy(&bits, p, sizeof(bits));
+    __m128i v = _mm_cvtsi32_si128(bits);
+    // Sign extension of the two 16 bits samples
+    return _mm_cvtepi32_pd(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+}
+#endif
+
+/*!
+ * \brief convertSamples. Scale one channel of samples into points.
+ */
+template <typename T>
+static void convertSamples(const T *samples, int count, int stride, double gain, double offset, double x0, double dx,
+                           QPointF *points)
+{
+    int i = 0;
+#ifdef IPC_SAMPLE_SSE2
+    if(stride == 1){
+        const __m128d g = _mm_set1_pd(gain);
+        const __m128d o = _mm_set1_pd(offset);
+        const __m128d start = _mm_set1_pd(x0);
+        const __m128d step = _mm_set1_pd(dx);
+        double *out = reinterpret_cast<double *>(points);
+        for(; i + 1 < count; i += 2){
+            __m128d y = _mm_add_pd(_mm_mul_pd(loadPair(samples + i), g), o);
+            __m128d x = _mm_add_pd(start, _mm_mul_pd(_mm_set_pd(i + 1, i), step));
+            _mm_storeu_pd(out + 2*i, _mm_unpacklo_pd(x, y));
+            _mm_storeu_pd(out + 2*i + 2, _mm_unpackhi_pd(x, y));
+        }
+    }
+#endif
+    for(; i < count; i++){
+        points[i] = QPointF(x0 + i*dx, gain*double(samples[qint64(i)*stride]) + offset);
+    }
+}
+
+/*!
+ * \brief deinterleaveSamples. Scale interleaved channels into one point array per channel, frame by frame.
+ */
+template <typename T>
+static void deinterleaveSamples(const T *samples, int frames, int channels, const double *gains, const double *offsets,
+                                double x0, double dx, QPointF *const *points)
+{
+    for(int i = 0; i < frames; i++){
+        const T *frame = samples + qint64(i)*channels;
+        const double x = x0 + i*dx;
+        int c = 0;
+#ifdef IPC_SAMPLE_SSE2
+        const __m128d xx = _mm_set1_pd(x);
+        for(; c + 1 < channels; c += 2){
+            __m128d y = _mm_add_pd(_mm_mul_pd(loadPair(frame + c), _mm_loadu_pd(gains + c)), _mm_loadu_pd(offsets + c));
+            _mm_storeu_pd(reinterpret_cast<double *>(points[c] + i), _mm_unpacklo_pd(xx, y));
+            _mm_storeu_pd(reinterpret_cast<double *>(points[c+1] + i), _mm_unpackhi_pd(xx, y));
+        }
+#endif
+        for(; c < channels; c++){
+            points[c][i] = QPointF(x, gains[c]*double(frame[c]) + offsets[c]);
+        }
+    }
+}
+
+/*!
+ * \brief IPCSampleConverter::convert. Scale count 16 bits samples, read every stride values, into points.
+ * \param samples
+ * \param count
+ * \param stride
+ * \param gain
+ * \param offset
+ * \param x0 x of the first sample
+ * \param dx x step between samples
+ * \param points count points
+ */
+void IPCSampleConverter::convert(const qint16 *samples, int count, int stride, double gain, double offset, double x0,
+                                 double dx, QPointF *points)
+{
+    convertSamples(samples, count, stride, gain, offset, x0, dx, points);
+}
+
+/*!
+ * \brief IPCSampleConverter::convert. Scale count 32 bits samples, read every stride values, into points.
+ */
+void IPCSampleConverter::convert(const qint32 *samples, int count, int stride, double gain, double offset, double x0,
+                                 double dx, QPointF *points)
+{
+    convertSamples(samples, count, stride, gain, offset, x0, dx, points);
+}
+
+/*!
+ * \brief IPCSampleConverter::convert. Scale count float samples, read every stride values, into points.
+ */
+void IPCSampleConverter::convert(const float *samples, int count, int stride, double gain, double offset, double x0,
+                                 double dx, QPointF *points)
+{
+    convertSamples(samples, count, stride, gain, offset, x0, dx, points);
+}
+
+/*!
+ * \brief IPCSampleConverter::convert. Scale count double samples, read every stride values, into points.
+ */
+void IPCSampleConverter::convert(const double *samples, int count, int stride, double gain, double offset, double x0,
+                                 double dx, QPointF *points)
+{
+    convertSamples(samples, count, stride, gain, offset, x0, dx, points);
+}
+
+/*!
+ * \brief IPCSampleConverter::deinterleave. Split interleaved 16 bits samples into one scaled point array per channel.
+ * \param samples frames*channels samples
+ * \param frames
+ * \param channels
+ * \param gains One gain per channel
+ * \param offsets One offset per channel
+ * \param x0 x of the first frame
+ * \param dx x step between frames
+ * \param points One array of frames points per channel
+ */
+void IPCSampleConverter::deinterleave(const qint16 *samples, int frames, int channels, const double *gains,
+                                      const double *offsets, double x0, double dx, QPointF *const *points)
+{
+    deinterleaveSamples(samples, frames, channels, gains, offsets, x0, dx, points);
+}
+
+/*!
+ * \brief IPCSampleConverter::deinterleave. Split interleaved 32 bits samples into one scaled point array per channel.
+ */
+void IPCSampleConverter::deinterleave(const qint32 *samples, int frames, int channels, const double *gains,
+                                      const double *offsets, double x0, double dx, QPointF *const *points)
+{
+    deinterleaveSamples(samples, frames, channels, gains, offsets, x0, dx, points);
+}
+
+/*!
+ * \brief IPCSampleConverter::deinterleave. Split interleaved float samples into one scaled point array per channel.
+ */
+void IPCSampleConverter::deinterleave(const float *samples, int frames, int channels, const double *gains,
+                                      const double *offsets, double x0, double dx, QPointF *const *points)
+{
+    deinterleaveSamples(samples, frames, channels, gains, offsets, x0, dx, points);
+}
+
+/*!
+ * \brief IPCSampleConverter::deinterleave. Split interleaved double samples into one scaled point array per channel.
+ */
+void IPCSampleConverter::deinterleave(const double *samples, int frames, int channels, const double *gains,
+                                      const double *offsets, double x0, double dx, QPointF *const *points)
+{
+    deinterleaveSamples(samples, frames, channels, gains, offsets, x0, dx, points);
+}
@@ -0,0 +1,37 @@
+#ifndef IPCSAMPLECONVERTER_H
+#define IPCSAMPLECONVERTER_H
+
+#include <QtGlobal>
+#include <QPointF>
+
+/*
+ * Conversion of raw digitizer samples (int16, int32, float, double) into graph points in a single pass: each sample
+ * is scaled (y = gain*sample + offset) and written with its x (x0 + i*dx) straight into the point storage, without
+ * intermediate arrays. Interleaved blocks are split into one point array per channel in the same pass. SSE2 converts
+ * and scales two samples per instruction.
+ */
+class IPCSampleConverter
+{
+public:
+    // One channel: count samples read every stride values
+    static void convert(const qint16 *samples, int count, int stride, double gain, double offset, double x0, double dx,
+                        QPointF *points);
+    static void convert(const qint32 *samples, int count, int stride, double gain, double offset, double x0, double dx,
+                        QPointF *points);
+    static void convert(const float *samples, int count, int stride, double gain, double offset, double x0, double dx,
+                        QPointF *points);
+    static void convert(const double *samples, int count, int stride, double gain, double offset, double x0, double dx,
+                        QPointF *points);
+
+    // Interleaved channels: frame i holds one sample per channel, channel c is written to points[c]
+    static void deinterleave(const qint16 *samples, int frames, int channels, const double *gains, const double *offsets,
+                             double x0, double dx, QPointF *const *points);
+    static void deinterleave(const qint32 *samples, int frames, int channels, const double *gains, const double *offsets,
+                             double x0, double dx, QPointF *const *points);
+    static void deinterleave(const float *samples, int frames, int channels, const double *gains, const double *offsets,
+                             double x0, double dx, QPointF *const *points);
+    static void deinterleave(const double *samples, int frames, int channels, const double *gains, const double *offsets,
+                             double x0, double dx, QPointF *const *points);
+};
+
+#endif // IPCSAMPLECONVERTER_H
@@ -1,20 +1,58 @@
 #include "ipcscope.h"
+#include "ipcimagestreamwriter.h"
+#include "ipcaxismapping.h"
+#include <QtConcurrent>
+#include <QSvgGenerator>
+#include <QFileInfo>
 
 QT_CHARTS_USE_NAMESPACE
 
+// Session stream identification, "IPCS", and format version
+static const quint32 SessionMagic = 0x53435049;
+static const quint16 SessionVersion = 1;
+// Memory of the bands exportTiled() renders ahead of the writer
+static const qint64 TiledExportPendingBytes = 64 << 20;
+
 IPCScope::IPCScope(QWidget *parent, ScopeType scopeType) :
     QGraphicsView(new QGraphicsScene, parent),
     mScopeName(""),
     mOpenGLEnabled(false),
     mActiveGraphIdx(-1),
     mActiveMarkerIdx(-1),
+    mMarkerTable(nullptr),
     mMarkerTableVisible(true),
+    mStatisticsTable(nullptr),
+    mStatisticsTableVisible(false),
+    mStatisticsTablePending(false),
     mZoomDirection(zdBothDirections),
     mZoomWeight(0.9),
     mZoomRangeX(0.1,1),
     mZoomRangeY(0.1,1),
-    mLegendVisible(true)
+    mRubberBand(nullptr),
+    mZoomHistoryIdx(-1),
+    mZoomHistoryDepth(16),
+    mZoomFrameItem(nullptr),
+    mZoomCullGeneration(0),
+    mLegendVisible(true),
+    mCullingEnabled(false),
+    mDecimationEnabled(false),
+    mRecullPending(false),
+    mHoverReadoutEnabled(false),
+    mHoverRadius(20),
+    mReplayTimer(nullptr),
+    mReplayGraph(nullptr),
+    mReplayFrameIdx(0),
+    mReplayLastFrameIdx(0),
+    mRollSpan(60.0),
+    mRollScrollX(-qInf()),
+    mModelSyncing(false),
+    mModelZoomPending(false),
+    mControlServer(nullptr),
+    mConstructionTime(0),
+    mDeferredSetupTime(0)
 {
+    QElapsedTimer timer;
+    timer.start();
     this->setRenderHint(QPainter::NonCosmeticDefaultPen);
     mBaseFont = QFont("Times new roman", 14, 1, false);
     mMarkerFont = QFont("Arial", 12, 1, false);
@@ -73,10 +111,19 @@ IPCScope::IPCScope(QWidget *parent, ScopeType scopeType) :
     foreach(QAbstractAxis *axis, mAxesList){
         axis->setLabelsFont(mBaseFont);
     }
+    /* Default theme is dark. Applied before the axes are attached and the chart is added to the scene, so that the
+     * pens and brushes don't trigger layouts; settings made afterwards are kept. */
+    setScopeThemeDark();
 
     /* Attach the axes to the chart */
     mChart->addAxis(mAxesList.at(0), Qt::AlignBottom);
     mChart->addAxis(mAxesList.at(1), Qt::AlignLeft);
+    /* Re-cull the graphs when the axes' range is changed from outside of the scope. Deferred so that x and y changes
+     * are handled once. */
+    foreach(QAbstractAxis *axis, mAxesList){
+        connect(axis, SIGNAL(rangeChanged(qreal,qreal)), this, SLOT(onAxisRangeChanged()));
+    }
+    mDefaultRange = visibleRange();
 
     /* Add chart into the scene */
     scene()->addItem(mChart);
@@ -93,30 +140,28 @@ IPCScope::IPCScope(QWidget *parent, ScopeType scopeType) :
     mLegendPos = lpTopRight;
     updateLegendPosition();
 
-    /* Create a rubber band to show the zoom area */
-    mRubberBand = new QRubberBand(QRubberBand::Rectangle, this);
+    /* The rubber band and the marker table are created on first use */
     mRubberBandOrigin.setX(0);
     mRubberBandOrigin.setY(0);
-    mRubberBand->setGeometry(QRect(mRubberBandOrigin, QSize()));
-    mRubberBand->hide();
-    QPalette palette;
-    QColor color(0,202,0);
-    color.setAlphaF(0.4);
-    palette.setColor(QPalette::Active, QPalette::Highlight, color);
-    mRubberBand->setPalette(palette);
-
-    /* Create a marker table widget */
-    mMarkerTable = new IPCMarkerTable(this);
     mMarkerTablePos = mpTopMidle;
-    mMarkerTable->setFont(mMarkerFont);
-    updateMarkerTablePosition();
-    /* Default theme is dark */
-    mScopeTheme = stDark;
-    setScopeThemeDark();
+    /* Process wide memory accounting */
+    mMemoryBudget = IPCMemoryBudget::instance();
+    mMemoryBudget->registerScope(this);
+    mConstructionTime = timer.nsecsElapsed();
 }
 
 IPCScope::~IPCScope()
 {
+    delete mControlServer;
+    if(mMemoryBudget){
+        mMemoryBudget->unregisterScope(this);
+    }
+    qDeleteAll(mCullerHash);
+    qDeleteAll(mIndexHash);
+    qDeleteAll(mSpectrumHash);
+    if(mRefreshScheduler){
+        mRefreshScheduler->unregisterScope(this);
+    }
     delete mChart;
 
     foreach(QAbstractAxis *axis, mAxesList){
@@ -127,6 +172,28 @@ IPCScope::~IPCScope()
     }
 }
 
+/*!
+ * \brief IPCScope::resetForReuse. Bring the scope back to the state of a new scope: what it shows, what it is connected
+ * to and its ranges. The theme, fonts and options are kept.
+ */
+void IPCScope::resetForReuse()
+{
+    // Link groups drop the scope
+    emit aboutToBeReused();
+    setModel(nullptr);
+    stopReplay();
+    stopControlServer();
+    clearMarkers();
+    clearGraphs();
+    setName(QString());
+    setRollSpan(60.0);
+    clearZoomHistory();
+    setStatisticsTableVisible(false);
+    mAxesList.at(0)->setRange(mDefaultRange.left(), mDefaultRange.right());
+    mAxesList.at(1)->setRange(mDefaultRange.top(), mDefaultRange.bottom());
+    cosmeticTicksInterval();
+}
+
 /*!
  * \brief IPCScope::updateLegendPosition. Update the legend position in the scope.
  */
@@ -177,6 +244,9 @@ void IPCScope::updateLegendPosition()
  */
 void IPCScope::updateMarkerTablePosition()
 {
+    if(!mMarkerTable){
+        return;
+    }
     QSizeF legendSize = mChart->legend()->size();
     QSizeF tableSize = mMarkerTable->size();
     QRectF plotArea = mChart->plotArea();
@@ -199,6 +269,109 @@ void IPCScope::updateMarkerTablePosition()
     mMarkerTable->move(pos.toPoint());
 }
 
+/*!
+ * \brief IPCScope::updateStatisticsTablePosition. Update the statistics table position: below the marker table when it
+ * shows markers, else in its place. The table is kept inside the plot area horizontally.
+ */
+void IPCScope::updateStatisticsTablePosition()
+{
+    if(!mStatisticsTable){
+        return;
+    }
+    QRectF plotArea = mChart->plotArea();
+    QSizeF tableSize = mStatisticsTable->size();
+    QPointF pos;
+    if(mMarkerTable && mMarkerTableVisible && (mMarkerTable->rowCount() > 0)){
+        pos = QPointF(mMarkerTable->pos()) + QPointF(0, mMarkerTable->height());
+    } else{
+        switch(mMarkerTablePos){
+        case mpTopLeft:
+            pos = plotArea.topLeft();
+            break;
+        case mpTopMidle:
+            pos = (plotArea.topLeft() + plotArea.topRight())/2;
+            break;
+        case mpTopRight:
+            pos = plotArea.topRight();
+            break;
+        }
+    }
+    if(pos.x() + tableSize.width() > plotArea.right()){
+        pos.setX(qMax(plotArea.left(), plotArea.right() - tableSize.width()));
+    }
+    mStatisticsTable->move(pos.toPoint());
+}
+
+/*!
+ * \brief xySeries. Return the series holding the points of a graph: the graph itself for line and scatter graphs, the upper
+ * series for area graphs.
+ * \param graph
+ * \return
+ */
+static QXYSeries *xySeries(QAbstractSeries *graph)
+{
+    if((graph->type() == QAbstractSeries::SeriesTypeLine)||(graph->type() == QAbstractSeries::SeriesTypeScatter)){
+        return static_cast<QXYSeries *>(graph);
+    } else if(graph->type() == QAbstractSeries::SeriesTypeArea){
+        return static_cast<QAreaSeries *>(graph)->upperSeries();
+    }
+    return nullptr;
+}
+
+/*!
+ * \brief storedRange. Map a range of shown values back to the stored unit of a graph. Unit transforms are non
+ * decreasing, so the stored points inside the returned range are the points shown inside range.
+ * \param unit
+ * \param range
+ * \return
+ */
+static QRectF storedRange(const IPCUnitTransform &unit, const QRectF &range)
+{
+    if(unit.isIdentity()){
+        return range;
+    }
+    IPCUnitTransform inverse = unit.inverted();
+    return QRectF(QPointF(range.left(), inverse.apply(range.top())), QPointF(range.right(), inverse.apply(range.bottom())));
+}
+
+// Re-cull of a graph for a view of the zoom history, run on a copy of its culler in a worker thread
+struct ZoomCull {
+    QAbstractSeries *graph;
+    IPCViewportCuller culler;
+    QRectF range;
+    bool connected;
+    QVector<QPointF> points;
+};
+
+/*!
+ * \brief mapToPixels. Map points to chart coordinates, with the mapping specialized for the axis scales of the scope type.
+ * Gives the positions QChart::mapToPosition() gives, without a virtual call and axis tests per point.
+ * \param points
+ * \param plotArea
+ * \param range Visible range, top being the minimum y value
+ * \param type
+ * \return
+ */
+static QVector<QPointF> mapToPixels(const QVector<QPointF> &points, const QRectF &plotArea, const QRectF &range, ScopeType type)
+{
+    QVector<QPointF> pixels(points.size());
+    switch(type){
+    case stpLinear:
+        IPCAxisMapping<IPCLinearScale, IPCLinearScale>(plotArea, range).map(points.constData(), points.size(), pixels.data());
+        break;
+    case stpSemiLogX:
+        IPCAxisMapping<IPCLogScale, IPCLinearScale>(plotArea, range).map(points.constData(), points.size(), pixels.data());
+        break;
+    case stpSemiLogY:
+        IPCAxisMapping<IPCLinearScale, IPCLogScale>(plotArea, range).map(points.constData(), points.size(), pixels.data());
+        break;
+    case stpLogLog:
+        IPCAxisMapping<IPCLogScale, IPCLogScale>(plotArea, range).map(points.constData(), points.size(), pixels.data());
+        break;
+    }
+    return pixels;
+}
+
 /*!
  * \brief takeClosest. Search for the closest value in a vector.
  * \param target
@@ -275,47 +448,33 @@ double IPCScope::cleanMantissa(double input) const
 
 /*!
  * \brief IPCScope::cosmeticTicksInterval. Recalculate the ticks interval after zooming. Limit an excessive number of grid lines.
+ * Log axes keep their decades.
  */
 void IPCScope::cosmeticTicksInterval()
 {
-    QAbstractAxis *xAxis = mAxesList.at(0);
-    QAbstractAxis *yAxis = mAxesList.at(1);
-
+    IPC_TRACE_SPAN("IPCScope::cosmeticTicksInterval");
     QRectF plotArea = mChart->plotArea();
-    if(mScopeType == stpSemiLogX){
-        QValueAxis *axis = static_cast<QValueAxis *>(yAxis);
-        double height = plotArea.height();
-        double deltaY = axis->max() - axis->min();
-        double tickInterval = deltaY / (height / 120);
-        tickInterval = cleanMantissa(tickInterval);
-        axis->setTickInterval(tickInterval);
-        axis->setMinorTickCount(getMinorTicks(tickInterval));
-    } else if(mScopeType == stpSemiLogY){
-        QValueAxis *axis = static_cast<QValueAxis *>(xAxis);
-        double width = plotArea.width();
-        double deltaX = axis->max() - axis->min();
-        double tickInterval = deltaX / (width / 120);
-        tickInterval = cleanMantissa(tickInterval);
-        axis->setTickInterval(tickInterval);
-        axis->setMinorTickCount(getMinorTicks(tickInterval));
-    } else if (mScopeType == stpLinear){
-        QValueAxis *xaxis = static_cast<QValueAxis *>(xAxis);
-        double width = plotArea.width();
-        double deltaX = xaxis->max() - xaxis->min();
-        QValueAxis *yaxis = static_cast<QValueAxis *>(yAxis);
-        double height = plotArea.height();
-        double deltaY = yaxis->max() - yaxis->min();
-        double tickIntervalX = deltaX / (width / 120);
-        double tickIntervalY = deltaY / (height / 120);
-        tickIntervalX = cleanMantissa(tickIntervalX);
-        xaxis->setTickInterval(tickIntervalX);
-        xaxis->setMinorTickCount(getMinorTicks(tickIntervalX));
-        tickIntervalY = cleanMantissa(tickIntervalY);
-        yaxis->setTickInterval(tickIntervalY);
-        yaxis->setMinorTickCount(getMinorTicks(tickIntervalY));
+    if((mScopeType == stpLinear) || (mScopeType == stpSemiLogY)){
+        cosmeticTicks(static_cast<QValueAxis *>(mAxesList.at(0)), plotArea.width());
+    }
+    if((mScopeType == stpLinear) || (mScopeType == stpSemiLogX)){
+        cosmeticTicks(static_cast<QValueAxis *>(mAxesList.at(1)), plotArea.height());
     }
 }
 
+/*!
+ * \brief IPCScope::cosmeticTicks. Set the ticks of a linear axis to a clean interval, one tick per 120 pixels at most.
+ * \param axis
+ * \param length Length of the axis, in pixels
+ */
+void IPCScope::cosmeticTicks(QValueAxis *axis, double length)
+{
+    double tickInterval = (axis->max() - axis->min()) / (length / 120);
+    tickInterval = cleanMantissa(tickInterval);
+    axis->setTickInterval(tickInterval);
+    axis->setMinorTickCount(getMinorTicks(tickInterval));
+}
+
 /*!
  * \brief IPCScope::updateGeometry. Update the geometry of different components in the scope.
  */
@@ -323,6 +482,7 @@ void IPCScope::updateGeometry()
 {
     updateLegendPosition();
     updateMarkerTablePosition();
+    updateStatisticsTablePosition();
 }
 
 /*!
@@ -337,9 +497,34 @@ void IPCScope::resizeEvent(QResizeEvent *event)
     }
     updateGeometry();
     cosmeticTicksInterval();
+    recullGraphs();
     QGraphicsView::resizeEvent(event);
 }
 
+/*!
+ * \brief IPCScope::showEvent. Reimplement showEvent. A scheduled scope which changed while hidden is refreshed when shown,
+ * and the traces restored from a session are decoded.
+ * \param event
+ */
+void IPCScope::showEvent(QShowEvent *event)
+{
+    applyPendingTraces();
+    if(mRefreshScheduler){
+        mRefreshScheduler->requestRefresh(this);
+    }
+    QGraphicsView::showEvent(event);
+}
+
+/*!
+ * \brief IPCScope::paintEvent. Reimplement paintEvent(), traced: the scene, QtCharts items included, is painted here.
+ * \param event
+ */
+void IPCScope::paintEvent(QPaintEvent *event)
+{
+    IPC_TRACE_SPAN("IPCScope::paintEvent");
+    QGraphicsView::paintEvent(event);
+}
+
 /*!
  * \brief IPCScope::wheelEvent. Reimplement wheelEvent() method. Set zoom range according to the zoom directions.
  * \param event
@@ -351,6 +536,10 @@ void IPCScope::wheelEvent(QWheelEvent *event)
         QPointF mousePos = event->posF();
         qreal scale = event->delta()>0?mZoomWeight:1/mZoomWeight;
         QRectF zoomArea = plotArea;
+        if(!mLastWheelZoom.isValid() || mLastWheelZoom.elapsed() > 500){
+            pushZoomHistory();
+        }
+        mLastWheelZoom.start();
 
         if(mZoomDirection & zdVertical){
             zoomArea.setTop(mousePos.y() + (zoomArea.top() - mousePos.y())*scale);
@@ -362,6 +551,7 @@ void IPCScope::wheelEvent(QWheelEvent *event)
         }
         mChart->zoomIn(zoomArea);
         cosmeticTicksInterval();
+        recullGraphs();
         foreach(IPCMarker *marker, mMarkerList){
             marker->updatePosition();
         }
@@ -376,6 +566,7 @@ void IPCScope::wheelEvent(QWheelEvent *event)
 void IPCScope::mouseDoubleClickEvent(QMouseEvent *event)
 {
     if(mChart){
+        pushZoomHistory();
         setZoomRange(mZoomRangeX.min(), mZoomRangeY.max(), mZoomRangeX.max(), mZoomRangeY.min());
 //        cosmeticTicksInterval();
     }
@@ -388,6 +579,14 @@ void IPCScope::mouseDoubleClickEvent(QMouseEvent *event)
  */
 void IPCScope::mousePressEvent(QMouseEvent *event)
 {
+    if(!mRubberBand){
+        mRubberBand = new QRubberBand(QRubberBand::Rectangle, this);
+        QPalette palette;
+        QColor color(0,202,0);
+        color.setAlphaF(0.4);
+        palette.setColor(QPalette::Active, QPalette::Highlight, color);
+        mRubberBand->setPalette(palette);
+    }
     mRubberBandOrigin = event->pos();
     mRubberBand->setGeometry(QRect(mRubberBandOrigin, QSize()));
     mRubberBand->show();
@@ -399,7 +598,89 @@ void IPCScope::mousePressEvent(QMouseEvent *event)
  */
 void IPCScope::mouseMoveEvent(QMouseEvent *event)
 {
-    mRubberBand->setGeometry(QRect(mRubberBandOrigin, event->pos()).normalized());
+    if(event->buttons() != Qt::NoButton){
+        if(!mRubberBand){
+            return;
+        }
+        mRubberBand->setGeometry(QRect(mRubberBandOrigin, event->pos()).normalized());
+        return;
+    }
+    /* Hover readout */
+    if(mHoverReadoutEnabled){
+        int graphIdx = -1;
+        QPointF point;
+        if(nearestPoint(mapToScene(event->pos()), &graphIdx, &point) >= 0){
+            QString unit = IPCUnitTransform::unitName(graphUnitTransform(graphIdx).to());
+            QString text = QString("%1\nx: %2\ny: %3%4").arg(mGraphsList.at(graphIdx)->name())
+                    .arg(point.x(), 0, 'g', 10).arg(point.y(), 0, 'g', 6).arg(unit.isEmpty() ? unit : " " + unit);
+            QToolTip::showText(event->globalPos(), text, this);
+            emit hoverPointChanged(graphIdx, point);
+        } else{
+            QToolTip::hideText();
+        }
+    }
+}
+
+/*!
+ * \brief IPCScope::setHoverReadoutEnabled. Enable or disable the hover readout. When enabled, moving the mouse over the
+ * scope shows the data point of the visible graphs closest to the cursor, within the hover radius.
+ * \param enabled
+ */
+void IPCScope::setHoverReadoutEnabled(bool enabled)
+{
+    mHoverReadoutEnabled = enabled;
+    setMouseTracking(enabled);
+    if(!enabled){
+        QToolTip::hideText();
+        qDeleteAll(mIndexHash);
+        mIndexHash.clear();
+    }
+}
+
+/*!
+ * \brief IPCScope::nearestPoint. Search the data point of the visible graphs closest to a position. Graphs sorted by x
+ * snap to the point with the closest key, other graphs to the closest point. Each graph has an index, rebuilt lazily when
+ * its data or the zoom changed. Return the index of the point in the graph, or -1 if no point is within the hover radius.
+ * \param scenePos. Position in scene coordinates.
+ * \param graphIdx. Receives the index of the graph.
+ * \param point. Receives the point.
+ * \return
+ */
+int IPCScope::nearestPoint(const QPointF &scenePos, int *graphIdx, QPointF *point)
+{
+    QPointF pos = mChart->mapFromScene(scenePos);
+    QRectF plotArea = mChart->plotArea();
+    if(!plotArea.contains(pos)){
+        return -1;
+    }
+    QRectF range = visibleRange();
+    bool xLog = (mScopeType == stpSemiLogX) || (mScopeType == stpLogLog);
+    bool yLog = (mScopeType == stpSemiLogY) || (mScopeType == stpLogLog);
+    int bestIdx = -1;
+    double bestDistance = mHoverRadius;
+    for(int i = 0; i < mGraphsList.length(); i++){
+        QAbstractSeries *series = mGraphsList.at(i);
+        if(!series->isVisible()){
+            continue;
+        }
+        IPCSpatialIndex *index = mIndexHash.value(series);
+        if(!index){
+            index = new IPCSpatialIndex;
+            index->setPoints(graphPoints(i));
+            index->setValueTransform(mUnitHash.value(series).transform);
+            mIndexHash.insert(series, index);
+        }
+        double distance = 0;
+        int idx = index->nearest(pos, plotArea, range, xLog, yLog, bestDistance, &distance);
+        if((idx >= 0) && (distance <= bestDistance)){
+            bestDistance = distance;
+            bestIdx = idx;
+            *graphIdx = i;
+            *point = index->points().at(idx);
+            point->setY(mUnitHash.value(series).transform.apply(point->y()));
+        }
+    }
+    return bestIdx;
 }
 
 /*!
@@ -408,11 +689,16 @@ void IPCScope::mouseMoveEvent(QMouseEvent *event)
  */
 void IPCScope::mouseReleaseEvent(QMouseEvent *event)
 {
+    if(!mRubberBand){
+        return;
+    }
     mRubberBand->hide();
     /* Zoom into the rubber band area */
     if(qAbs(mRubberBandOrigin.x() - event->pos().x()) > 2){ // Do not zoom if this is a double click event.
+        pushZoomHistory();
         mChart->zoomIn(QRect(mRubberBandOrigin, event->pos()).normalized());
         cosmeticTicksInterval();
+        recullGraphs();
         foreach(IPCMarker *marker, mMarkerList){
             marker->updatePosition();
         }
@@ -433,6 +719,40 @@ void IPCScope::setOpenGLEnabled(bool enable)
     }
 }
 
+/*!
+ * \brief IPCScope::setRefreshScheduler. Let a scheduler coordinate the repaints of this scope with other scopes. The viewport
+ * is no longer repainted on each change (new data, marker move, zoom...): the scope is marked dirty and the scheduler
+ * repaints it at the next display frame. Pass nullptr to go back to immediate repaints.
+ * \param scheduler
+ * \param priority
+ */
+void IPCScope::setRefreshScheduler(IPCRefreshScheduler *scheduler, IPCRefreshScheduler::Priority priority)
+{
+    if(mRefreshScheduler){
+        mRefreshScheduler->unregisterScope(this);
+        disconnect(scene(), &QGraphicsScene::changed, this, &IPCScope::onSceneChanged);
+    }
+    mRefreshScheduler = scheduler;
+    if(scheduler){
+        setViewportUpdateMode(QGraphicsView::NoViewportUpdate);
+        connect(scene(), &QGraphicsScene::changed, this, &IPCScope::onSceneChanged);
+        scheduler->registerScope(this, priority);
+    } else{
+        setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
+        viewport()->update();
+    }
+}
+
+/*!
+ * \brief IPCScope::onSceneChanged. The scene content changed, ask the scheduler for a repaint.
+ */
+void IPCScope::onSceneChanged()
+{
+    if(mRefreshScheduler){
+        mRefreshScheduler->requestRefresh(this);
+    }
+}
+
 /*!
  * \brief IPCScope::setActiveGraphIdx. Change the active graph (for markers for example)
  * \param graphIdx
@@ -446,7 +766,8 @@ void IPCScope::setActiveGraphIdx(int graphIdx)
     mActiveGraphIdx = graphIdx;
     // Update markers' position
     foreach(IPCMarker *marker, mMarkerList){
-        marker->setGraph(mGraphsList[graphIdx]);
+        marker->setValueTransform(graphUnitTransform(graphIdx));
+        marker->setGraph(mGraphsList[graphIdx], graphPoints(graphIdx));
     }
 }
 
@@ -496,6 +817,9 @@ void IPCScope::addGraph(QString graphName, LineStyle lineStyle)
     series->setUseOpenGL(mOpenGLEnabled);    
     // Append the series to the list
     mGraphsList.append(series);
+    if(mCullingEnabled){
+        mCullerHash.insert(series, new IPCViewportCuller);
+    }
     updateGeometry();
 }
 
@@ -536,6 +860,26 @@ void IPCScope::clearGraph(int graphIdx)
         return;
     }
     QAbstractSeries *series = mGraphsList[graphIdx];
+    detachTraceBuffer(graphIdx);
+    if(series == mReplayGraph){
+        stopReplay();
+    }
+    mLiveDataHash.remove(series);
+    delete mHistoryHash.take(series);
+    delete mCullerHash.take(series);
+    delete mIndexHash.take(series);
+    mTraceStateHash.remove(series);
+    mPendingTraceHash.remove(series);
+    delete mSpectrumHash.take(series);
+    mSampleScaleHash.remove(series);
+    mUnitHash.remove(series);
+    if(mStatisticsHash.remove(series) > 0){
+        scheduleStatisticsTable();
+    }
+    mRollHash.remove(series);
+    if(graphIdx < mModelGraphIds.size()){
+        mModelRevisions.remove(mModelGraphIds.takeAt(graphIdx));
+    }
 
     // If the removed graph is also the active graph, we change the active graph to the next one (or the previous one if this is the last in the list)
     if(graphIdx == mActiveGraphIdx){
@@ -548,7 +892,8 @@ void IPCScope::clearGraph(int graphIdx)
         // Update the marker target graph
         if(mActiveGraphIdx >= 0){
             foreach(IPCMarker *marker, mMarkerList){
-                marker->setGraph(mGraphsList[mActiveGraphIdx]);
+                marker->setValueTransform(graphUnitTransform(mActiveGraphIdx));
+                marker->setGraph(mGraphsList[mActiveGraphIdx], graphPoints(mActiveGraphIdx));
             }
         }
     } else{
@@ -620,6 +965,7 @@ void IPCScope::setGraphName(int graphIdx, QString name)
     }
     mGraphsList.at(graphIdx)->setName(name);
     updateGeometry();
+    scheduleStatisticsTable();
 }
 
 /*!
@@ -634,6 +980,7 @@ void IPCScope::setGraphName(QString name)
     }
     mGraphsList.at(mGraphsList.length()-1)->setName(name);
     updateGeometry();
+    scheduleStatisticsTable();
 }
 
 /*!
@@ -672,45 +1019,208 @@ void IPCScope::setGraphColor(const QColor &color)
 }
 
 /*!
- * \brief IPCScope::setGraphData. Update a graph's data. This method is the fastest since it replaces the points vector if
- * the number of points in the graph is unchanged.
+ * \brief IPCScope::setGraphData. Update a graph's data. This method is the fastest since it replaces the points vector
+ * without copying it.
  * \param graphIdx
  * \param points
  */
 void IPCScope::setGraphData(int graphIdx, QVector<QPointF> points)
 {
+    IPC_TRACE_SPAN("IPCScope::setGraphData");
     if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
         qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
         return;
     }
     QAbstractSeries *s = mGraphsList.at(graphIdx);
-    if((s->type() == QAbstractSeries::SeriesTypeLine)||(s->type() == QAbstractSeries::SeriesTypeScatter)){
-        QXYSeries *series = static_cast<QXYSeries *>(s);
-        if(series->count() == points.length()){
-            series->replace(points);
-        } else{
-            series->clear();
-            for(int i = 0; i < points.length(); i++){
-                series->append(points.at(i));
-            }
+    // New data replaces a trace restored from a session
+    mPendingTraceHash.remove(s);
+    // A roll mode graph restarts from the new points
+    if(mRollHash.contains(s)){
+        RollState &state = mRollHash[s];
+        state.buffer.clear();
+        if(state.seriesCount > 0){
+            xySeries(s)->clear();
+            state.seriesCount = 0;
         }
-    } else if(s->type() == QAbstractSeries::SeriesTypeArea){
-        QAreaSeries *series = static_cast<QAreaSeries *>(s);
-        QLineSeries *upperLineSeries = series->upperSeries();
-        if(upperLineSeries->count() == points.length()){
-            upperLineSeries->replace(points);
-        } else{
-            upperLineSeries->clear();
-            for(int i = 0; i < points.length(); i++){
-                upperLineSeries->append(points.at(i));
-            }
+        mRollScrollX = -qInf();
+        // The statistics of the trace restart with the roll
+        updateGraphStatistics(s, QVector<QPointF>(), true);
+        appendGraphData(graphIdx, points);
+        return;
+    }
+    updateGraphStatistics(s, points, true);
+    // Max hold, min hold or average
+    if(mTraceStateHash.contains(s)){
+        points = applyTraceMode(s, points);
+    }
+    // Record into the history. This only queues the shared vector.
+    IPCTraceHistory *history = mHistoryHash.value(s);
+    if(history){
+        history->record(points);
+    }
+    // A graph showing a history frame keeps the live data aside
+    if(mLiveDataHash.contains(s)){
+        mLiveDataHash.insert(s, points);
+        return;
+    }
+    updateGraphSeries(graphIdx, points);
+}
+
+/*!
+ * \brief IPCScope::setGraphTraceMode. Change the trace mode of a graph. In max hold, min hold and average modes, each new
+ * frame is combined with the previous ones. The accumulation restarts when the mode or the number of points changes.
+ * \param graphIdx
+ * \param mode
+ */
+void IPCScope::setGraphTraceMode(int graphIdx, TraceMode mode)
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    if(mode == ClearWrite){
+        mTraceStateHash.remove(series);
+        return;
+    }
+    TraceState state = mTraceStateHash.value(series);
+    if(!mTraceStateHash.contains(series)){
+        state.averageCount = 10;
+    }
+    state.mode = mode;
+    state.frameCount = 0;
+    state.points = QVector<QPointF>();
+    mTraceStateHash.insert(series, state);
+}
+
+/*!
+ * \brief IPCScope::setGraphAverageCount. Set the number of frames averaged in Average mode.
+ * \param graphIdx
+ * \param count
+ */
+void IPCScope::setGraphAverageCount(int graphIdx, int count)
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    if(count < 1){
+        qDebug() << Q_FUNC_INFO << "Non positive count:" << count;
+        return;
+    }
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    if(mTraceStateHash.contains(series)){
+        mTraceStateHash[series].averageCount = count;
+    }
+}
+
+/*!
+ * \brief IPCScope::graphTraceMode. Return the trace mode of a graph.
+ * \param graphIdx
+ * \return
+ */
+IPCScope::TraceMode IPCScope::graphTraceMode(int graphIdx) const
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return ClearWrite;
+    }
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    return mTraceStateHash.contains(series) ? mTraceStateHash.value(series).mode : ClearWrite;
+}
+
+/*!
+ * \brief IPCScope::applyTraceMode. Combine a new frame with the held or averaged trace of a graph. The average is a
+ * running average over the last averageCount frames.
+ * \param graph
+ * \param points
+ * \return
+ */
+QVector<QPointF> IPCScope::applyTraceMode(QAbstractSeries *graph, const QVector<QPointF> &points)
+{
+    TraceState &state = mTraceStateHash[graph];
+    const int n = points.size();
+    if((state.frameCount == 0) || (state.points.size() != n)){
+        state.points = points;
+        state.frameCount = 1;
+        return state.points;
+    }
+    state.frameCount = qMin(state.frameCount + 1, state.averageCount);
+    // Detaches from the previous frame, which may still be shared with the series
+    QPointF *held = state.points.data();
+    const QPointF *p = points.constData();
+    switch(state.mode){
+    case MaxHold:
+        for(int i = 0; i < n; i++){
+            held[i] = QPointF(p[i].x(), qMax(held[i].y(), p[i].y()));
+        }
+        break;
+    case MinHold:
+        for(int i = 0; i < n; i++){
+            held[i] = QPointF(p[i].x(), qMin(held[i].y(), p[i].y()));
+        }
+        break;
+    case Average:
+    {
+        const double weight = 1.0 / state.frameCount;
+        for(int i = 0; i < n; i++){
+            held[i] = QPointF(p[i].x(), held[i].y() + (p[i].y() - held[i].y())*weight);
+        }
+        break;
+    }
+    case ClearWrite:
+        state.points = points;
+        break;
+    }
+    return state.points;
+}
+
+/*!
+ * \brief IPCScope::updateGraphSeries. Hand the points to the graph's series and update the markers.
+ * \param graphIdx
+ * \param points
+ */
+void IPCScope::updateGraphSeries(int graphIdx, const QVector<QPointF> &points)
+{
+    IPC_TRACE_SPAN("IPCScope::updateGraphSeries");
+    QAbstractSeries *s = mGraphsList.at(graphIdx);
+    QXYSeries *series = xySeries(s);
+    if(!series){
+        return;
+    }
+    // replace() keeps a shallow copy of the vector: the points are shared with the caller (and with any trace buffer)
+    // as long as nobody modifies them, whatever the number of points.
+    IPCSpatialIndex *index = mIndexHash.value(s);
+    if(index){
+        index->setPoints(points);
+    }
+    IPCViewportCuller *culler = mCullerHash.value(s);
+    // Graphs shown in another unit only convert the points handed to the series
+    IPCUnitTransform unit = mUnitHash.value(s).transform;
+    if(culler){
+        // The culler keeps the full data, the series only gets the visible points
+        culler->setSource(points);
+        if(!unit.isIdentity()){
+            mUnitHash[s].source = QVector<QPointF>();
         }
+        bool xLog = (mScopeType == stpSemiLogX) || (mScopeType == stpLogLog);
+        int decimationWidth = mDecimationEnabled ? qMax(1, qRound(mChart->plotArea().width())) : 0;
+        QVector<QPointF> visible = culler->cull(storedRange(unit, visibleRange()), s->type() != QAbstractSeries::SeriesTypeScatter,
+                                                decimationWidth, xLog);
+        series->replace(unit.apply(visible));
+    } else if(!unit.isIdentity()){
+        mUnitHash[s].source = points;
+        series->replace(unit.apply(points));
+    } else{
+        series->replace(points);
     }
 
     // If the graphIdx is equal to the active graph index, we also update the marker position
-    if(mActiveMarkerIdx == graphIdx){
+    if(mActiveGraphIdx == graphIdx){
+        IPC_TRACE_SPAN("IPCScope::updateMarkers");
         for(int i = 0; i < mMarkerList.length(); i++){
             IPCMarker *marker = mMarkerList.at(i);
+            marker->setSourcePoints(points);
             marker->updatePosition();
             // Udate the marker table
             mMarkerTable->setMarkerPos(i, marker->pos());
@@ -806,49 +1316,1797 @@ void IPCScope::setGraphData(QString name, double *x, double *y, int len)
 }
 
 /*!
- * \brief IPCScope::setZoomRange. Zoom into a range defined by its coordinates. It is noted that the points are given in
- * graph's coordinates. p1 is the top left point and p2 is the bottom right point.
- * \param xp1
- * \param yp1
- * \param xp2
- * \param yp2
+ * \brief IPCScope::setGraphGain. Set the conversion of the raw samples of a graph to values: gain*sample + offset.
+ * \param graphIdx
+ * \param gain
+ * \param offset
  */
-void IPCScope::setZoomRange(qreal xp1, qreal yp1, qreal xp2, qreal yp2)
+void IPCScope::setGraphGain(int graphIdx, double gain, double offset)
 {
-    if(mAxesList.length() < 2)
-    {
-        qDebug() << Q_FUNC_INFO << "x and y axes must be attached to the scope before.";
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
         return;
     }
-    mZoomRangeX.setMin(xp1);
-    mZoomRangeX.setMax(xp2);
-    mZoomRangeY.setMin(yp2);
-    mZoomRangeY.setMax(yp1);
-    QAbstractAxis *xAxis = mAxesList.at(0);
-    QAbstractAxis *yAxis = mAxesList.at(1);
-    /* Before setting the range, we need to update the tick interval first
-     * to limit the excessive number of ticks
-    */
-    if(mScopeType == stpSemiLogX){
-        QValueAxis *axis = static_cast<QValueAxis *>(yAxis);
-        axis->setTickInterval(mZoomRangeY.max() - mZoomRangeY.min());
-    } else if(mScopeType == stpSemiLogY){
-        QValueAxis *axis = static_cast<QValueAxis *>(xAxis);
-        axis->setTickInterval(mZoomRangeX.max() - mZoomRangeX.min());
-    } else if (mScopeType == stpLinear){
-        QValueAxis *xaxis = static_cast<QValueAxis *>(xAxis);
-        QValueAxis *yaxis = static_cast<QValueAxis *>(yAxis);
-        xaxis->setTickInterval(mZoomRangeX.max() - mZoomRangeX.min());
-        yaxis->setTickInterval(mZoomRangeY.max() - mZoomRangeY.min());
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    if(gain == 1 && offset == 0){
+        mSampleScaleHash.remove(series);
+    } else{
+        mSampleScaleHash.insert(series, qMakePair(gain, offset));
     }
+}
 
-    xAxis->setRange(xp1, xp2);
-    yAxis->setRange(yp2, yp1);
+/*!
+ * \brief IPCScope::graphGain. Return the gain applied to the raw samples of a graph.
+ * \param graphIdx
+ */
+double IPCScope::graphGain(int graphIdx) const
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return 1;
+    }
+    return mSampleScaleHash.value(mGraphsList.at(graphIdx), qMakePair(1.0, 0.0)).first;
+}
+
+/*!
+ * \brief IPCScope::graphOffset. Return the offset added to the scaled raw samples of a graph.
+ * \param graphIdx
+ */
+double IPCScope::graphOffset(int graphIdx) const
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return 0;
+    }
+    return mSampleScaleHash.value(mGraphsList.at(graphIdx), qMakePair(1.0, 0.0)).second;
+}
+
+/*!
+ * \brief IPCScope::ingestSamples. Convert raw samples straight into the points handed to the graph.
+ * \param graphIdx
+ * \param samples
+ * \param count
+ * \param x0
+ * \param dx
+ * \param stride
+ */
+template <typename T>
+void IPCScope::ingestSamples(int graphIdx, const T *samples, int count, double x0, double dx, int stride)
+{
+    IPC_TRACE_SPAN("IPCScope::ingestSamples");
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    if(!samples || count <= 0 || stride < 1){
+        qDebug() << Q_FUNC_INFO << "Invalid samples:" << count << stride;
+        return;
+    }
+    QPair<double, double> scale = mSampleScaleHash.value(mGraphsList.at(graphIdx), qMakePair(1.0, 0.0));
+    QVector<QPointF> points(count);
+    IPCSampleConverter::convert(samples, count, stride, scale.first, scale.second, x0, dx, points.data());
+    setGraphData(graphIdx, points);
+}
+
+/*!
+ * \brief IPCScope::ingestInterleaved. Split interleaved raw samples into the points of consecutive graphs, in one pass.
+ * \param firstGraphIdx
+ * \param samples
+ * \param frames
+ * \param channels
+ * \param x0
+ * \param dx
+ */
+template <typename T>
+void IPCScope::ingestInterleaved(int firstGraphIdx, const T *samples, int frames, int channels, double x0, double dx)
+{
+    IPC_TRACE_SPAN("IPCScope::ingestInterleaved");
+    if((firstGraphIdx < 0) || (channels < 1) || (firstGraphIdx + channels > mGraphsList.length())){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << firstGraphIdx << channels;
+        return;
+    }
+    if(!samples || frames <= 0){
+        qDebug() << Q_FUNC_INFO << "Invalid samples:" << frames;
+        return;
+    }
+    QVector<double> gains(channels);
+    QVector<double> offsets(channels);
+    QVector<QVector<QPointF> > points(channels);
+    QVector<QPointF *> outputs(channels);
+    for(int c = 0; c < channels; c++){
+        QPair<double, double> scale = mSampleScaleHash.value(mGraphsList.at(firstGraphIdx + c), qMakePair(1.0, 0.0));
+        gains[c] = scale.first;
+        offsets[c] = scale.second;
+        points[c].resize(frames);
+        outputs[c] = points[c].data();
+    }
+    IPCSampleConverter::deinterleave(samples, frames, channels, gains.constData(), offsets.constData(), x0, dx,
+                                     outputs.constData());
+    for(int c = 0; c < channels; c++){
+        setGraphData(firstGraphIdx + c, points.at(c));
+    }
+}
+
+/*!
+ * \brief IPCScope::setGraphSamples. Update a graph from 16 bits samples, scaled by the graph gain and offset.
+ * \param graphIdx
+ * \param samples
+ * \param count Number of samples
+ * \param x0 x of the first sample
+ * \param dx x step between samples
+ * \param stride Distance between samples, in values
+ */
+void IPCScope::setGraphSamples(int graphIdx, const qint16 *samples, int count, double x0, double dx, int stride)
+{
+    ingestSamples(graphIdx, samples, count, x0, dx, stride);
+}
+
+/*!
+ * \brief IPCScope::setGraphSamples. Update a graph from 32 bits samples, scaled by the graph gain and offset.
+ */
+void IPCScope::setGraphSamples(int graphIdx, const qint32 *samples, int count, double x0, double dx, int stride)
+{
+    ingestSamples(graphIdx, samples, count, x0, dx, stride);
+}
+
+/*!
+ * \brief IPCScope::setGraphSamples. Update a graph from float samples, scaled by the graph gain and offset.
+ */
+void IPCScope::setGraphSamples(int graphIdx, const float *samples, int count, double x0, double dx, int stride)
+{
+    ingestSamples(graphIdx, samples, count, x0, dx, stride);
+}
+
+/*!
+ * \brief IPCScope::setGraphSamplesInterleaved. Update consecutive graphs from a block of interleaved 16 bits samples,
+ * one channel per graph.
+ * \param firstGraphIdx Graph of the first channel
+ * \param samples frames*channels samples
+ * \param frames
+ * \param channels
+ * \param x0 x of the first frame
+ * \param dx x step between frames
+ */
+void IPCScope::setGraphSamplesInterleaved(int firstGraphIdx, const qint16 *samples, int frames, int channels, double x0,
+                                          double dx)
+{
+    ingestInterleaved(firstGraphIdx, samples, frames, channels, x0, dx);
+}
+
+/*!
+ * \brief IPCScope::setGraphSamplesInterleaved. Update consecutive graphs from a block of interleaved 32 bits samples.
+ */
+void IPCScope::setGraphSamplesInterleaved(int firstGraphIdx, const qint32 *samples, int frames, int channels, double x0,
+                                          double dx)
+{
+    ingestInterleaved(firstGraphIdx, samples, frames, channels, x0, dx);
+}
+
+/*!
+ * \brief IPCScope::setGraphSamplesInterleaved. Update consecutive graphs from a block of interleaved float samples.
+ */
+void IPCScope::setGraphSamplesInterleaved(int firstGraphIdx, const float *samples, int frames, int channels, double x0,
+                                          double dx)
+{
+    ingestInterleaved(firstGraphIdx, samples, frames, channels, x0, dx);
+}
+
+/*!
+ * \brief IPCScope::setGraphUnit. Set the unit the data of a graph is given in and the unit it is shown in. The data isn't
+ * converted: only the points handed to the renderer (the visible, decimated points when culling is enabled), the markers
+ * and the hover readout are, so switching units costs as much as a zoom. The y range is left as is, see setZoomFit().
+ * \param graphIdx
+ * \param storedUnit Unit of the data given to setGraphData()
+ * \param shownUnit Unit of the values shown
+ * \param impedance Impedance relating power and amplitude units, in ohms
+ */
+void IPCScope::setGraphUnit(int graphIdx, IPCUnitTransform::Unit storedUnit, IPCUnitTransform::Unit shownUnit,
+                            double impedance)
+{
+    IPC_TRACE_SPAN("IPCScope::setGraphUnit");
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    QAbstractSeries *s = mGraphsList.at(graphIdx);
+    QXYSeries *series = xySeries(s);
+    if(!series){
+        return;
+    }
+    // Stored data, read before the state changes
+    QVector<QPointF> points = graphPoints(graphIdx);
+    IPCUnitTransform unit(storedUnit, shownUnit, impedance);
+    if(unit.from() == IPCUnitTransform::utNone){
+        mUnitHash.remove(s);
+    } else{
+        UnitState state;
+        state.transform = unit;
+        mUnitHash.insert(s, state);
+    }
+    // Statistics are of shown values
+    if(mStatisticsHash.contains(s)){
+        mStatisticsHash[s].statistics.reset();
+        scheduleStatisticsTable();
+    }
+    IPCSpatialIndex *index = mIndexHash.value(s);
+    if(index){
+        index->setValueTransform(unit);
+    }
+    if(mActiveGraphIdx == graphIdx){
+        foreach(IPCMarker *marker, mMarkerList){
+            marker->setValueTransform(unit);
+        }
+    }
+    // A trace restored from a session is shown when decoded
+    if(mPendingTraceHash.contains(s)){
+        return;
+    }
+    if(mRollHash.contains(s)){
+        // The series holds the last seriesCount points of the ring
+        const RollState &state = mRollHash[s];
+        series->replace(unit.apply(state.buffer.points(state.buffer.count() - state.seriesCount)));
+        if(mActiveGraphIdx == graphIdx){
+            for(int i = 0; i < mMarkerList.length(); i++){
+                IPCMarker *marker = mMarkerList.at(i);
+                marker->updatePosition();
+                markerTable()->setMarkerPos(i, marker->pos());
+            }
+        }
+    } else{
+        updateGraphSeries(graphIdx, points);
+    }
+}
+
+/*!
+ * \brief IPCScope::setGraphShownUnit. Change the unit a graph is shown in, keeping its stored unit and impedance.
+ * \param graphIdx
+ * \param shownUnit
+ */
+void IPCScope::setGraphShownUnit(int graphIdx, IPCUnitTransform::Unit shownUnit)
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    IPCUnitTransform unit = graphUnitTransform(graphIdx);
+    if(unit.from() == IPCUnitTransform::utNone){
+        qDebug() << Q_FUNC_INFO << "No stored unit, see setGraphUnit():" << graphIdx;
+        return;
+    }
+    setGraphUnit(graphIdx, unit.from(), shownUnit, unit.impedance());
+}
+
+/*!
+ * \brief IPCScope::graphUnitTransform. Return the transform from the stored unit of a graph to its shown unit.
+ * \param graphIdx
+ * \return
+ */
+IPCUnitTransform IPCScope::graphUnitTransform(int graphIdx) const
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return IPCUnitTransform();
+    }
+    return mUnitHash.value(mGraphsList.at(graphIdx)).transform;
+}
+
+/*!
+ * \brief IPCScope::setGraphStatisticsMode. Change the statistics kept for a graph: none, the statistics of the last
+ * trace (for a roll mode graph, of the points appended since the last setGraphData()) or the running statistics of
+ * every value. The statistics restart when the mode changes.
+ * \param graphIdx
+ * \param mode
+ */
+void IPCScope::setGraphStatisticsMode(int graphIdx, StatisticsMode mode)
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    if(mode == smNone){
+        mStatisticsHash.remove(series);
+    } else{
+        StatisticsState state;
+        state.mode = mode;
+        mStatisticsHash.insert(series, state);
+    }
+    scheduleStatisticsTable();
+}
+
+/*!
+ * \brief IPCScope::graphStatisticsMode. Return the statistics kept for a graph.
+ * \param graphIdx
+ * \return
+ */
+IPCScope::StatisticsMode IPCScope::graphStatisticsMode(int graphIdx) const
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return smNone;
+    }
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    return mStatisticsHash.contains(series) ? mStatisticsHash.value(series).mode : smNone;
+}
+
+/*!
+ * \brief IPCScope::graphStatistics. Return the statistics of a graph, empty if it has none.
+ * \param graphIdx
+ * \return
+ */
+IPCStatistics IPCScope::graphStatistics(int graphIdx) const
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return IPCStatistics();
+    }
+    return mStatisticsHash.value(mGraphsList.at(graphIdx)).statistics;
+}
+
+/*!
+ * \brief IPCScope::resetGraphStatistics. Restart the statistics of a graph.
+ * \param graphIdx
+ */
+void IPCScope::resetGraphStatistics(int graphIdx)
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    if(mStatisticsHash.contains(series)){
+        mStatisticsHash[series].statistics.reset();
+        scheduleStatisticsTable();
+    }
+}
+
+/*!
+ * \brief IPCScope::updateGraphStatistics. Add the y values of points to the statistics of a graph, converted by blocks
+ * to its shown unit. A new trace restarts the statistics of the last trace.
+ * \param graph
+ * \param points
+ * \param newTrace
+ */
+void IPCScope::updateGraphStatistics(QAbstractSeries *graph, const QVector<QPointF> &points, bool newTrace)
+{
+    if(!mStatisticsHash.contains(graph)){
+        return;
+    }
+    IPC_TRACE_SPAN("IPCScope::updateGraphStatistics");
+    StatisticsState &state = mStatisticsHash[graph];
+    if(newTrace && (state.mode == smTrace)){
+        state.statistics.reset();
+    }
+    IPCUnitTransform unit = mUnitHash.value(graph).transform;
+    if(unit.isIdentity()){
+        state.statistics.add(points.constData(), points.size());
+    } else{
+        const int blockSize = 1024;
+        QPointF block[blockSize];
+        for(int i = 0; i < points.size(); i += blockSize){
+            int count = qMin(blockSize, points.size() - i);
+            unit.apply(points.constData() + i, count, block);
+            state.statistics.add(block, count);
+        }
+    }
+    scheduleStatisticsTable();
+}
+
+/*!
+ * \brief IPCScope::scheduleStatisticsTable. Refresh the statistics table once control returns to the event loop, so a
+ * burst of updates refreshes it once.
+ */
+void IPCScope::scheduleStatisticsTable()
+{
+    if(mStatisticsTable && mStatisticsTableVisible && !mStatisticsTablePending){
+        mStatisticsTablePending = true;
+        QTimer::singleShot(0, this, &IPCScope::updateStatisticsTable);
+    }
+}
+
+/*!
+ * \brief IPCScope::updateStatisticsTable. Show the statistics of the graphs having statistics, in the graphs order.
+ */
+void IPCScope::updateStatisticsTable()
+{
+    IPC_TRACE_SPAN("IPCScope::updateStatisticsTable");
+    mStatisticsTablePending = false;
+    if(!mStatisticsTable || !mStatisticsTableVisible){
+        return;
+    }
+    int row = 0;
+    foreach(QAbstractSeries *s, mGraphsList){
+        QHash<QAbstractSeries *, StatisticsState>::const_iterator it = mStatisticsHash.constFind(s);
+        if(it == mStatisticsHash.constEnd()){
+            continue;
+        }
+        // The quantiles are read in place, the sketch merges its buffered values once
+        IPCUnitTransform::Unit unit = mUnitHash.value(s).transform.to();
+        mStatisticsTable->setGraphStatistics(row++, s->name(), it->statistics, IPCUnitTransform::unitName(unit));
+    }
+    mStatisticsTable->setGraphCount(row);
+    updateStatisticsTablePosition();
+}
+
+/*!
+ * \brief IPCScope::graphSpectrum. Return the spectrum front end of a graph, created on first use. Its settings (size,
+ * window, sample rate, scale) apply to the time samples given to setGraphTimeSamples().
+ * \param graphIdx
+ * \return
+ */
+IPCSpectrum *IPCScope::graphSpectrum(int graphIdx)
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return nullptr;
+    }
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    IPCSpectrum *spectrum = mSpectrumHash.value(series);
+    if(!spectrum){
+        spectrum = new IPCSpectrum();
+        mSpectrumHash.insert(series, spectrum);
+    }
+    return spectrum;
+}
+
+/*!
+ * \brief IPCScope::setGraphTimeSamples. Update a graph with the one sided spectrum of real time samples, from DC to Nyquist.
+ * \param graphIdx
+ * \param samples
+ * \param count
+ */
+void IPCScope::setGraphTimeSamples(int graphIdx, const double *samples, int count)
+{
+    IPCSpectrum *spectrum = graphSpectrum(graphIdx);
+    if(!spectrum){
+        return;
+    }
+    QVector<QPointF> points = spectrum->process(samples, count);
+    if(points.isEmpty()){
+        return;
+    }
+    setGraphData(graphIdx, points);
+}
+
+/*!
+ * \brief IPCScope::setGraphTimeSamples. Update a graph with the two sided spectrum of complex (IQ) time samples, around
+ * the center frequency of the graph spectrum.
+ * \param graphIdx
+ * \param samples
+ * \param count
+ */
+void IPCScope::setGraphTimeSamples(int graphIdx, const std::complex<double> *samples, int count)
+{
+    IPCSpectrum *spectrum = graphSpectrum(graphIdx);
+    if(!spectrum){
+        return;
+    }
+    QVector<QPointF> points = spectrum->process(samples, count);
+    if(points.isEmpty()){
+        return;
+    }
+    setGraphData(graphIdx, points);
+}
+
+/*!
+ * \brief IPCScope::setGraphRollMode. Enable or disable the roll mode of a graph. In roll mode, appendGraphData() adds
+ * points at O(1) cost and the x axis scrolls with the most recent points. The current points of the graph are kept,
+ * within the capacity.
+ * \param graphIdx
+ * \param enabled
+ * \param capacity Number of points held by the graph
+ */
+void IPCScope::setGraphRollMode(int graphIdx, bool enabled, int capacity)
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    if(capacity < 1){
+        qDebug() << Q_FUNC_INFO << "Non positive capacity:" << capacity;
+        return;
+    }
+    QAbstractSeries *s = mGraphsList.at(graphIdx);
+    if(!xySeries(s)){
+        return;
+    }
+    if(enabled){
+        if(mRollHash.contains(s)){
+            mRollHash[s].buffer.setCapacity(capacity);
+            trimRollSeries(s);
+            return;
+        }
+        // Roll mode graphs hand their points straight to the series, without trace mode, history or culling
+        showLive(graphIdx);
+        QVector<QPointF> points = graphPoints(graphIdx);
+        mTraceStateHash.remove(s);
+        delete mCullerHash.take(s);
+        delete mIndexHash.take(s);
+        if(mUnitHash.contains(s)){
+            mUnitHash[s].source = QVector<QPointF>();
+        }
+        RollState state;
+        state.buffer.setCapacity(capacity);
+        state.seriesCount = 0;
+        mRollHash.insert(s, state);
+        xySeries(s)->clear();
+        mRollScrollX = -qInf();
+        // The points shown are already in the statistics
+        appendRollData(graphIdx, points, false);
+    } else if(mRollHash.contains(s)){
+        QVector<QPointF> points = mRollHash.take(s).buffer.points();
+        if(mCullingEnabled){
+            mCullerHash.insert(s, new IPCViewportCuller);
+        }
+        delete mIndexHash.take(s);
+        updateGraphSeries(graphIdx, points);
+    }
+}
+
+/*!
+ * \brief IPCScope::graphRollMode. Return true if a graph is in roll mode.
+ * \param graphIdx
+ * \return
+ */
+bool IPCScope::graphRollMode(int graphIdx) const
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return false;
+    }
+    return mRollHash.contains(mGraphsList.at(graphIdx));
+}
+
+/*!
+ * \brief IPCScope::graphRollBuffer. Return the points of a roll mode graph, or nullptr if the graph isn't in roll mode.
+ * \param graphIdx
+ * \return
+ */
+const IPCRollBuffer *IPCScope::graphRollBuffer(int graphIdx) const
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return nullptr;
+    }
+    QHash<QAbstractSeries *, RollState>::const_iterator it = mRollHash.constFind(mGraphsList.at(graphIdx));
+    return (it != mRollHash.constEnd()) ? &it.value().buffer : nullptr;
+}
+
+/*!
+ * \brief IPCScope::setRollSpan. Set the x range shown by the roll mode graphs. 0 stops the scrolling.
+ * \param span
+ */
+void IPCScope::setRollSpan(double span)
+{
+    if(span < 0){
+        qDebug() << Q_FUNC_INFO << "Negative span:" << span;
+        return;
+    }
+    mRollSpan = span;
+    mRollScrollX = -qInf();
+    foreach(QAbstractSeries *s, mRollHash.keys()){
+        trimRollSeries(s);
+        if(!mRollHash[s].buffer.isEmpty()){
+            scrollRoll(mRollHash[s].buffer.last().x());
+        }
+    }
+}
+
+/*!
+ * \brief IPCScope::appendGraphData. Append a point to a roll mode graph.
+ * \param graphIdx
+ * \param point
+ */
+void IPCScope::appendGraphData(int graphIdx, const QPointF &point)
+{
+    appendGraphData(graphIdx, QVector<QPointF>() << point);
+}
+
+/*!
+ * \brief IPCScope::appendGraphData. Append a point to a roll mode graph.
+ * \param graphIdx
+ * \param x
+ * \param y
+ */
+void IPCScope::appendGraphData(int graphIdx, double x, double y)
+{
+    appendGraphData(graphIdx, QPointF(x, y));
+}
+
+/*!
+ * \brief IPCScope::appendGraphData. Append points to a roll mode graph. The points are added to the ring; a few points
+ * are appended to the series and a larger batch replaces the series with the visible points of the ring, so a batch
+ * costs one copy of the series. Points scrolled out of view are dropped from the series by chunks, and the x axis only
+ * scrolls when the data advanced by one pixel column.
+ * \param graphIdx
+ * \param points
+ */
+void IPCScope::appendGraphData(int graphIdx, const QVector<QPointF> &points)
+{
+    appendRollData(graphIdx, points, true);
+}
+
+/*!
+ * \brief IPCScope::appendRollData. Append points to a roll mode graph, see appendGraphData().
+ * \param graphIdx
+ * \param points
+ * \param newData False for points already in the statistics of the graph
+ */
+void IPCScope::appendRollData(int graphIdx, const QVector<QPointF> &points, bool newData)
+{
+    IPC_TRACE_SPAN("IPCScope::appendGraphData");
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    QAbstractSeries *s = mGraphsList.at(graphIdx);
+    if(!mRollHash.contains(s)){
+        qDebug() << Q_FUNC_INFO << "Graph is not in roll mode:" << graphIdx;
+        return;
+    }
+    if(points.isEmpty()){
+        return;
+    }
+    RollState &state = mRollHash[s];
+    double lastX = state.buffer.isEmpty() ? -qInf() : state.buffer.last().x();
+    // The whole batch is checked first, so that the ring and the series stay in step
+    foreach(const QPointF &point, points){
+        if(point.x() < lastX){
+            qDebug() << Q_FUNC_INFO << "x values must not decrease";
+            return;
+        }
+        lastX = point.x();
+    }
+    foreach(const QPointF &point, points){
+        state.buffer.append(point);
+    }
+    mPendingTraceHash.remove(s);
+    // The hover index is rebuilt on demand
+    delete mIndexHash.take(s);
+    if(newData){
+        updateGraphStatistics(s, points, false);
+    }
+
+    // Only the points the ring still holds reach the series, in the shown unit
+    int kept = qMin(points.size(), state.buffer.capacity());
+    QXYSeries *series = xySeries(s);
+    IPCUnitTransform unit = mUnitHash.value(s).transform;
+    // Each point appended to a series is signaled, and the chart copies all the points of the series for each: a few
+    // points are appended, larger batches replace the series with the visible points of the ring.
+    const int maxAppended = 4;
+    if(kept == 1){
+        series->append(points.last().x(), unit.apply(points.last().y()));
+        state.seriesCount += kept;
+    } else if(kept <= maxAppended){
+        series->append(unit.apply(points.mid(points.size() - kept)).toList());
+        state.seriesCount += kept;
+    } else{
+        const IPCRollBuffer &buffer = state.buffer;
+        int first = 0;
+        if(mRollSpan > 0){
+            // Keep the point before the left edge so that the line enters the plot area
+            first = qMax(0, buffer.lowerBound(lastX - mRollSpan) - 1);
+        }
+        series->replace(unit.apply(buffer.points(first)));
+        state.seriesCount = buffer.count() - first;
+    }
+    trimRollSeries(s);
+    scrollRoll(lastX);
+}
+
+/*!
+ * \brief IPCScope::trimRollSeries. Drop from the series of a roll mode graph the points overwritten in the ring or
+ * scrolled out of view. Points are dropped once they make a quarter of the series, so the cost stays O(1) per point.
+ * \param graph
+ */
+void IPCScope::trimRollSeries(QAbstractSeries *graph)
+{
+    RollState &state = mRollHash[graph];
+    const IPCRollBuffer &buffer = state.buffer;
+    // Ring index of the first point of the series, negative if the ring overwrote it
+    int first = buffer.count() - state.seriesCount;
+    int visible = buffer.count();
+    if(mRollSpan > 0 && !buffer.isEmpty()){
+        // Keep the point before the left edge so that the line enters the plot area
+        visible = qMax(0, buffer.lowerBound(buffer.last().x() - mRollSpan, qMax(0, first)) - 1);
+    } else{
+        visible = 0;
+    }
+    int removable = visible - first;
+    if(removable > 0 && removable >= qMax(64, state.seriesCount / 4)){
+        xySeries(graph)->removePoints(0, removable);
+        state.seriesCount -= removable;
+    }
+}
+
+/*!
+ * \brief IPCScope::scrollRoll. Scroll the x axis to end at x, once x advanced by a pixel column since the last scroll.
+ * Markers following the active graph are updated on each scroll.
+ * \param x
+ */
+void IPCScope::scrollRoll(double x)
+{
+    if(mRollSpan <= 0 || mAxesList.length() < 2){
+        return;
+    }
+    double pixelSpan = mRollSpan / qMax(1.0, mChart->plotArea().width());
+    if((x < mRollScrollX + pixelSpan) && (x >= mRollScrollX - mRollSpan)){
+        return;
+    }
+    mRollScrollX = x;
+    mZoomRangeX.setMin(x - mRollSpan);
+    mZoomRangeX.setMax(x);
+    mAxesList.at(0)->setRange(x - mRollSpan, x);
+
+    if(mActiveGraphIdx >= 0 && !mMarkerList.isEmpty()){
+        QAbstractSeries *active = mGraphsList.at(mActiveGraphIdx);
+        if(mRollHash.contains(active)){
+            const RollState &state = mRollHash[active];
+            QVector<QPointF> points = state.buffer.points(state.buffer.count() - state.seriesCount);
+            for(int i = 0; i < mMarkerList.length(); i++){
+                IPCMarker *marker = mMarkerList.at(i);
+                marker->setSourcePoints(points);
+                marker->updatePosition();
+                markerTable()->setMarkerPos(i, marker->pos());
+            }
+        } else{
+            foreach(IPCMarker *marker, mMarkerList){
+                marker->updatePosition();
+            }
+        }
+    }
+}
+
+/*!
+ * \brief IPCScope::setModel. Render a model. The graphs and markers of the scope are replaced by the ones of the model,
+ * then follow its changes. The model can be updated from worker threads; the scope is updated once per event loop pass.
+ * Zooms and marker moves made on the scope are pushed back to the model.
+ * nullptr detaches the scope, which keeps its current graphs.
+ * \param model
+ */
+void IPCScope::setModel(IPCScopeModel *model)
+{
+    if(model == mModel){
+        return;
+    }
+    if(mModel){
+        disconnect(mModel, &IPCScopeModel::changed, this, &IPCScope::onModelChanged);
+        disconnect(this, &IPCScope::visibleRangeChanged, this, &IPCScope::onVisibleRangeChanged);
+        disconnect(this, &IPCScope::markerKeyChanged, this, &IPCScope::onMarkerKeyChanged);
+    }
+    mModel = model;
+    mModelGraphIds.clear();
+    mModelRevisions.clear();
+    if(!mModel){
+        return;
+    }
+    clearGraphs();
+    clearMarkers();
+    connect(mModel, &IPCScopeModel::changed, this, &IPCScope::onModelChanged);
+    // Zooms and marker moves made on the scope go back to the model
+    connect(this, &IPCScope::visibleRangeChanged, this, &IPCScope::onVisibleRangeChanged);
+    connect(this, &IPCScope::markerKeyChanged, this, &IPCScope::onMarkerKeyChanged);
+    onModelChanged(IPCScopeModel::mcGraphs | IPCScopeModel::mcData | IPCScopeModel::mcMarkers | IPCScopeModel::mcZoom);
+}
+
+/*!
+ * \brief IPCScope::onModelChanged. Bring the scope in line with its model. Only the graphs whose revision changed are
+ * updated, with the points shared by the model.
+ * \param changes
+ */
+void IPCScope::onModelChanged(int changes)
+{
+    IPC_TRACE_SPAN("IPCScope::onModelChanged");
+    if(!mModel){
+        return;
+    }
+    // The changes made here come from the model, they are not pushed back to it
+    mModelSyncing = true;
+    if(changes & (IPCScopeModel::mcGraphs | IPCScopeModel::mcData)){
+        QList<IPCScopeModel::Graph> graphs = mModel->graphs();
+        QSet<int> ids;
+        foreach(const IPCScopeModel::Graph &graph, graphs){
+            ids.insert(graph.id);
+        }
+        // Graphs are only appended to or removed from the model: once the removed graphs are gone, the order matches
+        for(int i = mModelGraphIds.size()-1; i >= 0; i--){
+            if(!ids.contains(mModelGraphIds.at(i))){
+                clearGraph(i);
+            }
+        }
+        for(int i = mModelGraphIds.size(); i < graphs.size(); i++){
+            addGraph(graphs.at(i).name);
+            mModelGraphIds.append(graphs.at(i).id);
+        }
+        for(int i = 0; i < graphs.size(); i++){
+            const IPCScopeModel::Graph &graph = graphs.at(i);
+            if(mGraphsList.at(i)->name() != graph.name){
+                setGraphName(i, graph.name);
+            }
+            if(mModelRevisions.value(graph.id) != graph.revision){
+                mModelRevisions.insert(graph.id, graph.revision);
+                setGraphData(i, graph.points);
+            }
+        }
+    }
+    if(changes & IPCScopeModel::mcMarkers){
+        QList<double> keys = mModel->markerKeys();
+        while(mMarkerList.length() > keys.size()){
+            clearMarker(mMarkerList.length()-1);
+        }
+        while(mMarkerList.length() < keys.size()){
+            addMarker();
+        }
+        for(int i = 0; i < keys.size(); i++){
+            if(mMarkerList.at(i)->graphKey() != keys.at(i)){
+                setMarkerKeyValue(i, keys.at(i));
+            }
+        }
+    }
+    if(changes & IPCScopeModel::mcZoom){
+        // The top of the model range is the minimum y value
+        QRectF range = mModel->zoomRange();
+        if(!range.isNull()){
+            setZoomRange(QPointF(range.left(), range.bottom()), QPointF(range.right(), range.top()));
+        }
+    }
+    mModelSyncing = false;
+}
+
+/*!
+ * \brief IPCScope::onVisibleRangeChanged. Push a zoom made on the scope (wheel, rubber band, zoom history) to the model.
+ * The x and y axes change one after the other, the range is pushed once both are set.
+ */
+void IPCScope::onVisibleRangeChanged()
+{
+    if(mModelSyncing || mModelZoomPending){
+        return;
+    }
+    mModelZoomPending = true;
+    QTimer::singleShot(0, this, &IPCScope::updateModelZoom);
+}
+
+/*!
+ * \brief IPCScope::updateModelZoom. Set the zoom range of the model to the range shown, if it differs.
+ */
+void IPCScope::updateModelZoom()
+{
+    mModelZoomPending = false;
+    if(!mModel){
+        return;
+    }
+    QRectF range = visibleRange();
+    if(range != mModel->zoomRange()){
+        mModel->setZoomRange(range);
+    }
+}
+
+/*!
+ * \brief IPCScope::onMarkerKeyChanged. Push the key of a marker moved on the scope to the model.
+ * \param markerIdx
+ */
+void IPCScope::onMarkerKeyChanged(int markerIdx)
+{
+    if(mModelSyncing || !mModel || (markerIdx < 0) || (markerIdx > mMarkerList.length()-1)){
+        return;
+    }
+    QList<double> keys = mModel->markerKeys();
+    double key = mMarkerList.at(markerIdx)->graphKey();
+    if((markerIdx < keys.size()) && (keys.at(markerIdx) != key)){
+        mModel->setMarkerKey(markerIdx, key);
+    }
+}
+
+/*!
+ * \brief IPCScope::graphPoints. Return the full data of a graph. With viewport culling, the series of the graph only
+ * holds the visible points.
+ * \param graphIdx
+ * \return
+ */
+QVector<QPointF> IPCScope::graphPoints(int graphIdx) const
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return QVector<QPointF>();
+    }
+    QAbstractSeries *s = mGraphsList.at(graphIdx);
+    if(mPendingTraceHash.contains(s)){
+        return IPCTraceBuffer::fromBytes(mPendingTraceHash.value(s));
+    }
+    if(mRollHash.contains(s)){
+        return mRollHash.value(s).buffer.points();
+    }
+    IPCViewportCuller *culler = mCullerHash.value(s);
+    if(culler){
+        return culler->source();
+    }
+    if(mUnitHash.contains(s) && !mUnitHash.value(s).transform.isIdentity()){
+        return mUnitHash.value(s).source;
+    }
+    QXYSeries *series = xySeries(s);
+    return series ? series->pointsVector() : QVector<QPointF>();
+}
+
+/*!
+ * \brief IPCScope::setCullingEnabled. Enable or disable the viewport culling. When enabled, the renderer only gets the
+ * points inside the visible range (plus one point beyond each edge) and the graphs are re-culled on each zoom.
+ * The data given to setGraphData() is kept untouched and is still used for the markers.
+ * \param enabled
+ */
+void IPCScope::setCullingEnabled(bool enabled)
+{
+    if(enabled == mCullingEnabled){
+        return;
+    }
+    // Full data of the graphs, before switching
+    QList<QVector<QPointF> > data;
+    for(int i = 0; i < mGraphsList.length(); i++){
+        data.append(graphPoints(i));
+    }
+    mCullingEnabled = enabled;
+    qDeleteAll(mCullerHash);
+    mCullerHash.clear();
+    if(enabled){
+        foreach(QAbstractSeries *series, mGraphsList){
+            // Roll mode graphs only hold the recent points in their series, they are not culled
+            if(!mRollHash.contains(series)){
+                mCullerHash.insert(series, new IPCViewportCuller);
+            }
+        }
+    }
+    for(int i = 0; i < mGraphsList.length(); i++){
+        if(!mRollHash.contains(mGraphsList.at(i))){
+            updateGraphSeries(i, data.at(i));
+        }
+    }
+}
+
+/*!
+ * \brief IPCScope::setDecimationEnabled. When the viewport culling is enabled, also reduce the visible points of line and
+ * area graphs to a min/max per pixel column of the plot area. The drawn envelope is unchanged.
+ * \param enabled
+ */
+void IPCScope::setDecimationEnabled(bool enabled)
+{
+    mDecimationEnabled = enabled;
+    recullGraphs();
+}
+
+/*!
+ * \brief IPCScope::visibleRange. Return the range displayed by the axes, in graph's coordinates. The top of the returned
+ * rectangle is the minimum y value.
+ * \return
+ */
+QRectF IPCScope::visibleRange() const
+{
+    double range[4] = {0, 0, 0, 0};
+    for(int i = 0; (i < 2) && (i < mAxesList.length()); i++){
+        QAbstractAxis *axis = mAxesList.at(i);
+        if(QValueAxis *valueAxis = qobject_cast<QValueAxis *>(axis)){
+            range[2*i] = valueAxis->min();
+            range[2*i+1] = valueAxis->max();
+        } else if(QLogValueAxis *logAxis = qobject_cast<QLogValueAxis *>(axis)){
+            range[2*i] = logAxis->min();
+            range[2*i+1] = logAxis->max();
+        }
+    }
+    return QRectF(QPointF(range[0], range[2]), QPointF(range[1], range[3])).normalized();
+}
+
+/*!
+ * \brief IPCScope::recullGraphs. Hand the visible points of each graph to the renderer, after a zoom or a resize.
+ * Graphs already culled for the current range are skipped.
+ */
+void IPCScope::recullGraphs()
+{
+    IPC_TRACE_SPAN("IPCScope::recullGraphs");
+    mRecullPending = false;
+    if(mCullerHash.isEmpty()){
+        return;
+    }
+    QRectF range = visibleRange();
+    bool xLog = (mScopeType == stpSemiLogX) || (mScopeType == stpLogLog);
+    int decimationWidth = mDecimationEnabled ? qMax(1, qRound(mChart->plotArea().width())) : 0;
+    foreach(QAbstractSeries *s, mGraphsList){
+        IPCViewportCuller *culler = mCullerHash.value(s);
+        QXYSeries *series = xySeries(s);
+        if(!culler || !series){
+            continue;
+        }
+        IPCUnitTransform unit = mUnitHash.value(s).transform;
+        QRectF stored = storedRange(unit, range);
+        if(!culler->isCulled(stored, decimationWidth)){
+            series->replace(unit.apply(culler->cull(stored, s->type() != QAbstractSeries::SeriesTypeScatter, decimationWidth, xLog)));
+        }
+    }
+}
+
+/*!
+ * \brief IPCScope::onAxisRangeChanged. An axis range changed, re-cull the graphs once control returns to the event loop.
+ */
+void IPCScope::onAxisRangeChanged()
+{
+    if(!mRecullPending && mZoomFrameItem && mZoomFrameItem->isVisible()){
+        // Zoomed away from a history view still re-culled in the background: its render no longer matches
+        mZoomFrameItem->hide();
+    }
+    if(mCullingEnabled && !mRecullPending){
+        mRecullPending = true;
+        QTimer::singleShot(0, this, &IPCScope::recullGraphs);
+    }
+    emit visibleRangeChanged();
+}
+
+/*!
+ * \brief vectorBytes. Return the memory held by a vector, or 0 if its data was already counted.
+ * \param vector
+ * \param counted. Data already counted.
+ * \return
+ */
+template <typename T>
+static qint64 vectorBytes(const QVector<T> &vector, QSet<const void *> *counted)
+{
+    if((vector.capacity() == 0) || counted->contains(vector.constData())){
+        return 0;
+    }
+    counted->insert(vector.constData());
+    return (qint64)vector.capacity()*sizeof(T);
+}
+
+/*!
+ * \brief IPCScope::graphMemoryUsage. Return the memory used by a graph for one category, in bytes. The data of the
+ * implicitly shared vectors is counted once per set of counted pointers: pass the same set to account several graphs
+ * or scopes without counting the shared traces twice.
+ * \param graphIdx
+ * \param category
+ * \param counted. Data already counted. If null, only the data shared within the category is counted once.
+ * \return
+ */
+qint64 IPCScope::graphMemoryUsage(int graphIdx, IPCMemoryBudget::Category category, QSet<const void *> *counted) const
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return 0;
+    }
+    QSet<const void *> localCounted;
+    if(!counted){
+        counted = &localCounted;
+    }
+    QAbstractSeries *s = mGraphsList.at(graphIdx);
+    QXYSeries *series = xySeries(s);
+    IPCViewportCuller *culler = mCullerHash.value(s);
+    qint64 usage = 0;
+    switch(category){
+    case IPCMemoryBudget::mcTraces:
+        if(culler){
+            usage += vectorBytes(culler->source(), counted);
+        } else if(series){
+            // Shown and stored points of a graph shown in another unit
+            if(mUnitHash.contains(s)){
+                usage += vectorBytes(mUnitHash.value(s).source, counted);
+            }
+            usage += vectorBytes(series->pointsVector(), counted);
+        }
+        if(mLiveDataHash.contains(s)){
+            usage += vectorBytes(mLiveDataHash.value(s), counted);
+        }
+        if(mRollHash.contains(s)){
+            usage += mRollHash.value(s).buffer.memoryUsage();
+        }
+        if(mSpectrumHash.contains(s)){
+            // The window is shared with the cache of IPCSpectrum and the spectra of the same size
+            usage += vectorBytes(mSpectrumHash.value(s)->coefficients(), counted);
+        }
+        break;
+    case IPCMemoryBudget::mcTraceModes:
+        if(mTraceStateHash.contains(s)){
+            usage += vectorBytes(mTraceStateHash.value(s).points, counted);
+        }
+        break;
+    case IPCMemoryBudget::mcHistory:
+        if(mHistoryHash.contains(s)){
+            usage += mHistoryHash.value(s)->memoryUsage();
+        }
+        break;
+    case IPCMemoryBudget::mcCulling:
+        if(culler){
+            // The series holds the culled points, shared with the source when everything is visible
+            if(series){
+                usage += vectorBytes(series->pointsVector(), counted);
+            }
+            usage += culler->memoryUsage();
+        }
+        break;
+    case IPCMemoryBudget::mcHoverIndex:
+        if(mIndexHash.contains(s)){
+            usage += mIndexHash.value(s)->memoryUsage();
+        }
+        break;
+    case IPCMemoryBudget::mcSession:
+        if(mPendingTraceHash.contains(s)){
+            const QByteArray &bytes = mPendingTraceHash[s];
+            if(!counted->contains(bytes.constData())){
+                counted->insert(bytes.constData());
+                usage += bytes.capacity();
+            }
+        }
+        break;
+    case IPCMemoryBudget::mcCount:
+        break;
+    }
+    return usage;
+}
+
+/*!
+ * \brief IPCScope::graphMemoryUsage. Return the memory used by a graph, all categories included, in bytes.
+ * \param graphIdx
+ * \return
+ */
+qint64 IPCScope::graphMemoryUsage(int graphIdx) const
+{
+    QSet<const void *> counted;
+    qint64 usage = 0;
+    for(int c = 0; c < IPCMemoryBudget::mcCount; c++){
+        usage += graphMemoryUsage(graphIdx, (IPCMemoryBudget::Category)c, &counted);
+    }
+    return usage;
+}
+
+/*!
+ * \brief IPCScope::memoryUsage. Return the memory used by all the graphs for one category, in bytes. The renders of the
+ * zoom history are counted with the culling caches.
+ * \param category
+ * \return
+ */
+qint64 IPCScope::memoryUsage(IPCMemoryBudget::Category category) const
+{
+    QSet<const void *> counted;
+    qint64 usage = (category == IPCMemoryBudget::mcCulling) ? zoomHistoryMemoryUsage() : 0;
+    for(int i = 0; i < mGraphsList.length(); i++){
+        usage += graphMemoryUsage(i, category, &counted);
+    }
+    return usage;
+}
+
+/*!
+ * \brief IPCScope::memoryUsage. Return the memory used by all the graphs and the zoom history renders, in bytes.
+ * \return
+ */
+qint64 IPCScope::memoryUsage() const
+{
+    QSet<const void *> counted;
+    qint64 usage = zoomHistoryMemoryUsage();
+    for(int i = 0; i < mGraphsList.length(); i++){
+        for(int c = 0; c < IPCMemoryBudget::mcCount; c++){
+            usage += graphMemoryUsage(i, (IPCMemoryBudget::Category)c, &counted);
+        }
+    }
+    return usage;
+}
+
+/*!
+ * \brief IPCScope::releaseCaches. Drop the culling grid and the hover index of a graph. They are rebuilt on demand.
+ * Return the number of bytes freed.
+ * \param graphIdx
+ * \return
+ */
+qint64 IPCScope::releaseCaches(int graphIdx)
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return 0;
+    }
+    QAbstractSeries *s = mGraphsList.at(graphIdx);
+    qint64 freed = 0;
+    IPCViewportCuller *culler = mCullerHash.value(s);
+    if(culler){
+        freed += culler->memoryUsage();
+        culler->clearGrid();
+    }
+    IPCSpatialIndex *index = mIndexHash.value(s);
+    if(index){
+        freed += index->memoryUsage();
+        index->clear();
+    }
+    return freed;
+}
+
+/*!
+ * \brief pixmapBytes. Return the memory held by a pixmap, or 0 if it was already counted.
+ * \param pixmap
+ * \param counted. Cache keys of the pixmaps already counted, copies of a pixmap share its key.
+ * \return
+ */
+static qint64 pixmapBytes(const QPixmap &pixmap, QSet<qint64> *counted)
+{
+    if(pixmap.isNull() || counted->contains(pixmap.cacheKey())){
+        return 0;
+    }
+    counted->insert(pixmap.cacheKey());
+    return (qint64)pixmap.width()*pixmap.height()*pixmap.depth()/8;
+}
+
+/*!
+ * \brief IPCScope::zoomHistoryMemoryUsage. Return the memory used by the renders of the zoom history, in bytes.
+ * \return
+ */
+qint64 IPCScope::zoomHistoryMemoryUsage() const
+{
+    QSet<qint64> counted;
+    qint64 usage = 0;
+    foreach(const ZoomView &view, mZoomHistory){
+        usage += pixmapBytes(view.frame, &counted);
+    }
+    if(mZoomFrameItem){
+        usage += pixmapBytes(mZoomFrameItem->pixmap(), &counted);
+    }
+    return usage;
+}
+
+/*!
+ * \brief IPCScope::releaseZoomRenders. Drop the renders of the zoom history, the ranges are kept: going back or
+ * forward then shows the graphs once re-culled. Return the number of bytes freed.
+ * \return
+ */
+qint64 IPCScope::releaseZoomRenders()
+{
+    qint64 freed = zoomHistoryMemoryUsage();
+    for(int i = 0; i < mZoomHistory.length(); i++){
+        mZoomHistory[i].frame = QPixmap();
+    }
+    if(mZoomFrameItem){
+        mZoomFrameItem->hide();
+        mZoomFrameItem->setPixmap(QPixmap());
+    }
+    return freed;
+}
+
+/*!
+ * \brief IPCScope::attachTraceBuffer. Attach a graph to a shared trace buffer. Each frame published in the buffer is
+ * displayed in the graph without copying the points. A buffer can be attached to several graphs and several scopes.
+ * \param graphIdx
+ * \param buffer
+ */
+void IPCScope::attachTraceBuffer(int graphIdx, IPCTraceBuffer *buffer)
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    detachTraceBuffer(graphIdx);
+    if(!buffer){
+        return;
+    }
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    // Only one connection per buffer, even if the buffer feeds several graphs of this scope
+    bool connected = false;
+    foreach(const QPointer<IPCTraceBuffer> &b, mTraceBufferHash){
+        if(b == buffer){
+            connected = true;
+        }
+    }
+    mTraceBufferHash.insert(series, buffer);
+    mTraceBufferFrameHash.insert(series, 0);
+    if(!connected){
+        connect(buffer, &IPCTraceBuffer::frameReady, this, &IPCScope::onTraceBufferFrameReady);
+    }
+    // Display the current frame
+    quint64 frameIndex = 0;
+    QVector<QPointF> points = buffer->snapshot(&frameIndex);
+    mTraceBufferFrameHash.insert(series, frameIndex);
+    setGraphData(graphIdx, points);
+}
+
+/*!
+ * \brief IPCScope::detachTraceBuffer. Detach a graph from its trace buffer. The graph keeps the last frame displayed.
+ * \param graphIdx
+ */
+void IPCScope::detachTraceBuffer(int graphIdx)
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    QPointer<IPCTraceBuffer> buffer = mTraceBufferHash.take(series);
+    mTraceBufferFrameHash.remove(series);
+    if(!buffer){
+        return;
+    }
+    // Disconnect only if no other graph of this scope uses the buffer
+    foreach(const QPointer<IPCTraceBuffer> &b, mTraceBufferHash){
+        if(b == buffer){
+            return;
+        }
+    }
+    disconnect(buffer.data(), &IPCTraceBuffer::frameReady, this, &IPCScope::onTraceBufferFrameReady);
+}
+
+/*!
+ * \brief IPCScope::traceBuffer. Return the trace buffer attached to a graph, or nullptr if there is none.
+ * \param graphIdx
+ * \return
+ */
+IPCTraceBuffer *IPCScope::traceBuffer(int graphIdx) const
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return nullptr;
+    }
+    return mTraceBufferHash.value(mGraphsList.at(graphIdx));
+}
+
+/*!
+ * \brief IPCScope::onTraceBufferFrameReady. Display the new frame of a trace buffer in every graph attached to it.
+ * Frames already displayed are skipped, so that queued notifications from a fast producer collapse into one update.
+ */
+void IPCScope::onTraceBufferFrameReady()
+{
+    IPC_TRACE_SPAN("IPCScope::onTraceBufferFrameReady");
+    IPCTraceBuffer *buffer = qobject_cast<IPCTraceBuffer *>(sender());
+    if(!buffer){
+        return;
+    }
+    quint64 frameIndex = 0;
+    QVector<QPointF> points = buffer->snapshot(&frameIndex);
+    for(int i = 0; i < mGraphsList.length(); i++){
+        QAbstractSeries *series = mGraphsList.at(i);
+        if((mTraceBufferHash.value(series) == buffer) && (mTraceBufferFrameHash.value(series) != frameIndex)){
+            mTraceBufferFrameHash.insert(series, frameIndex);
+            setGraphData(i, points);
+        }
+    }
+}
+
+/*!
+ * \brief IPCScope::setGraphHistoryEnabled. Enable or disable the trace history of a graph. Each frame given to
+ * setGraphData() is then recorded, within the memory budget of the history (see graphHistory()).
+ * \param graphIdx
+ * \param enabled
+ */
+void IPCScope::setGraphHistoryEnabled(int graphIdx, bool enabled)
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    if(enabled){
+        if(!mHistoryHash.contains(series)){
+            mHistoryHash.insert(series, new IPCTraceHistory(this));
+        }
+    } else{
+        showLive(graphIdx);
+        delete mHistoryHash.take(series);
+    }
+}
+
+/*!
+ * \brief IPCScope::graphHistory. Return the trace history of a graph, or nullptr if the history isn't enabled.
+ * \param graphIdx
+ * \return
+ */
+IPCTraceHistory *IPCScope::graphHistory(int graphIdx) const
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return nullptr;
+    }
+    return mHistoryHash.value(mGraphsList.at(graphIdx));
+}
+
+/*!
+ * \brief IPCScope::showHistoryFrame. Display a recorded frame instead of the live data (scrubbing). Index 0 is the oldest frame.
+ * Live data keeps being recorded, call showLive() to display it again.
+ * \param graphIdx
+ * \param frameIdx
+ */
+void IPCScope::showHistoryFrame(int graphIdx, int frameIdx)
+{
+    IPCTraceHistory *history = graphHistory(graphIdx);
+    if(!history){
+        qDebug() << Q_FUNC_INFO << "history isn't enabled for graph" << graphIdx;
+        return;
+    }
+    if((frameIdx < 0) || (frameIdx > history->frameCount()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << frameIdx;
+        return;
+    }
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    if(!mLiveDataHash.contains(series)){
+        // Keep the live data currently displayed
+        mLiveDataHash.insert(series, graphPoints(graphIdx));
+    }
+    updateGraphSeries(graphIdx, history->frame(frameIdx));
+    emit historyFrameShown(graphIdx, frameIdx);
+}
+
+/*!
+ * \brief IPCScope::replayHistory. Replay the recorded frames from firstFrameIdx to lastFrameIdx at the given rate.
+ * Only one graph can be replayed at a time.
+ * \param graphIdx
+ * \param firstFrameIdx
+ * \param lastFrameIdx
+ * \param framesPerSecond
+ */
+void IPCScope::replayHistory(int graphIdx, int firstFrameIdx, int lastFrameIdx, double framesPerSecond)
+{
+    IPCTraceHistory *history = graphHistory(graphIdx);
+    if(!history){
+        qDebug() << Q_FUNC_INFO << "history isn't enabled for graph" << graphIdx;
+        return;
+    }
+    if((firstFrameIdx < 0) || (lastFrameIdx > history->frameCount()-1) || (firstFrameIdx > lastFrameIdx)){
+        qDebug() << Q_FUNC_INFO << "invalid range:" << firstFrameIdx << lastFrameIdx;
+        return;
+    }
+    if(framesPerSecond <= 0){
+        qDebug() << Q_FUNC_INFO << "Non positive rate:" << framesPerSecond;
+        return;
+    }
+    if(!mReplayTimer){
+        mReplayTimer = new QTimer(this);
+        connect(mReplayTimer, &QTimer::timeout, this, &IPCScope::onReplayTimeout);
+    }
+    mReplayGraph = mGraphsList.at(graphIdx);
+    mReplayFrameIdx = firstFrameIdx;
+    mReplayLastFrameIdx = lastFrameIdx;
+    showHistoryFrame(graphIdx, mReplayFrameIdx);
+    mReplayTimer->start(qMax(1, qRound(1000.0/framesPerSecond)));
+}
+
+/*!
+ * \brief IPCScope::stopReplay. Stop the replay. The graph keeps showing the current history frame.
+ */
+void IPCScope::stopReplay()
+{
+    if(mReplayTimer){
+        mReplayTimer->stop();
+    }
+    mReplayGraph = nullptr;
+}
+
+/*!
+ * \brief IPCScope::onReplayTimeout. Show the next frame of the replay.
+ */
+void IPCScope::onReplayTimeout()
+{
+    int graphIdx = mGraphsList.indexOf(mReplayGraph);
+    if((graphIdx < 0) || (mReplayFrameIdx >= mReplayLastFrameIdx)){
+        stopReplay();
+        return;
+    }
+    mReplayFrameIdx++;
+    showHistoryFrame(graphIdx, mReplayFrameIdx);
+}
+
+/*!
+ * \brief IPCScope::showLive. Display the live data again after showHistoryFrame() or replayHistory().
+ * \param graphIdx
+ */
+void IPCScope::showLive(int graphIdx)
+{
+    if((graphIdx < 0) || (graphIdx > mGraphsList.length()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        return;
+    }
+    QAbstractSeries *series = mGraphsList.at(graphIdx);
+    if(series == mReplayGraph){
+        stopReplay();
+    }
+    if(mLiveDataHash.contains(series)){
+        updateGraphSeries(graphIdx, mLiveDataHash.take(series));
+    }
+}
+
+/*!
+ * \brief IPCScope::storeZoomView. Store the current view, range and plot area render, as the current history entry.
+ * The plot area is only rendered when graphs are culled, the render covers the plot area while they are re-culled.
+ */
+void IPCScope::storeZoomView()
+{
+    ZoomView view;
+    view.range = visibleRange();
+    if(mZoomFrameItem && mZoomFrameItem->isVisible()){
+        // The graphs under it aren't re-culled for the range yet: the cached render is the one of the view
+        view.frame = mZoomFrameItem->pixmap();
+    } else if(isVisible() && mCullingEnabled && !mCullerHash.isEmpty()){
+        // Without culling the graphs are shown at once, only the range is stored
+        QRect area = mapFromScene(mChart->mapToScene(mChart->plotArea())).boundingRect();
+        view.frame = viewport()->grab(area);
+    }
+    if(mZoomHistoryIdx < 0){
+        mZoomHistory.append(view);
+        mZoomHistoryIdx = 0;
+    } else{
+        mZoomHistory[mZoomHistoryIdx] = view;
+    }
+}
+
+/*!
+ * \brief IPCScope::pushZoomHistory. Called before a user zoom: store the current view and drop the views after it.
+ * The new view is stored when it is left.
+ */
+void IPCScope::pushZoomHistory()
+{
+    if(!mChart || mZoomHistoryDepth < 2){
+        return;
+    }
+    storeZoomView();
+    while(mZoomHistory.length() > mZoomHistoryIdx+1){
+        mZoomHistory.removeLast();
+    }
+    mZoomHistory.append(ZoomView());
+    mZoomHistoryIdx++;
+    while(mZoomHistory.length() > mZoomHistoryDepth){
+        mZoomHistory.removeFirst();
+        mZoomHistoryIdx--;
+    }
+    emit zoomHistoryChanged();
+}
+
+/*!
+ * \brief IPCScope::zoomBack. Go back to the previous view of the zoom history. Return false if there is none.
+ */
+bool IPCScope::zoomBack()
+{
+    if(!canZoomBack()){
+        return false;
+    }
+    storeZoomView();
+    showZoomView(--mZoomHistoryIdx);
+    emit zoomHistoryChanged();
+    return true;
+}
+
+/*!
+ * \brief IPCScope::zoomForward. Go forward to the next view of the zoom history. Return false if there is none.
+ */
+bool IPCScope::zoomForward()
+{
+    if(!canZoomForward()){
+        return false;
+    }
+    storeZoomView();
+    showZoomView(++mZoomHistoryIdx);
+    emit zoomHistoryChanged();
+    return true;
+}
+
+/*!
+ * \brief IPCScope::clearZoomHistory. Drop the zoom history and its cached renders.
+ */
+void IPCScope::clearZoomHistory()
+{
+    mZoomHistory.clear();
+    mZoomHistoryIdx = -1;
+    if(mZoomFrameItem){
+        mZoomFrameItem->hide();
+        mZoomFrameItem->setPixmap(QPixmap());
+    }
+    emit zoomHistoryChanged();
+}
+
+/*!
+ * \brief IPCScope::setZoomHistoryDepth. Set the maximum number of views in the zoom history, the oldest are dropped.
+ * A depth below 2 disables the history.
+ * \param depth
+ */
+void IPCScope::setZoomHistoryDepth(int depth)
+{
+    mZoomHistoryDepth = qMax(0, depth);
+    if(mZoomHistoryDepth < 2){
+        clearZoomHistory();
+        return;
+    }
+    while(mZoomHistory.length() > mZoomHistoryDepth){
+        mZoomHistory.removeFirst();
+        mZoomHistoryIdx--;
+    }
+    if(mZoomHistoryIdx < 0 && !mZoomHistory.isEmpty()){
+        mZoomHistoryIdx = 0;
+    }
+}
+
+/*!
+ * \brief IPCScope::showZoomView. Show a view of the zoom history: its cached render covers the plot area at once, and
+ * the graphs are re-culled for its range on the next pass of the event loop. The render is only used if the plot area
+ * kept its size.
+ * \param historyIdx
+ */
+void IPCScope::showZoomView(int historyIdx)
+{
+    if(mAxesList.length() < 2){
+        qDebug() << Q_FUNC_INFO << "x and y axes must be attached to the scope before.";
+        return;
+    }
+    const ZoomView &view = mZoomHistory.at(historyIdx);
+    QRectF plotArea = mChart->plotArea();
+    QSizeF frameSize = view.frame.size()/view.frame.devicePixelRatio();
+    if(!view.frame.isNull() && (qAbs(frameSize.width() - plotArea.width()) < 1.5)
+            && (qAbs(frameSize.height() - plotArea.height()) < 1.5)){
+        if(!mZoomFrameItem){
+            mZoomFrameItem = new QGraphicsPixmapItem;
+            mZoomFrameItem->setZValue(1e6);
+            scene()->addItem(mZoomFrameItem);
+        }
+        mZoomFrameItem->setPixmap(view.frame);
+        mZoomFrameItem->setPos(mChart->mapToScene(plotArea.topLeft()));
+        mZoomFrameItem->show();
+    }
+    // Axes only, the graphs follow in finishZoomView(): the axes queue no re-cull of their own
+    mRecullPending = true;
+    mAxesList.at(0)->setRange(view.range.left(), view.range.right());
+    mAxesList.at(1)->setRange(view.range.top(), view.range.bottom());
+    cosmeticTicksInterval();
+    QTimer::singleShot(0, this, &IPCScope::finishZoomView);
+}
+
+/*!
+ * \brief IPCScope::finishZoomView. Re-cull the graphs for the range shown in a worker thread, on copies of their
+ * cullers, then replace the series and drop the cached render in the GUI thread. The result is dropped if the range,
+ * or the data of a graph, changed meanwhile.
+ */
+void IPCScope::finishZoomView()
+{
+    IPC_TRACE_SPAN("IPCScope::finishZoomView");
+    mRecullPending = false;
+    foreach(IPCMarker *marker, mMarkerList){
+        marker->updatePosition();
+    }
+    const QRectF range = visibleRange();
+    const bool xLog = (mScopeType == stpSemiLogX) || (mScopeType == stpLogLog);
+    const int decimationWidth = mDecimationEnabled ? qMax(1, qRound(mChart->plotArea().width())) : 0;
+    QList<ZoomCull> culls;
+    foreach(QAbstractSeries *s, mGraphsList){
+        IPCViewportCuller *culler = mCullerHash.value(s);
+        if(!culler || !xySeries(s)){
+            continue;
+        }
+        ZoomCull cull;
+        cull.graph = s;
+        cull.range = storedRange(mUnitHash.value(s).transform, range);
+        if(culler->isCulled(cull.range, decimationWidth)){
+            continue;
+        }
+        cull.culler = *culler;
+        cull.connected = s->type() != QAbstractSeries::SeriesTypeScatter;
+        culls.append(cull);
+    }
+    const int generation = ++mZoomCullGeneration;
+    if(culls.isEmpty()){
+        if(mZoomFrameItem){
+            mZoomFrameItem->hide();
+        }
+        return;
+    }
+    QFutureWatcher<QList<ZoomCull> > *watcher = new QFutureWatcher<QList<ZoomCull> >(this);
+    connect(watcher, &QFutureWatcher<QList<ZoomCull> >::finished, this, [this, watcher, generation, range]() {
+        watcher->deleteLater();
+        if(generation != mZoomCullGeneration){
+            // A newer view is being re-culled
+            return;
+        }
+        if(visibleRange() == range){
+            foreach(const ZoomCull &cull, watcher->result()){
+                IPCViewportCuller *culler = mCullerHash.value(cull.graph);
+                QXYSeries *series = mGraphsList.contains(cull.graph) ? xySeries(cull.graph) : nullptr;
+                if(!culler || !series || (culler->source().constData() != cull.culler.source().constData())){
+                    continue;
+                }
+                // The copy keeps the grid built in the worker
+                *culler = cull.culler;
+                series->replace(mUnitHash.value(cull.graph).transform.apply(cull.points));
+            }
+        }
+        if(mZoomFrameItem){
+            mZoomFrameItem->hide();
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([culls, decimationWidth, xLog]() {
+        QList<ZoomCull> result = culls;
+        for(int i = 0; i < result.size(); i++){
+            ZoomCull &cull = result[i];
+            cull.points = cull.culler.cull(cull.range, cull.connected, decimationWidth, xLog);
+        }
+        return result;
+    }));
+}
+
+/*!
+ * \brief IPCScope::applyLinkedView. Align the scope on a linked scope: the axes are set without intermediate updates,
+ * then the graphs are re-culled, the markers moved and the table updated once. Unchanged values are skipped. Markers
+ * are matched by index.
+ * \param range Visible range, in graph's coordinates (the top is the minimum y value)
+ * \param linkX Apply the x range
+ * \param linkY Apply the y range
+ * \param markerKeys
+ */
+void IPCScope::applyLinkedView(const QRectF &range, bool linkX, bool linkY, const QList<double> &markerKeys)
+{
+    IPC_TRACE_SPAN("IPCScope::applyLinkedView");
+    if(mAxesList.length() < 2)
+    {
+        qDebug() << Q_FUNC_INFO << "x and y axes must be attached to the scope before.";
+        return;
+    }
+    QRectF current = visibleRange();
+    bool rangeChanged = false;
+    if(linkX && ((current.left() != range.left()) || (current.right() != range.right()))){
+        mAxesList.at(0)->setRange(range.left(), range.right());
+        rangeChanged = true;
+    }
+    if(linkY && ((current.top() != range.top()) || (current.bottom() != range.bottom()))){
+        mAxesList.at(1)->setRange(range.top(), range.bottom());
+        rangeChanged = true;
+    }
+    if(rangeChanged){
+        cosmeticTicksInterval();
+        recullGraphs();
+    }
+    bool markersChanged = false;
+    for(int i = 0; i < mMarkerList.length(); i++){
+        IPCMarker *marker = mMarkerList.at(i);
+        if((i < markerKeys.length()) && (marker->graphKey() != markerKeys.at(i))){
+            marker->setGraphKey(markerKeys.at(i));
+            markersChanged = true;
+        } else if(rangeChanged){
+            marker->updatePosition();
+        }
+    }
+    if(markersChanged){
+        for(int i = 0; i < mMarkerList.length(); i++){
+            markerTable()->setMarkerPos(i, mMarkerList.at(i)->pos());
+        }
+        updateGeometry();
+    }
+}
+
+/*!
+ * \brief IPCScope::setZoomRange. Zoom into a range defined by its coordinates. It is noted that the points are given in
+ * graph's coordinates. p1 is the top left point and p2 is the bottom right point.
+ * \param xp1
+ * \param yp1
+ * \param xp2
+ * \param yp2
+ */
+void IPCScope::setZoomRange(qreal xp1, qreal yp1, qreal xp2, qreal yp2)
+{
+    if(mAxesList.length() < 2)
+    {
+        qDebug() << Q_FUNC_INFO << "x and y axes must be attached to the scope before.";
+        return;
+    }
+    mZoomRangeX.setMin(xp1);
+    mZoomRangeX.setMax(xp2);
+    mZoomRangeY.setMin(yp2);
+    mZoomRangeY.setMax(yp1);
+    QAbstractAxis *xAxis = mAxesList.at(0);
+    QAbstractAxis *yAxis = mAxesList.at(1);
+    /* Before setting the range, we need to update the tick interval first
+     * to limit the excessive number of ticks
+    */
+    if(mScopeType == stpSemiLogX){
+        QValueAxis *axis = static_cast<QValueAxis *>(yAxis);
+        axis->setTickInterval(mZoomRangeY.max() - mZoomRangeY.min());
+    } else if(mScopeType == stpSemiLogY){
+        QValueAxis *axis = static_cast<QValueAxis *>(xAxis);
+        axis->setTickInterval(mZoomRangeX.max() - mZoomRangeX.min());
+    } else if (mScopeType == stpLinear){
+        QValueAxis *xaxis = static_cast<QValueAxis *>(xAxis);
+        QValueAxis *yaxis = static_cast<QValueAxis *>(yAxis);
+        xaxis->setTickInterval(mZoomRangeX.max() - mZoomRangeX.min());
+        yaxis->setTickInterval(mZoomRangeY.max() - mZoomRangeY.min());
+    }
+
+    xAxis->setRange(xp1, xp2);
+    yAxis->setRange(yp2, yp1);
 
     /*
      * Reupdate the tick for cosmetic look
     */
     cosmeticTicksInterval();
+    recullGraphs();
 
     foreach(IPCMarker *marker, mMarkerList){
         marker->updatePosition();
@@ -876,6 +3134,7 @@ void IPCScope::setZoomRange(QPointF topLeft, QPointF bottomRight)
      * Reupdate the tick for cosmetic look
     */
     cosmeticTicksInterval();
+    recullGraphs();
 
     foreach(IPCMarker *marker, mMarkerList){
         marker->updatePosition();
@@ -901,6 +3160,7 @@ void IPCScope::setZoomRange(QRectF boundingRect)
      * Reupdate the tick for cosmetic look
     */
     cosmeticTicksInterval();
+    recullGraphs();
 
     foreach(IPCMarker *marker, mMarkerList){
         marker->updatePosition();
@@ -958,21 +3218,15 @@ void IPCScope::setZoomFit()
 {
     QRectF contentBoundingRect = QRectF(0,0,0,0);
 
-    foreach(QAbstractSeries *s, mGraphsList){
-        QVector<QPointF> points;
-        QRectF rect;
-        if((s->type() == QAbstractSeries::SeriesTypeLine)||(s->type() == QAbstractSeries::SeriesTypeScatter)){
-            QXYSeries *series = static_cast<QXYSeries *>(s);
-            points = series->pointsVector();
-            rect = boundingRectF(points);
-            contentBoundingRect = rect.united(contentBoundingRect);
-        } else if(s->type() == QAbstractSeries::SeriesTypeArea){
-            QAreaSeries *series = static_cast<QAreaSeries *>(s);
-            QLineSeries *upperLineSeries = series->upperSeries();
-            points = upperLineSeries->pointsVector();
-            rect = boundingRectF(points);
-            contentBoundingRect = rect.united(contentBoundingRect);
+    for(int i = 0; i < mGraphsList.length(); i++){
+        // Full data of the graph, the series may only hold the visible points
+        QRectF rect = boundingRectF(graphPoints(i));
+        // Unit transforms are non decreasing: the shown bounds are the transformed bounds
+        IPCUnitTransform unit = mUnitHash.value(mGraphsList.at(i)).transform;
+        if(!unit.isIdentity() && !rect.isNull()){
+            rect = QRectF(QPointF(rect.left(), unit.apply(rect.top())), QPointF(rect.right(), unit.apply(rect.bottom())));
         }
+        contentBoundingRect = rect.united(contentBoundingRect);
     }
     // Zoom into the rect
     setZoomRange(contentBoundingRect);
@@ -1009,14 +3263,15 @@ void IPCScope::addMarker()
     // Attatch the active graph to the marker
     if(mActiveGraphIdx >= 0){
         QAbstractSeries *graph = mGraphsList[mActiveGraphIdx];
-        marker->setGraph(graph);
+        marker->setValueTransform(graphUnitTransform(mActiveGraphIdx));
+        marker->setGraph(graph, graphPoints(mActiveGraphIdx));
     }
     marker->setZValue(11);
     marker->show();
     // Add the marker into the internal list
     mMarkerList.append(marker);
     // Add marker into the marker table for value display
-    mMarkerTable->addMarker(marker->name(), marker->pos());
+    markerTable()->addMarker(marker->name(), marker->pos());
     // Setup marker look according to the scope theme
     foreach(IPCMarker *marker, mMarkerList){
         marker->setColor(mMarkerColor);
@@ -1070,6 +3325,7 @@ void IPCScope::clearMarkers()
  */
 void IPCScope::setMarkerKeyValue(int markerIdx, double val)
 {
+    IPC_TRACE_SPAN("IPCScope::setMarkerKeyValue");
     if((markerIdx < 0) || (markerIdx > mMarkerList.length()-1)){
         qDebug() << Q_FUNC_INFO << "index out of range:" << markerIdx;
         return;
@@ -1078,6 +3334,7 @@ void IPCScope::setMarkerKeyValue(int markerIdx, double val)
     // Update the marker values in the marker table
     mMarkerTable->setMarkerPos(markerIdx, mMarkerList.at(markerIdx)->pos());
     updateGeometry();
+    emit markerKeyChanged(markerIdx);
 }
 
 /*!
@@ -1086,11 +3343,13 @@ void IPCScope::setMarkerKeyValue(int markerIdx, double val)
  */
 void IPCScope::setMarkerKeyValue(double val)
 {
+    IPC_TRACE_SPAN("IPCScope::setMarkerKeyValue");
     if(mActiveMarkerIdx>=0){
         mMarkerList.at(mActiveMarkerIdx)->setGraphKey(val);
         // Update the marker values in the marker table
         mMarkerTable->setMarkerPos(mActiveMarkerIdx, mMarkerList.at(mActiveMarkerIdx)->pos());
         updateGeometry();
+        emit markerKeyChanged(mActiveMarkerIdx);
     }
 }
 
@@ -1183,6 +3442,35 @@ void IPCScope::setMarkerTablePosition(MarkerTablePosition pos)
 {
     mMarkerTablePos = pos;
     updateMarkerTablePosition();
+    updateStatisticsTablePosition();
+}
+
+/*!
+ * \brief IPCScope::setMarkerTableVisible. Show or hide the marker table.
+ * \param visible
+ */
+void IPCScope::setMarkerTableVisible(bool visible)
+{
+    mMarkerTableVisible = visible;
+    if(mMarkerTable){
+        mMarkerTable->setVisible(visible);
+    }
+    updateStatisticsTablePosition();
+}
+
+/*!
+ * \brief IPCScope::setStatisticsTableVisible. Show or hide the statistics table, created on first show.
+ * \param visible
+ */
+void IPCScope::setStatisticsTableVisible(bool visible)
+{
+    mStatisticsTableVisible = visible;
+    if(visible){
+        statisticsTable()->setVisible(true);
+        updateStatisticsTable();
+    } else if(mStatisticsTable){
+        mStatisticsTable->setVisible(false);
+    }
 }
 
 /*!
@@ -1240,6 +3528,7 @@ void IPCScope::setLegendPosition(LegendPosition pos)
  */
 void IPCScope::setScopeThemeDark()
 {
+    mScopeTheme = stDark;
     /* Axes and grid */
     foreach(QAbstractAxis *axis, mAxesList){
         axis->setLabelsColor(QColor("#ffffff"));
@@ -1260,7 +3549,12 @@ void IPCScope::setScopeThemeDark()
     foreach(IPCMarker *marker, mMarkerList){
         marker->setColor(mMarkerColor);
     }
-    mMarkerTable->setColor(mMarkerColor);
+    if(mMarkerTable){
+        mMarkerTable->setColor(mMarkerColor);
+    }
+    if(mStatisticsTable){
+        mStatisticsTable->setColor(mMarkerColor);
+    }
     /* Background */
     mChart->setBackgroundBrush(QBrush(QColor("#000000")));
 }
@@ -1270,6 +3564,7 @@ void IPCScope::setScopeThemeDark()
  */
 void IPCScope::setScopeThemeLight()
 {
+    mScopeTheme = stLight;
     /* Axes and grid */
     foreach(QAbstractAxis *axis, mAxesList){
         axis->setLabelsColor(QColor("#000000"));
@@ -1290,7 +3585,12 @@ void IPCScope::setScopeThemeLight()
     foreach(IPCMarker *marker, mMarkerList){
         marker->setColor(mMarkerColor);
     }
-    mMarkerTable->setColor(mMarkerColor);
+    if(mMarkerTable){
+        mMarkerTable->setColor(mMarkerColor);
+    }
+    if(mStatisticsTable){
+        mStatisticsTable->setColor(mMarkerColor);
+    }
     /* Background */
     mChart->setBackgroundBrush(QBrush(QColor("#ffffff")));
 }
@@ -1312,6 +3612,46 @@ void IPCScope::setScopeTheme(ScopeTheme theme)
     }
 }
 
+/*!
+ * \brief IPCScope::markerTable. Return the marker table, created on first use.
+ * \return
+ */
+IPCMarkerTable *IPCScope::markerTable() const
+{
+    if(!mMarkerTable){
+        QElapsedTimer timer;
+        timer.start();
+        // The table is a lazily created part of the scope, hence the cast
+        IPCScope *self = const_cast<IPCScope *>(this);
+        mMarkerTable = new IPCMarkerTable(self);
+        mMarkerTable->setFont(mMarkerFont);
+        mMarkerTable->setColor(mMarkerColor);
+        mMarkerTable->setVisible(mMarkerTableVisible);
+        self->updateMarkerTablePosition();
+        mDeferredSetupTime += timer.nsecsElapsed();
+    }
+    return mMarkerTable;
+}
+
+/*!
+ * \brief IPCScope::statisticsTable. Return the statistics table, created on first use.
+ * \return
+ */
+IPCStatisticsTable *IPCScope::statisticsTable() const
+{
+    if(!mStatisticsTable){
+        IPCScope *self = const_cast<IPCScope *>(this);
+        mStatisticsTable = new IPCStatisticsTable(self);
+        QFont font = mMarkerFont;
+        font.setBold(false);
+        mStatisticsTable->setFont(font);
+        mStatisticsTable->setColor(mMarkerColor);
+        mStatisticsTable->setVisible(mStatisticsTableVisible);
+        self->updateStatisticsTablePosition();
+    }
+    return mStatisticsTable;
+}
+
 /*!
  * \brief tableToString. Extract string fom a table. Prepare for print.
  * \param table
@@ -1397,7 +3737,7 @@ QPixmap IPCScope::toPixmap(int width, int height, double scale)
         this->render(&painter);
 
         /* Print the marker table */
-        if(mMarkerTable->isVisible()){
+        if(mMarkerTable && mMarkerTable->isVisible()){
             QString markertableText = tableToString(mMarkerTable, false, mScopeName, scale);
             QTextDocument *document = new QTextDocument();
             document->setHtml(markertableText);
@@ -1418,6 +3758,36 @@ QPixmap IPCScope::toPixmap(int width, int height, double scale)
     return result;
 }
 
+/*!
+ * \brief IPCScope::toPicture. Record the view into a picture, at the size of the scope. The marker table isn't part of
+ * the recording.
+ * \return
+ */
+QPicture IPCScope::toPicture()
+{
+    QPicture picture;
+    QPainter painter;
+    if(!painter.begin(&picture)){
+        qDebug() << Q_FUNC_INFO << "Couldn't activate painter on picture";
+        return QPicture();
+    }
+    renderView(&painter);
+    painter.end();
+    return picture;
+}
+
+/*!
+ * \brief IPCScope::renderView. Render the scene as shown in the viewport, at the size of the viewport, from the
+ * painter's origin. Only the scene is rendered: the child widgets (marker and statistics tables) aren't.
+ * \param painter
+ */
+void IPCScope::renderView(QPainter *painter)
+{
+    QRect source = viewport()->rect();
+    // A picture has no size before it is painted, the target is explicit
+    QGraphicsView::render(painter, QRectF(QPointF(0, 0), QSizeF(source.size())), source);
+}
+
 /*!
  * \brief IPCScope::savePdf. Save the scope into a pdf file.
  * \param fileName
@@ -1454,7 +3824,7 @@ void IPCScope::savePdf(const QString &fileName, int width, int height, const QSt
     this->render(&painter);
 
     /* Print the marker table */
-    if(mMarkerTable->isVisible()){
+    if(mMarkerTable && mMarkerTable->isVisible()){
         QString markertableText = tableToString(mMarkerTable, false, mScopeName, scale);
         QTextDocument *document = new QTextDocument();
         document->setHtml(markertableText);
@@ -1493,6 +3863,565 @@ bool IPCScope::savePng(const QString &fileName, int width, int height, double sc
       return false;
 }
 
+/*!
+ * \brief IPCScope::exportTiled. Save the scope to a png or tiff file (from the suffix), without holding the whole image
+ * in memory. The view is recorded once, then replayed by bands of rows in parallel, and the bands are streamed to the
+ * file in order. The bands held at a time fit in a fixed amount of memory, whatever the size of the image.
+ * \param fileName
+ * \param width
+ * \param height
+ * \param scale
+ * \param dotPerInch
+ * \param bandHeight Rows per band
+ * \return
+ */
+bool IPCScope::exportTiled(const QString &fileName, int width, int height, double scale, int dotPerInch, int bandHeight)
+{
+    int newWidth, newHeight;
+    if (width == 0 || height == 0){
+      newWidth = this->width();
+      newHeight = this->height();
+    } else{
+      newWidth = width;
+      newHeight = height;
+    }
+    int scaledWidth = qRound(scale*newWidth);
+    int scaledHeight = qRound(scale*newHeight);
+    if(scaledWidth <= 0 || scaledHeight <= 0){
+        qDebug() << Q_FUNC_INFO << "Invalid image size:" << scaledWidth << scaledHeight;
+        return false;
+    }
+    bandHeight = qBound(1, bandHeight, scaledHeight);
+
+    // Widgets can only be rendered in the GUI thread: record the view, as toPixmap() draws it, before scaling
+    QPicture picture;
+    QPainter painter;
+    if(!painter.begin(&picture)){
+        qDebug() << Q_FUNC_INFO << "Couldn't activate painter on picture";
+        return false;
+    }
+    renderView(&painter);
+    // Recorded at the size of the view, like the plot: the bands scale the whole picture
+    if(mMarkerTable && !mMarkerTable->isHidden()){
+        painter.translate(mMarkerTable->pos());
+        IPCMarkerTable::paintCells(&painter, mMarkerTable->cells());
+    }
+    painter.end();
+    const QByteArray pictureData(picture.data(), int(picture.size()));
+
+    IPCImageStreamWriter writer(IPCImageStreamWriter::formatForFileName(fileName));
+    if(!writer.open(fileName, scaledWidth, scaledHeight, dotPerInch)){
+        return false;
+    }
+
+    // Each task replays its own copy of the recording into one band
+    auto renderBand = [pictureData, scale, scaledWidth](int top, int rows) {
+        QPicture bandPicture;
+        bandPicture.setData(pictureData.constData(), uint(pictureData.size()));
+        QImage band(scaledWidth, rows, QImage::Format_ARGB32_Premultiplied);
+        band.fill(Qt::transparent);
+        QPainter bandPainter(&band);
+        bandPainter.translate(0, -top);
+        bandPainter.scale(scale, scale);
+        bandPainter.drawPicture(0, 0, bandPicture);
+        bandPainter.end();
+        return band.convertToFormat(QImage::Format_RGBA8888);
+    };
+
+    // Bands are consumed in order; as many are rendered ahead as fit in the memory allowed, at least one. A band is
+    // rendered in ARGB32 then converted, both images are held during the conversion.
+    const qint64 bandBytes = 2*4*qint64(scaledWidth)*bandHeight;
+    const int maxPending = int(qBound<qint64>(1, TiledExportPendingBytes/bandBytes,
+                                              2*qMax(1, QThread::idealThreadCount())));
+    QList<QFuture<QImage> > pending;
+    int nextTop = 0;
+    bool ok = true;
+    while(ok && (nextTop < scaledHeight || !pending.isEmpty())){
+        while(nextTop < scaledHeight && pending.size() < maxPending){
+            int rows = qMin(bandHeight, scaledHeight - nextTop);
+            pending.append(QtConcurrent::run([renderBand, nextTop, rows]() {return renderBand(nextTop, rows);}));
+            nextTop += rows;
+        }
+        ok = writer.writeBand(pending.takeFirst().result());
+    }
+    foreach(QFuture<QImage> future, pending){
+        future.waitForFinished();
+    }
+    if(!ok){
+        return false;
+    }
+    return writer.close();
+}
+
+/*!
+ * \brief IPCScope::saveVector. Save the scope to a svg or pdf file (from the suffix), keeping its size small: each
+ * graph is decimated to a min/max per column of the output resolution, collinear runs are merged, and the marker table
+ * is written as vector text. The graphs are restored once written.
+ * \param fileName
+ * \param width
+ * \param height
+ * \param dotPerInch Resolution the output is meant to be printed or zoomed at
+ * \param title
+ * \return
+ */
+bool IPCScope::saveVector(const QString &fileName, int width, int height, int dotPerInch, const QString &title)
+{
+    int newWidth, newHeight;
+    if (width == 0 || height == 0){
+      newWidth = this->width();
+      newHeight = this->height();
+    } else{
+      newWidth = width;
+      newHeight = height;
+    }
+    if(this->width() <= 0 || this->height() <= 0 || newWidth <= 0 || newHeight <= 0){
+        qDebug() << Q_FUNC_INFO << "Invalid size:" << newWidth << newHeight;
+        return false;
+    }
+    // The view is rendered at its own size, scaled to the output. Density is output pixels per scene pixel.
+    double scale = qMin(newWidth/double(this->width()), newHeight/double(this->height()));
+    double density = scale*qMax(1, dotPerInch)/96.0;
+    int columns = qMax(1, qRound(mChart->plotArea().width()*density));
+    double tolerance = 0.5/density;
+    QRectF range = visibleRange();
+    bool xLog = (mScopeType == stpSemiLogX) || (mScopeType == stpLogLog);
+
+    // Swap the decimated points in
+    QList<QXYSeries *> swappedSeries;
+    QList<QVector<QPointF> > savedPoints;
+    for(int graphIdx = 0; graphIdx < mGraphsList.length(); graphIdx++){
+        QAbstractSeries *s = mGraphsList.at(graphIdx);
+        QXYSeries *series = xySeries(s);
+        if(!series || !s->isVisible()){
+            continue;
+        }
+        bool connected = (s->type() != QAbstractSeries::SeriesTypeScatter);
+        IPCViewportCuller localCuller;
+        IPCViewportCuller *culler = mCullerHash.value(s);
+        if(!culler){
+            localCuller.setSource(graphPoints(graphIdx));
+            culler = &localCuller;
+        }
+        IPCUnitTransform unit = mUnitHash.value(s).transform;
+        QVector<QPointF> culled = unit.apply(culler->cull(storedRange(unit, range), connected, connected ? columns : 0, xLog));
+        QVector<QPointF> pixels = mapToPixels(culled, mChart->plotArea(), range, mScopeType);
+        QVector<QPointF> points;
+        if(connected){
+            points = IPCViewportCuller::mergeCollinear(culled, pixels, tolerance);
+        } else{
+            // Scatter: one point per output pixel
+            QSet<qint64> cells;
+            for(int i = 0; i < culled.size(); i++){
+                qint64 column = (qint64)floor(pixels.at(i).x()*density);
+                qint64 row = (qint64)floor(pixels.at(i).y()*density);
+                qint64 cell = (column << 32) ^ (row & 0xFFFFFFFF);
+                if(!cells.contains(cell)){
+                    cells.insert(cell);
+                    points.append(culled.at(i));
+                }
+            }
+        }
+        swappedSeries.append(series);
+        savedPoints.append(series->pointsVector());
+        series->replace(points);
+    }
+
+    // Child widgets aren't rendered, the marker table is painted as text
+    auto paint = [&](QPaintDevice *device) {
+        QPainter painter;
+        if(!painter.begin(device)){
+            return false;
+        }
+        painter.scale(scale, scale);
+        renderView(&painter);
+        if(mMarkerTable && !mMarkerTable->isHidden()){
+            painter.translate(mMarkerTable->pos());
+            IPCMarkerTable::paintCells(&painter, mMarkerTable->cells());
+        }
+        return painter.end();
+    };
+    bool ok;
+    if(QFileInfo(fileName).suffix().toLower() == "svg"){
+        QSvgGenerator generator;
+        generator.setFileName(fileName);
+        generator.setSize(QSize(newWidth, newHeight));
+        generator.setViewBox(QRect(0, 0, newWidth, newHeight));
+        generator.setTitle(title.isEmpty() ? mScopeName : title);
+        ok = paint(&generator);
+    } else{
+        QPrinter printer(QPrinter::ScreenResolution);
+        printer.setOutputFileName(fileName);
+        printer.setOutputFormat(QPrinter::PdfFormat);
+        printer.setColorMode(QPrinter::Color);
+        printer.setFullPage(true);
+        // One page of the size of the output
+        QSizeF pageSize = QSizeF(newWidth, newHeight)*72.0/printer.resolution();
+        printer.setPageLayout(QPageLayout(QPageSize(pageSize, QPageSize::Point, QString(), QPageSize::ExactMatch),
+                                          QPageLayout::Portrait, QMarginsF()));
+        printer.printEngine()->setProperty(QPrintEngine::PPK_DocumentName, title.isEmpty() ? mScopeName : title);
+        ok = paint(&printer);
+    }
+
+    for(int i = 0; i < swappedSeries.length(); i++){
+        swappedSeries.at(i)->replace(savedPoints.at(i));
+    }
+    if(!ok){
+        qDebug() << Q_FUNC_INFO << "Couldn't write" << fileName;
+    }
+    return ok;
+}
+
+/*!
+ * \brief IPCScope::startControlServer. Start a local control server (see IPCScopeServer for the command set). Return false
+ * if the server can't listen on serverName.
+ * \param serverName. Local socket name, or path.
+ * \return
+ */
+bool IPCScope::startControlServer(const QString &serverName)
+{
+    if(!mControlServer){
+        mControlServer = new IPCScopeServer(this, this);
+    }
+    return mControlServer->listen(serverName);
+}
+
+/*!
+ * \brief IPCScope::stopControlServer. Stop the local control server and disconnect its clients.
+ */
+void IPCScope::stopControlServer()
+{
+    delete mControlServer;
+    mControlServer = nullptr;
+}
+
+/*!
+ * \brief IPCScope::writeSession. Write the state of the scope to a stream: graphs and their style, markers, marker table,
+ * zoom range, legend, theme and options, and optionally the traces.
+ * \param out
+ * \param withTraces. If true, the data of each graph is also written.
+ * \return
+ */
+bool IPCScope::writeSession(QDataStream &out, bool withTraces) const
+{
+    int streamVersion = out.version();
+    out.setVersion(QDataStream::Qt_5_12);
+    out << SessionMagic << SessionVersion;
+
+    // Scope
+    out << mScopeName << (qint32)mScopeType << (qint32)mScopeTheme;
+    out << (qint32)mZoomDirection << mZoomWeight;
+    QRectF range = visibleRange();
+    out << range.left() << range.right() << range.top() << range.bottom();
+    out << mCullingEnabled << mDecimationEnabled << mHoverReadoutEnabled << (qint32)mHoverRadius;
+
+    // Legend
+    QLegend *legend = mChart->legend();
+    out << mLegendVisible << (qint32)mLegendPos << legend->font() << legend->brush() << legend->pen() << legend->labelColor();
+
+    // Marker table
+    out << mMarkerTableVisible << (qint32)mMarkerTablePos;
+
+    // Graphs
+    out << (qint32)mGraphsList.length() << (qint32)mActiveGraphIdx;
+    for(int i = 0; i < mGraphsList.length(); i++){
+        QAbstractSeries *s = mGraphsList.at(i);
+        qint32 lineStyle = lsLine;
+        QPen pen;
+        QBrush brush;
+        double markerSize = 0;
+        if(s->type() == QAbstractSeries::SeriesTypeArea){
+            QAreaSeries *area = static_cast<QAreaSeries *>(s);
+            lineStyle = lsArea;
+            pen = area->pen();
+            brush = area->brush();
+        } else{
+            QXYSeries *series = static_cast<QXYSeries *>(s);
+            pen = series->pen();
+            brush = series->brush();
+            if(s->type() == QAbstractSeries::SeriesTypeScatter){
+                lineStyle = lsScatter;
+                markerSize = static_cast<QScatterSeries *>(s)->markerSize();
+            }
+        }
+        TraceState state = mTraceStateHash.value(s, TraceState{ClearWrite, 1, 0, QVector<QPointF>()});
+        out << s->name() << lineStyle << s->isVisible() << pen << brush << markerSize;
+        out << (qint32)state.mode << (qint32)state.averageCount;
+        if(withTraces){
+            out << true;
+            if(mPendingTraceHash.contains(s)){
+                out << mPendingTraceHash.value(s);
+            } else{
+                out << IPCTraceBuffer::toBytes(graphPoints(i));
+            }
+        } else{
+            out << false;
+        }
+    }
+
+    // Markers
+    out << (qint32)mMarkerList.length() << (qint32)mActiveMarkerIdx;
+    foreach(IPCMarker *marker, mMarkerList){
+        out << marker->graphKey() << marker->color() << marker->font() << (qint32)marker->style() << marker->size()
+            << marker->interpolating();
+    }
+
+    bool ok = (out.status() == QDataStream::Ok);
+    out.setVersion(streamVersion);
+    return ok;
+}
+
+/*!
+ * \brief IPCScope::readSession. Restore the state of the scope from a stream written by writeSession(). The current graphs
+ * and markers are replaced. The session must come from a scope of the same type. The traces are decoded when the scope
+ * is shown, so that restoring many scopes doesn't wait for the hidden ones. The markers are positioned then.
+ * \param in
+ * \return
+ */
+bool IPCScope::readSession(QDataStream &in)
+{
+    int streamVersion = in.version();
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    if((magic != SessionMagic) || (version == 0) || (version > SessionVersion)){
+        qDebug() << Q_FUNC_INFO << "not a session or unsupported version:" << version;
+        in.setVersion(streamVersion);
+        return false;
+    }
+
+    // Read everything first, the scope is only modified if the stream is valid
+    QString name;
+    qint32 scopeType, theme, zoomDirection, hoverRadius;
+    double zoomWeight, xMin, xMax, yMin, yMax;
+    bool cullingEnabled, decimationEnabled, hoverReadoutEnabled;
+    in >> name >> scopeType >> theme >> zoomDirection >> zoomWeight;
+    in >> xMin >> xMax >> yMin >> yMax;
+    in >> cullingEnabled >> decimationEnabled >> hoverReadoutEnabled >> hoverRadius;
+
+    bool legendVisible;
+    qint32 legendPos;
+    QFont legendFont;
+    QBrush legendBrush;
+    QPen legendPen;
+    QColor legendLabelColor;
+    in >> legendVisible >> legendPos >> legendFont >> legendBrush >> legendPen >> legendLabelColor;
+
+    bool markerTableVisible;
+    qint32 markerTablePos;
+    in >> markerTableVisible >> markerTablePos;
+
+    struct SessionGraph {
+        QString name;
+        qint32 lineStyle;
+        bool visible;
+        QPen pen;
+        QBrush brush;
+        double markerSize;
+        qint32 traceMode;
+        qint32 averageCount;
+        bool hasTrace;
+        QByteArray trace;
+    };
+    qint32 graphCount, activeGraphIdx;
+    in >> graphCount >> activeGraphIdx;
+    QList<SessionGraph> graphs;
+    for(int i = 0; (i < graphCount) && (in.status() == QDataStream::Ok); i++){
+        SessionGraph g;
+        in >> g.name >> g.lineStyle >> g.visible >> g.pen >> g.brush >> g.markerSize >> g.traceMode >> g.averageCount;
+        in >> g.hasTrace;
+        if(g.hasTrace){
+            in >> g.trace;
+        }
+        graphs.append(g);
+    }
+
+    struct SessionMarker {
+        double key;
+        QColor color;
+        QFont font;
+        qint32 style;
+        double size;
+        bool interpolating;
+    };
+    qint32 markerCount, activeMarkerIdx;
+    in >> markerCount >> activeMarkerIdx;
+    QList<SessionMarker> markers;
+    for(int i = 0; (i < markerCount) && (in.status() == QDataStream::Ok); i++){
+        SessionMarker m;
+        in >> m.key >> m.color >> m.font >> m.style >> m.size >> m.interpolating;
+        markers.append(m);
+    }
+    in.setVersion(streamVersion);
+    if(in.status() != QDataStream::Ok){
+        qDebug() << Q_FUNC_INFO << "truncated or corrupted session";
+        return false;
+    }
+    if(scopeType != mScopeType){
+        qDebug() << Q_FUNC_INFO << "the session was saved from a scope of another type:" << scopeType;
+        return false;
+    }
+    // An enum value out of range is a corrupted session
+    bool enumsValid = (theme >= stLight) && (theme <= stDark)
+            && (zoomDirection >= zdNone) && (zoomDirection <= zdBothDirections)
+            && (legendPos >= lpTopLeft) && (legendPos <= lpBottomRight)
+            && (markerTablePos >= mpTopLeft) && (markerTablePos <= mpTopRight);
+    foreach(const SessionGraph &g, graphs){
+        enumsValid = enumsValid && (g.lineStyle >= lsScatter) && (g.lineStyle <= lsArea)
+                && (g.traceMode >= ClearWrite) && (g.traceMode <= Average);
+    }
+    foreach(const SessionMarker &m, markers){
+        enumsValid = enumsValid && (m.style >= IPCMarker::msNone) && (m.style <= IPCMarker::msSquare);
+    }
+    if(!enumsValid){
+        qDebug() << Q_FUNC_INFO << "corrupted session: enum value out of range";
+        return false;
+    }
+
+    // Apply the state, with a single repaint at the end
+    bool updatesEnabled = this->updatesEnabled();
+    setUpdatesEnabled(false);
+    clearMarkers();
+    clearGraphs();
+    mPendingTraceHash.clear();
+
+    mScopeName = name;
+    setScopeTheme((ScopeTheme)theme);
+    mZoomDirection = (ZoomDirection)zoomDirection;
+    mZoomWeight = zoomWeight;
+    setCullingEnabled(cullingEnabled);
+    setDecimationEnabled(decimationEnabled);
+    setHoverReadoutEnabled(hoverReadoutEnabled);
+    mHoverRadius = hoverRadius;
+
+    setLegendVisible(legendVisible);
+    setLegendFont(legendFont);
+    setLegendBrush(legendBrush);
+    setLegendBorderPen(legendPen);
+    setLegendLabelColor(legendLabelColor);
+    setLegendPosition((LegendPosition)legendPos);
+
+    for(int i = 0; i < graphs.length(); i++){
+        const SessionGraph &g = graphs.at(i);
+        addGraph(g.name, (LineStyle)g.lineStyle);
+        QAbstractSeries *s = mGraphsList.last();
+        if(s->type() == QAbstractSeries::SeriesTypeArea){
+            QAreaSeries *area = static_cast<QAreaSeries *>(s);
+            area->setPen(g.pen);
+            area->setBrush(g.brush);
+        } else{
+            QXYSeries *series = static_cast<QXYSeries *>(s);
+            series->setPen(g.pen);
+            series->setBrush(g.brush);
+            if(s->type() == QAbstractSeries::SeriesTypeScatter){
+                static_cast<QScatterSeries *>(s)->setMarkerSize(g.markerSize);
+            }
+        }
+        s->setVisible(g.visible);
+        if(g.traceMode != ClearWrite){
+            setGraphTraceMode(i, (TraceMode)g.traceMode);
+            setGraphAverageCount(i, g.averageCount);
+        }
+        if(g.hasTrace && !g.trace.isEmpty()){
+            mPendingTraceHash.insert(s, g.trace);
+        }
+    }
+
+    // The markers are added without a graph, addMarker() would decode the trace of the active graph. They are bound
+    // to it below without its points: updateGraphSeries() positions them when applyPendingTraces() decodes it.
+    mActiveGraphIdx = -1;
+    for(int i = 0; i < markers.length(); i++){
+        const SessionMarker &m = markers.at(i);
+        addMarker();
+        IPCMarker *marker = mMarkerList.last();
+        marker->setStyle((IPCMarker::MarkerStyle)m.style);
+        marker->setSize(m.size);
+        marker->setInterpolating(m.interpolating);
+        marker->setGraphKey(m.key);
+        setMarkerColor(i, m.color);
+        setMarkerFont(i, m.font);
+        emit markerKeyChanged(i);
+    }
+    if((activeGraphIdx >= 0) && (activeGraphIdx < mGraphsList.length())){
+        mActiveGraphIdx = activeGraphIdx;
+        for(int i = 0; i < mMarkerList.length(); i++){
+            IPCMarker *marker = mMarkerList.at(i);
+            marker->setValueTransform(graphUnitTransform(mActiveGraphIdx));
+            marker->setGraph(mGraphsList.at(mActiveGraphIdx), QVector<QPointF>());
+            mMarkerTable->setMarkerPos(i, marker->pos());
+        }
+    }
+    if((activeMarkerIdx >= 0) && (activeMarkerIdx < mMarkerList.length())){
+        mActiveMarkerIdx = activeMarkerIdx;
+    }
+    setMarkerTableVisible(markerTableVisible);
+    setMarkerTablePosition((MarkerTablePosition)markerTablePos);
+
+    setZoomRange(xMin, yMax, xMax, yMin);
+    if(isVisible()){
+        applyPendingTraces();
+    }
+    setUpdatesEnabled(updatesEnabled);
+    return true;
+}
+
+/*!
+ * \brief IPCScope::saveSession. Save the session of the scope to a file.
+ * \param fileName
+ * \param withTraces. If true, the data of each graph is also saved.
+ * \return
+ */
+bool IPCScope::saveSession(const QString &fileName, bool withTraces) const
+{
+    QSaveFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly)){
+        qDebug() << Q_FUNC_INFO << "couldn't open" << fileName << ":" << file.errorString();
+        return false;
+    }
+    QDataStream out(&file);
+    if(!writeSession(out, withTraces)){
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+/*!
+ * \brief IPCScope::loadSession. Restore the session of the scope from a file.
+ * \param fileName
+ * \return
+ */
+bool IPCScope::loadSession(const QString &fileName)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly)){
+        qDebug() << Q_FUNC_INFO << "couldn't open" << fileName << ":" << file.errorString();
+        return false;
+    }
+    QDataStream in(&file);
+    return readSession(in);
+}
+
+/*!
+ * \brief IPCScope::applyPendingTraces. Decode and display the traces restored from a session. Graphs which received new
+ * data since then have no pending trace anymore.
+ */
+void IPCScope::applyPendingTraces()
+{
+    if(mPendingTraceHash.isEmpty()){
+        return;
+    }
+    QHash<QAbstractSeries *, QByteArray> pending;
+    pending.swap(mPendingTraceHash);
+    for(int i = 0; i < mGraphsList.length(); i++){
+        QAbstractSeries *s = mGraphsList.at(i);
+        if(pending.contains(s)){
+            // Shown as is: a restored trace isn't a new acquisition for the trace modes and the history
+            updateGraphSeries(i, IPCTraceBuffer::fromBytes(pending.value(s)));
+        }
+    }
+}
+
 /*!
  * \brief IPCScope::graphsNameList. Return a list of graph's name.
  * \return
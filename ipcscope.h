@@ -10,6 +10,21 @@
 #include "ipcrange.h"
 #include "ipcmarker.h"
 #include "ipcmarkertable.h"
+#include "ipctracebuffer.h"
+#include "ipcrefreshscheduler.h"
+#include "ipctracehistory.h"
+#include "ipcviewportculler.h"
+#include "ipcspatialindex.h"
+#include "ipcscopeserver.h"
+#include "ipcmemorybudget.h"
+#include "ipcspectrum.h"
+#include "ipcrollbuffer.h"
+#include "ipcscopemodel.h"
+#include "ipctracer.h"
+#include "ipcsampleconverter.h"
+#include "ipcunittransform.h"
+#include "ipcstatistics.h"
+#include "ipcstatisticstable.h"
 
 using namespace QtCharts;
 
@@ -66,12 +81,20 @@ public:
                        };
     Q_ENUMS(MarkerTablePosition)
 
+    enum StatisticsMode{ smNone         /// No statistics
+                        ,smTrace        /// Statistics of the values of the last trace
+                        ,smRunning      /// Statistics of all the values since the last reset
+                       };
+    Q_ENUMS(StatisticsMode)
+
     // A scope has a chart and a chartview
     QChart *mChart;
 
     // Setters
     void setName(const QString &name){mScopeName = name;}
     void setOpenGLEnabled(bool enable);
+    // Bring the scope back to the state of a new scope, before it is reused (see IPCScopePool). The style is kept.
+    void resetForReuse();
 
     // Methods concerning the graphs
     void setActiveGraphIdx(int graphIdx);
@@ -93,6 +116,68 @@ public:
     void setGraphData(double *x, double *y, int len);
     void setGraphData(QString name, QVector<QPointF> points);
     void setGraphData(QString name, double *x, double *y, int len);
+    // Raw digitizer samples, evenly spaced (x = x0 + i*dx) and scaled by the gain and offset of the graph. Interleaved
+    // blocks fill graphs firstGraphIdx to firstGraphIdx+channels-1 in one pass.
+    void setGraphGain(int graphIdx, double gain, double offset = 0);
+    double graphGain(int graphIdx) const;
+    double graphOffset(int graphIdx) const;
+    void setGraphSamples(int graphIdx, const qint16 *samples, int count, double x0 = 0, double dx = 1, int stride = 1);
+    void setGraphSamples(int graphIdx, const qint32 *samples, int count, double x0 = 0, double dx = 1, int stride = 1);
+    void setGraphSamples(int graphIdx, const float *samples, int count, double x0 = 0, double dx = 1, int stride = 1);
+    void setGraphSamplesInterleaved(int firstGraphIdx, const qint16 *samples, int frames, int channels, double x0 = 0,
+                                    double dx = 1);
+    void setGraphSamplesInterleaved(int firstGraphIdx, const qint32 *samples, int frames, int channels, double x0 = 0,
+                                    double dx = 1);
+    void setGraphSamplesInterleaved(int firstGraphIdx, const float *samples, int frames, int channels, double x0 = 0,
+                                    double dx = 1);
+    // Units. The data stays in the stored unit, only the shown points, the markers and the hover readout are converted.
+    void setGraphUnit(int graphIdx, IPCUnitTransform::Unit storedUnit, IPCUnitTransform::Unit shownUnit,
+                      double impedance = 50);
+    void setGraphShownUnit(int graphIdx, IPCUnitTransform::Unit shownUnit);
+    IPCUnitTransform graphUnitTransform(int graphIdx) const;
+    // Statistics of the y values given to the graph, in its shown unit, before any trace mode. The memory used is
+    // constant whatever the number of traces or points.
+    void setGraphStatisticsMode(int graphIdx, StatisticsMode mode);
+    StatisticsMode graphStatisticsMode(int graphIdx) const;
+    IPCStatistics graphStatistics(int graphIdx) const;
+    void resetGraphStatistics(int graphIdx);
+    // Spectrum display: time samples are transformed by the graph spectrum front end before reaching the graph
+    IPCSpectrum *graphSpectrum(int graphIdx);
+    void setGraphTimeSamples(int graphIdx, const double *samples, int count);
+    void setGraphTimeSamples(int graphIdx, const std::complex<double> *samples, int count);
+    // Roll mode (strip chart): points are appended to a fixed capacity ring, and the x axis scrolls to show the last
+    // rollSpan of the most recent x. Appended x values must not decrease.
+    void setGraphRollMode(int graphIdx, bool enabled, int capacity = 100000);
+    bool graphRollMode(int graphIdx) const;
+    const IPCRollBuffer *graphRollBuffer(int graphIdx) const;
+    void appendGraphData(int graphIdx, const QPointF &point);
+    void appendGraphData(int graphIdx, double x, double y);
+    void appendGraphData(int graphIdx, const QVector<QPointF> &points);
+    void setRollSpan(double span);
+    double rollSpan() const {return mRollSpan;}
+    // Trace mode
+    void setGraphTraceMode(int graphIdx, TraceMode mode);
+    void setGraphAverageCount(int graphIdx, int count);
+    TraceMode graphTraceMode(int graphIdx) const;
+    // Shared trace buffers
+    void attachTraceBuffer(int graphIdx, IPCTraceBuffer *buffer);
+    void detachTraceBuffer(int graphIdx);
+    IPCTraceBuffer *traceBuffer(int graphIdx) const;
+    // Trace history. While a graph shows a history frame, live data is still recorded but not displayed.
+    void setGraphHistoryEnabled(int graphIdx, bool enabled);
+    IPCTraceHistory *graphHistory(int graphIdx) const;
+    void showHistoryFrame(int graphIdx, int frameIdx);
+    void replayHistory(int graphIdx, int firstFrameIdx, int lastFrameIdx, double framesPerSecond);
+    void stopReplay();
+    void showLive(int graphIdx);
+
+    // Viewport culling: only the visible points (optionally decimated to a min/max per pixel column) reach the renderer
+    void setCullingEnabled(bool enabled);
+    void setDecimationEnabled(bool enabled);
+
+    // Hover readout: a tooltip shows the data point closest to the cursor
+    void setHoverReadoutEnabled(bool enabled);
+    void setHoverRadius(int pixels){mHoverRadius = pixels;}
 
     // Methods concerning zoom
     void setZoomDirection(const ZoomDirection &dir){mZoomDirection = dir;}
@@ -101,6 +186,31 @@ public:
     void setZoomRange(QPointF topLeft, QPointF bottomRight);
     void setZoomRange(QRectF boundingRect);
     void setZoomFit();
+    // Zoom history of the user zooms (wheel, rubber band, double click). With culling, each view keeps a render of its
+    // plot area, shown at once when going back or forward while the graphs are re-culled for the range.
+    bool zoomBack();
+    bool zoomForward();
+    bool canZoomBack() const {return mZoomHistoryIdx > 0;}
+    bool canZoomForward() const {return mZoomHistoryIdx < mZoomHistory.length()-1;}
+    void clearZoomHistory();
+    void setZoomHistoryDepth(int depth);
+    int zoomHistoryDepth() const {return mZoomHistoryDepth;}
+
+    // Linked views (see IPCScopeLinkGroup): set the ranges and marker keys at once, re-culling and moving markers once
+    void applyLinkedView(const QRectF &range, bool linkX, bool linkY, const QList<double> &markerKeys = QList<double>());
+
+    // Memory accounting. Data shared between graphs, scopes or categories is counted once per set of counted pointers.
+    qint64 graphMemoryUsage(int graphIdx, IPCMemoryBudget::Category category, QSet<const void *> *counted = nullptr) const;
+    qint64 graphMemoryUsage(int graphIdx) const;
+    qint64 memoryUsage(IPCMemoryBudget::Category category) const;
+    qint64 memoryUsage() const;
+    qint64 releaseCaches(int graphIdx);
+    // Renders of the zoom history, counted with the culling caches
+    qint64 zoomHistoryMemoryUsage() const;
+    qint64 releaseZoomRenders();
+
+    // Coordinated repaints. With a scheduler, the viewport is repainted once per display frame at most.
+    void setRefreshScheduler(IPCRefreshScheduler *scheduler, IPCRefreshScheduler::Priority priority = IPCRefreshScheduler::rpNormal);
 
     // Save and load
     bool saveGraph(int graphIdx, const QString &fileName);
@@ -119,8 +229,10 @@ public:
     void setMarkerFont(int markerIdx, const QFont &font);
     void setMarkerFont(const QFont &font);
     void setMarkersFont(const QFont &font);
-    void setMarkerTableVisible(bool visible){mMarkerTableVisible = visible; mMarkerTable->setVisible(visible);}
+    void setMarkerTableVisible(bool visible);
     void setMarkerTablePosition(MarkerTablePosition pos);
+    // Statistics table, below the marker table. Hidden by default.
+    void setStatisticsTableVisible(bool visible);
 
     // Legend
     void setLegendVisible(bool visible){mLegendVisible = visible; mChart->legend()->setVisible(visible);}
@@ -137,11 +249,37 @@ public:
 
     // Printing to pdf file, image, etc.
     QPixmap toPixmap(int width, int height, double scale);
+    // Vector recording of the view, without the marker table
+    QPicture toPicture();
     void savePdf(const QString &fileName, int width, int height, const QString &pdfCreator, const QString &pdfTitle);
     bool savePng(const QString &fileName, int width=0, int height=0, double scale=1.0, int quality=-1, int dotPerInch=96);
+    // Export of images larger than memory allows, rendered by bands in parallel and streamed to a png or tiff file
+    bool exportTiled(const QString &fileName, int width=0, int height=0, double scale=1.0, int dotPerInch=96,
+                     int bandHeight=512);
+    // Vector export to a svg or pdf file (from the suffix), with graphs decimated to the output resolution
+    bool saveVector(const QString &fileName, int width=0, int height=0, int dotPerInch=300, const QString &title=QString());
+
+    // Session save and restore. Several scopes can be written to the same stream. Restored traces are decoded when
+    // the scope is first shown.
+    bool writeSession(QDataStream &out, bool withTraces = true) const;
+    bool readSession(QDataStream &in);
+    bool saveSession(const QString &fileName, bool withTraces = true) const;
+    bool loadSession(const QString &fileName);
+
+    // Model rendering. The graphs, markers and zoom range of the scope follow the model, updated from any thread.
+    // Graphs must not be added to or removed from the scope directly while a model is set. Zooms and marker moves made
+    // on the scope are pushed back to the model.
+    void setModel(IPCScopeModel *model);
+    IPCScopeModel *model() const {return mModel;}
+
+    // Remote control through a local socket
+    bool startControlServer(const QString &serverName);
+    void stopControlServer();
 
     // Getters
     QString name() const {return mScopeName;}
+    ScopeType scopeType() const {return mScopeType;}
+    ScopeTheme scopeTheme() const {return mScopeTheme;}
     bool openGLEnabled() const {return mOpenGLEnabled;}
     int activeGraphIdx() const {return mActiveGraphIdx;}
     QStringList graphsNameList() const;
@@ -155,10 +293,40 @@ public:
     int markerCount(){return mMarkerList.length();}
     ZoomDirection zoomDirection() const{return mZoomDirection;}
     double zoomWeight() const{return mZoomWeight;}
-    IPCMarkerTable * const & markerTable() const {return mMarkerTable;}
+    IPCMarkerTable *markerTable() const;
+    IPCStatisticsTable *statisticsTable() const;
+    bool statisticsTableVisible() const {return mStatisticsTableVisible;}
     QLegend * legend(){return mChart->legend();}    
+    IPCRefreshScheduler *refreshScheduler() const {return mRefreshScheduler;}
+    bool cullingEnabled() const {return mCullingEnabled;}
+    bool decimationEnabled() const {return mDecimationEnabled;}
+    QVector<QPointF> graphPoints(int graphIdx) const;
+    bool hoverReadoutEnabled() const {return mHoverReadoutEnabled;}
+    int hoverRadius() const {return mHoverRadius;}
+    int nearestPoint(const QPointF &scenePos, int *graphIdx, QPointF *point);
+    QRectF visibleRange() const;
+    IPCScopeServer *controlServer() const {return mControlServer;}
+    // Time spent in the constructor, and in the setup deferred to first use (marker table), in ns
+    qint64 constructionTime() const {return mConstructionTime;}
+    qint64 deferredSetupTime() const {return mDeferredSetupTime;}
 
 signals:
+    void historyFrameShown(int graphIdx, int frameIdx);
+    void hoverPointChanged(int graphIdx, const QPointF &point);
+    void zoomHistoryChanged();
+    void visibleRangeChanged();
+    void markerKeyChanged(int markerIdx);
+    void aboutToBeReused();
+
+private slots:
+    void onTraceBufferFrameReady();
+    void onReplayTimeout();
+    void onSceneChanged();
+    void onAxisRangeChanged();
+    void onModelChanged(int changes);
+    void onVisibleRangeChanged();
+    void updateModelZoom();
+    void onMarkerKeyChanged(int markerIdx);
 
 protected:
     int getMinorTicks(double tickInterval);
@@ -166,9 +334,31 @@ protected:
     double cleanMantissa(double input) const;
     void updateLegendPosition();
     void updateMarkerTablePosition();
+    void updateStatisticsTablePosition();
+    void updateGraphStatistics(QAbstractSeries *graph, const QVector<QPointF> &points, bool newTrace);
+    void scheduleStatisticsTable();
+    void updateStatisticsTable();
     void cosmeticTicksInterval();
+    void cosmeticTicks(QValueAxis *axis, double length);
     void updateGeometry();
+    void updateGraphSeries(int graphIdx, const QVector<QPointF> &points);
+    QVector<QPointF> applyTraceMode(QAbstractSeries *graph, const QVector<QPointF> &points);
+    void recullGraphs();
+    void appendRollData(int graphIdx, const QVector<QPointF> &points, bool newData);
+    void trimRollSeries(QAbstractSeries *graph);
+    void scrollRoll(double x);
+    template <typename T> void ingestSamples(int graphIdx, const T *samples, int count, double x0, double dx, int stride);
+    template <typename T> void ingestInterleaved(int firstGraphIdx, const T *samples, int frames, int channels, double x0,
+                                                 double dx);
+    void pushZoomHistory();
+    void storeZoomView();
+    void showZoomView(int historyIdx);
+    void finishZoomView();
+    void applyPendingTraces();
+    void renderView(QPainter *painter);
     void resizeEvent(QResizeEvent *event);
+    void showEvent(QShowEvent *event);
+    void paintEvent(QPaintEvent *event);
     void wheelEvent(QWheelEvent *event);
     void mouseDoubleClickEvent(QMouseEvent *event);
     void mousePressEvent(QMouseEvent *event);
@@ -194,11 +384,15 @@ private:
     QList<QAbstractSeries *> mGraphsList;
     // A scope has a list of markers
     QList<IPCMarker *> mMarkerList;
-    // A scope has a marker table
-    IPCMarkerTable *mMarkerTable;
+    // A scope has a marker table, created on first use
+    mutable IPCMarkerTable *mMarkerTable;
     MarkerTablePosition mMarkerTablePos;
     bool mMarkerTableVisible;
     QColor mMarkerColor;
+    // Statistics table, created on first use and refreshed once per pass of the event loop
+    mutable IPCStatisticsTable *mStatisticsTable;
+    bool mStatisticsTableVisible;
+    bool mStatisticsTablePending;
     // A scope has a list of axes
     QList<QAbstractAxis *> mAxesList;
     // List of predefined colors for graphs
@@ -209,12 +403,100 @@ private:
     // Zoom range
     IPCRange mZoomRangeX;
     IPCRange mZoomRangeY;
-    // Zoom rubber band
+    // Range of the axes of a new scope, top being the minimum y value
+    QRectF mDefaultRange;
+    // Zoom rubber band, created on first use
     QRubberBand *mRubberBand;
     QPoint mRubberBandOrigin;
+    // Zoom history: visible range and plot area render of each view, index of the current view (-1 if empty)
+    struct ZoomView {
+        QRectF range;
+        QPixmap frame;
+    };
+    QList<ZoomView> mZoomHistory;
+    int mZoomHistoryIdx;
+    int mZoomHistoryDepth;
+    // Wheel steps within a short delay are one history entry
+    QElapsedTimer mLastWheelZoom;
+    // Cached frame shown over the plot area until the graphs are re-culled, created on first use
+    QGraphicsPixmapItem *mZoomFrameItem;
+    // Incremented for each view re-culled in the background, older results are dropped
+    int mZoomCullGeneration;
     // Legend
     LegendPosition mLegendPos;
     bool mLegendVisible;
+    // Trace mode of the graphs. Graphs in clear write mode have no entry.
+    struct TraceState {
+        TraceMode mode;
+        int averageCount;           // Number of frames averaged in Average mode
+        int frameCount;             // Number of frames accumulated so far
+        QVector<QPointF> points;    // Held or averaged trace
+    };
+    QHash<QAbstractSeries *, TraceState> mTraceStateHash;
+    // Shared trace buffers attached to the graphs, with the index of the last frame displayed
+    QHash<QAbstractSeries *, QPointer<IPCTraceBuffer> > mTraceBufferHash;
+    QHash<QAbstractSeries *, quint64> mTraceBufferFrameHash;
+    // Refresh scheduler, if the repaints are coordinated with other scopes
+    QPointer<IPCRefreshScheduler> mRefreshScheduler;
+    // Trace histories, graphs showing a history frame and their last live frame
+    QHash<QAbstractSeries *, IPCTraceHistory *> mHistoryHash;
+    QHash<QAbstractSeries *, QVector<QPointF> > mLiveDataHash;
+    // Viewport culling
+    bool mCullingEnabled;
+    bool mDecimationEnabled;
+    bool mRecullPending;
+    QHash<QAbstractSeries *, IPCViewportCuller *> mCullerHash;
+    // Hover readout, with a nearest point index per graph
+    bool mHoverReadoutEnabled;
+    int mHoverRadius;
+    QHash<QAbstractSeries *, IPCSpatialIndex *> mIndexHash;
+    // History replay
+    QTimer *mReplayTimer;
+    QAbstractSeries *mReplayGraph;
+    int mReplayFrameIdx;
+    int mReplayLastFrameIdx;
+    // Traces restored from a session, not decoded yet
+    QHash<QAbstractSeries *, QByteArray> mPendingTraceHash;
+    // Spectrum front ends of the graphs fed with time samples
+    QHash<QAbstractSeries *, IPCSpectrum *> mSpectrumHash;
+    // Gain and offset applied to the raw samples of the graphs. Graphs with a unit gain and no offset have no entry.
+    QHash<QAbstractSeries *, QPair<double, double> > mSampleScaleHash;
+    // Units of the graphs with a stored unit. When shown in another unit without culler, the series holds the shown
+    // points and source the stored ones.
+    struct UnitState {
+        IPCUnitTransform transform;
+        QVector<QPointF> source;
+    };
+    QHash<QAbstractSeries *, UnitState> mUnitHash;
+    // Statistics of the graphs. Graphs without statistics have no entry.
+    struct StatisticsState {
+        StatisticsMode mode;
+        IPCStatistics statistics;
+    };
+    QHash<QAbstractSeries *, StatisticsState> mStatisticsHash;
+    // Roll mode graphs. The series holds the last seriesCount points appended, trimmed by chunks as they scroll out.
+    struct RollState {
+        IPCRollBuffer buffer;
+        int seriesCount;
+    };
+    QHash<QAbstractSeries *, RollState> mRollHash;
+    double mRollSpan;
+    // Right edge of the x axis at the last scroll
+    double mRollScrollX;
+    // Rendered model, with the model identifiers of the graphs and the last revision shown for each identifier
+    QPointer<IPCScopeModel> mModel;
+    QList<int> mModelGraphIds;
+    QHash<int, quint64> mModelRevisions;
+    // Set while the scope follows its model, its changes then aren't pushed back. Whether a zoom push is queued.
+    bool mModelSyncing;
+    bool mModelZoomPending;
+    // Local control server
+    IPCScopeServer *mControlServer;
+    // Process wide memory accounting the scope is registered to
+    QPointer<IPCMemoryBudget> mMemoryBudget;
+    // Construction timings
+    qint64 mConstructionTime;
+    mutable qint64 mDeferredSetupTime;
 
 };
 
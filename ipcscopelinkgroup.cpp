@@ -0,0 +1,154 @@
+#include "ipcscopelinkgroup.h"
+#include <QMetaObject>
+#include <QDebug>
+
+/*!
+ * \brief IPCScopeLinkGroup::IPCScopeLinkGroup. Constructor. The x range is linked by default.
+ * \param parent
+ */
+IPCScopeLinkGroup::IPCScopeLinkGroup(QObject *parent) :
+    QObject(parent),
+    mLinks(lkXRange),
+    mPendingLinks(0),
+    mApplyQueued(false),
+    mApplying(false)
+{
+
+}
+
+/*!
+ * \brief IPCScopeLinkGroup::addScope. Add a scope to the group, aligned on the first scope of the group.
+ * \param scope
+ */
+void IPCScopeLinkGroup::addScope(IPCScope *scope)
+{
+    if(!scope || mScopes.contains(scope)){
+        return;
+    }
+    if(!mScopes.isEmpty()){
+        apply(mScopes.first(), mLinks, QList<IPCScope *>() << scope);
+    }
+    mScopes.append(scope);
+    connect(scope, &IPCScope::visibleRangeChanged, this, &IPCScopeLinkGroup::onScopeRangeChanged);
+    connect(scope, &IPCScope::markerKeyChanged, this, &IPCScopeLinkGroup::onScopeMarkerKeyChanged);
+    connect(scope, &QObject::destroyed, this, &IPCScopeLinkGroup::onScopeDestroyed);
+    connect(scope, &IPCScope::aboutToBeReused, this, &IPCScopeLinkGroup::onScopeReused);
+}
+
+/*!
+ * \brief IPCScopeLinkGroup::removeScope. Remove a scope from the group. Its view is left as is.
+ * \param scope
+ */
+void IPCScopeLinkGroup::removeScope(IPCScope *scope)
+{
+    if(!mScopes.removeOne(scope)){
+        return;
+    }
+    disconnect(scope, nullptr, this, nullptr);
+    if(mSource == scope){
+        mSource = nullptr;
+    }
+}
+
+/*!
+ * \brief IPCScopeLinkGroup::onScopeReused. Remove a scope handed to another owner (see IPCScope::resetForReuse()).
+ */
+void IPCScopeLinkGroup::onScopeReused()
+{
+    removeScope(qobject_cast<IPCScope *>(sender()));
+}
+
+/*!
+ * \brief IPCScopeLinkGroup::onScopeDestroyed. Forget a deleted scope.
+ * \param object
+ */
+void IPCScopeLinkGroup::onScopeDestroyed(QObject *object)
+{
+    // Only the address is compared, the scope is already destroyed
+    mScopes.removeOne(static_cast<IPCScope *>(object));
+}
+
+/*!
+ * \brief IPCScopeLinkGroup::onScopeRangeChanged. A scope of the group zoomed or panned.
+ */
+void IPCScopeLinkGroup::onScopeRangeChanged()
+{
+    schedule(qobject_cast<IPCScope *>(sender()), Link(mLinks & (lkXRange | lkYRange)));
+}
+
+/*!
+ * \brief IPCScopeLinkGroup::onScopeMarkerKeyChanged. A marker of a scope of the group moved.
+ */
+void IPCScopeLinkGroup::onScopeMarkerKeyChanged()
+{
+    schedule(qobject_cast<IPCScope *>(sender()), Link(mLinks & lkMarkers));
+}
+
+/*!
+ * \brief IPCScopeLinkGroup::schedule. Record a change, and queue the apply unless one is already queued. Changes made
+ * by the group itself are ignored.
+ * \param source
+ * \param link
+ */
+void IPCScopeLinkGroup::schedule(IPCScope *source, Link link)
+{
+    if(mApplying || !source || !link){
+        return;
+    }
+    mSource = source;
+    mPendingLinks |= link;
+    if(!mApplyQueued){
+        mApplyQueued = true;
+        QMetaObject::invokeMethod(this, "applyPending", Qt::QueuedConnection);
+    }
+}
+
+/*!
+ * \brief IPCScopeLinkGroup::applyPending. Apply the changes recorded since the last apply.
+ */
+void IPCScopeLinkGroup::applyPending()
+{
+    mApplyQueued = false;
+    int links = mPendingLinks & mLinks;
+    mPendingLinks = 0;
+    if(mSource && links){
+        apply(mSource, links, mScopes);
+    }
+}
+
+/*!
+ * \brief IPCScopeLinkGroup::sync. Apply the linked state of a scope to the rest of the group now.
+ * \param source
+ */
+void IPCScopeLinkGroup::sync(IPCScope *source)
+{
+    if(!mScopes.contains(source)){
+        qDebug() << Q_FUNC_INFO << "scope not in the group";
+        return;
+    }
+    apply(source, mLinks, mScopes);
+}
+
+/*!
+ * \brief IPCScopeLinkGroup::apply. Apply the linked state of a scope to other scopes.
+ * \param source
+ * \param links
+ * \param targets
+ */
+void IPCScopeLinkGroup::apply(IPCScope *source, int links, const QList<IPCScope *> &targets)
+{
+    QRectF range = source->visibleRange();
+    QList<double> keys;
+    if(links & lkMarkers){
+        foreach(IPCMarker *marker, source->markers()){
+            keys.append(marker->graphKey());
+        }
+    }
+    mApplying = true;
+    foreach(IPCScope *scope, targets){
+        if(scope != source){
+            scope->applyLinkedView(range, links & lkXRange, links & lkYRange, keys);
+        }
+    }
+    mApplying = false;
+}
@@ -0,0 +1,63 @@
+#ifndef IPCSCOPELINKGROUP_H
+#define IPCSCOPELINKGROUP_H
+
+#include <QObject>
+#include <QPointer>
+#include <QList>
+#include "ipcscope.h"
+
+/*
+ * A link group keeps the x range, optionally the y range, and the marker keys of several scopes aligned. Changes of
+ * any scope of the group are coalesced: once per event loop pass, the state of the last changed scope is applied to
+ * all the others in a single pass (see IPCScope::applyLinkedView()), each scope re-culling and moving its markers once.
+ * Scopes sharing an IPCRefreshScheduler are then repainted in the same display frame.
+ */
+class IPCScopeLinkGroup : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IPCScopeLinkGroup(QObject *parent = nullptr);
+
+    enum Link { lkXRange=1      /// Share the x range
+               ,lkYRange=2      /// Share the y range
+               ,lkMarkers=4     /// Share the marker keys, by marker index
+              };
+    Q_ENUMS(Link)
+
+    // New scopes are aligned on the first scope of the group
+    void addScope(IPCScope *scope);
+    void removeScope(IPCScope *scope);
+
+    // Setters
+    void setLinks(int links){mLinks = links;}
+
+    // Getters
+    int links() const {return mLinks;}
+    QList<IPCScope *> scopes() const {return mScopes;}
+    int count() const {return mScopes.count();}
+
+public slots:
+    // Apply the state of a scope to the rest of the group now
+    void sync(IPCScope *source);
+
+private slots:
+    void onScopeRangeChanged();
+    void onScopeMarkerKeyChanged();
+    void onScopeDestroyed(QObject *object);
+    void onScopeReused();
+    void applyPending();
+
+private:
+    void schedule(IPCScope *source, Link link);
+    void apply(IPCScope *source, int links, const QList<IPCScope *> &targets);
+
+    QList<IPCScope *> mScopes;
+    int mLinks;
+    // Last changed scope and kinds of changes since the last apply, whether an apply is queued, and whether one runs
+    QPointer<IPCScope> mSource;
+    int mPendingLinks;
+    bool mApplyQueued;
+    bool mApplying;
+};
+
+#endif // IPCSCOPELINKGROUP_H
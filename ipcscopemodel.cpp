@@ -0,0 +1,301 @@
+#include "ipcscopemodel.h"
+#include "ipcviewportculler.h"
+#include <QMetaObject>
+#include <QDebug>
+#include <algorithm>
+
+/*!
+ * \brief IPCScopeModel::IPCScopeModel. Constructor. The changed() signal is emitted in the thread of the model.
+ * \param parent
+ */
+IPCScopeModel::IPCScopeModel(QObject *parent) :
+    QObject(parent),
+    mNextGraphId(0),
+    mRevision(0),
+    mPendingChanges(0),
+    mDeliveryQueued(0)
+{
+
+}
+
+/*!
+ * \brief IPCScopeModel::notify. Record a change, and queue its delivery unless one is already queued.
+ * \param change
+ */
+void IPCScopeModel::notify(Change change)
+{
+    mPendingChanges.fetchAndOrOrdered(change);
+    if(mDeliveryQueued.testAndSetOrdered(0, 1)){
+        QMetaObject::invokeMethod(this, "deliverChanges", Qt::QueuedConnection);
+    }
+}
+
+/*!
+ * \brief IPCScopeModel::deliverChanges. Emit the changes recorded since the last delivery.
+ */
+void IPCScopeModel::deliverChanges()
+{
+    mDeliveryQueued.storeRelease(0);
+    int changes = mPendingChanges.fetchAndStoreOrdered(0);
+    if(changes){
+        emit changed(changes);
+    }
+}
+
+/*!
+ * \brief IPCScopeModel::addGraph. Add an empty graph. Return its index.
+ * \param name
+ */
+int IPCScopeModel::addGraph(const QString &name)
+{
+    Graph graph;
+    graph.name = name;
+    int graphIdx;
+    {
+        QWriteLocker locker(&mLock);
+        graph.id = mNextGraphId++;
+        graph.revision = ++mRevision;
+        mGraphs.append(graph);
+        graphIdx = mGraphs.size() - 1;
+    }
+    notify(mcGraphs);
+    return graphIdx;
+}
+
+/*!
+ * \brief IPCScopeModel::removeGraph. Remove a graph.
+ * \param graphIdx
+ */
+void IPCScopeModel::removeGraph(int graphIdx)
+{
+    {
+        QWriteLocker locker(&mLock);
+        if((graphIdx < 0) || (graphIdx > mGraphs.size()-1)){
+            qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+            return;
+        }
+        mGraphs.removeAt(graphIdx);
+    }
+    notify(mcGraphs);
+}
+
+/*!
+ * \brief IPCScopeModel::setGraphName. Rename a graph.
+ * \param graphIdx
+ * \param name
+ */
+void IPCScopeModel::setGraphName(int graphIdx, const QString &name)
+{
+    {
+        QWriteLocker locker(&mLock);
+        if((graphIdx < 0) || (graphIdx > mGraphs.size()-1)){
+            qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+            return;
+        }
+        mGraphs[graphIdx].name = name;
+    }
+    notify(mcGraphs);
+}
+
+/*!
+ * \brief IPCScopeModel::setGraphData. Replace the data of a graph. The points are shared, not copied.
+ * \param graphIdx
+ * \param points
+ */
+void IPCScopeModel::setGraphData(int graphIdx, const QVector<QPointF> &points)
+{
+    // The previous data is released outside the lock
+    QVector<QPointF> previous = points;
+    {
+        QWriteLocker locker(&mLock);
+        if((graphIdx < 0) || (graphIdx > mGraphs.size()-1)){
+            qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+            return;
+        }
+        Graph &graph = mGraphs[graphIdx];
+        graph.points.swap(previous);
+        graph.revision = ++mRevision;
+    }
+    notify(mcData);
+}
+
+/*!
+ * \brief IPCScopeModel::addMarker. Add a marker at a key (x value). Return its index.
+ * \param key
+ */
+int IPCScopeModel::addMarker(double key)
+{
+    int markerIdx;
+    {
+        QWriteLocker locker(&mLock);
+        mMarkerKeys.append(key);
+        markerIdx = mMarkerKeys.size() - 1;
+    }
+    notify(mcMarkers);
+    return markerIdx;
+}
+
+/*!
+ * \brief IPCScopeModel::removeMarker. Remove a marker.
+ * \param markerIdx
+ */
+void IPCScopeModel::removeMarker(int markerIdx)
+{
+    {
+        QWriteLocker locker(&mLock);
+        if((markerIdx < 0) || (markerIdx > mMarkerKeys.size()-1)){
+            qDebug() << Q_FUNC_INFO << "index out of range:" << markerIdx;
+            return;
+        }
+        mMarkerKeys.removeAt(markerIdx);
+    }
+    notify(mcMarkers);
+}
+
+/*!
+ * \brief IPCScopeModel::setMarkerKey. Move a marker to a key (x value).
+ * \param markerIdx
+ * \param key
+ */
+void IPCScopeModel::setMarkerKey(int markerIdx, double key)
+{
+    {
+        QWriteLocker locker(&mLock);
+        if((markerIdx < 0) || (markerIdx > mMarkerKeys.size()-1)){
+            qDebug() << Q_FUNC_INFO << "index out of range:" << markerIdx;
+            return;
+        }
+        mMarkerKeys[markerIdx] = key;
+    }
+    notify(mcMarkers);
+}
+
+/*!
+ * \brief IPCScopeModel::setZoomRange. Set the range shown by the views, in graph's coordinates. The top of the rectangle
+ * is the minimum y value. A null rectangle lets each view keep its own range.
+ * \param range
+ */
+void IPCScopeModel::setZoomRange(const QRectF &range)
+{
+    {
+        QWriteLocker locker(&mLock);
+        mZoomRange = range.normalized();
+    }
+    notify(mcZoom);
+}
+
+/*!
+ * \brief IPCScopeModel::graphCount. Return the number of graphs.
+ */
+int IPCScopeModel::graphCount() const
+{
+    QReadLocker locker(&mLock);
+    return mGraphs.size();
+}
+
+/*!
+ * \brief IPCScopeModel::graphs. Return a snapshot of all the graphs. The points are shared, not copied.
+ */
+QList<IPCScopeModel::Graph> IPCScopeModel::graphs() const
+{
+    QReadLocker locker(&mLock);
+    return mGraphs;
+}
+
+/*!
+ * \brief IPCScopeModel::graph. Return a snapshot of a graph, with an id of -1 if the index is out of range.
+ * \param graphIdx
+ */
+IPCScopeModel::Graph IPCScopeModel::graph(int graphIdx) const
+{
+    QReadLocker locker(&mLock);
+    if((graphIdx < 0) || (graphIdx > mGraphs.size()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << graphIdx;
+        Graph graph;
+        graph.id = -1;
+        graph.revision = 0;
+        return graph;
+    }
+    return mGraphs.at(graphIdx);
+}
+
+/*!
+ * \brief IPCScopeModel::graphData. Return the data of a graph. The points are shared, not copied.
+ * \param graphIdx
+ */
+QVector<QPointF> IPCScopeModel::graphData(int graphIdx) const
+{
+    return graph(graphIdx).points;
+}
+
+/*!
+ * \brief IPCScopeModel::markerKeys. Return the keys of the markers.
+ */
+QList<double> IPCScopeModel::markerKeys() const
+{
+    QReadLocker locker(&mLock);
+    return mMarkerKeys;
+}
+
+/*!
+ * \brief IPCScopeModel::zoomRange. Return the range shown by the views, or a null rectangle.
+ */
+QRectF IPCScopeModel::zoomRange() const
+{
+    QReadLocker locker(&mLock);
+    return mZoomRange;
+}
+
+/*!
+ * \brief IPCScopeModel::markerPoint. Return the point of a graph at the key of a marker, linearly interpolated between the
+ * two surrounding points. Keys beyond the data snap to the first or last point. The graph must be sorted by x.
+ * \param markerIdx
+ * \param graphIdx
+ */
+QPointF IPCScopeModel::markerPoint(int markerIdx, int graphIdx) const
+{
+    double key;
+    QVector<QPointF> points;
+    {
+        QReadLocker locker(&mLock);
+        if((markerIdx < 0) || (markerIdx > mMarkerKeys.size()-1) || (graphIdx < 0) || (graphIdx > mGraphs.size()-1)){
+            qDebug() << Q_FUNC_INFO << "index out of range:" << markerIdx << graphIdx;
+            return QPointF();
+        }
+        key = mMarkerKeys.at(markerIdx);
+        points = mGraphs.at(graphIdx).points;
+    }
+    if(points.isEmpty()){
+        return QPointF();
+    }
+    if(key <= points.first().x()){
+        return points.first();
+    }
+    if(key >= points.last().x()){
+        return points.last();
+    }
+    QVector<QPointF>::const_iterator it = std::lower_bound(points.constBegin(), points.constEnd(), key,
+                                                           [](const QPointF &p, double x) {return p.x() < x;});
+    const QPointF &p2 = *it;
+    const QPointF &p1 = *(it - 1);
+    if(p2.x() == p1.x()){
+        return p2;
+    }
+    double y = p1.y() + (p2.y() - p1.y()) * (key - p1.x()) / (p2.x() - p1.x());
+    return QPointF(key, y);
+}
+
+/*!
+ * \brief IPCScopeModel::decimatedGraphData. Return the points of a graph inside a range, decimated to a min/max per
+ * column, ready to be rendered.
+ * \param graphIdx
+ * \param range Range in graph's coordinates
+ * \param columns Number of pixel columns, 0 for no decimation
+ * \param xLog true if the x axis is logarithmic
+ */
+QVector<QPointF> IPCScopeModel::decimatedGraphData(int graphIdx, const QRectF &range, int columns, bool xLog) const
+{
+    IPCViewportCuller culler;
+    culler.setSource(graphData(graphIdx));
+    return culler.cull(range.normalized(), true, columns, xLog);
+}
@@ -0,0 +1,87 @@
+#ifndef IPCSCOPEMODEL_H
+#define IPCSCOPEMODEL_H
+
+#include <QObject>
+#include <QVector>
+#include <QList>
+#include <QPointF>
+#include <QRectF>
+#include <QString>
+#include <QReadWriteLock>
+#include <QAtomicInt>
+
+/*
+ * Data and measurement model of a scope: graphs, marker keys and zoom range, without any widget. Scopes render a model
+ * (see IPCScope::setModel()), several scopes can render the same model, and a model can be used headless.
+ *
+ * Concurrency rules:
+ *  - every method is thread safe. Writers take a write lock only to swap implicitly shared values in, readers take a read
+ *    lock only to copy them out, so the data is never copied under the lock;
+ *  - measurements and decimation run on such copies, in the calling thread, without holding the lock;
+ *  - changes are coalesced: changed() is emitted once per event loop pass of the thread the model lives in, with the
+ *    kinds of changes since the previous emission. Receivers compare the graph revisions to find the graphs to update.
+ */
+class IPCScopeModel : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IPCScopeModel(QObject *parent = nullptr);
+
+    enum Change { mcGraphs=1     /// Graph added, removed or renamed
+                 ,mcData=2       /// Graph data changed
+                 ,mcMarkers=4    /// Marker added, removed or moved
+                 ,mcZoom=8       /// Zoom range changed
+                };
+    Q_ENUMS(Change)
+
+    // Snapshot of a graph. The identifier of a graph doesn't change when graphs before it are removed.
+    struct Graph {
+        int id;
+        QString name;
+        QVector<QPointF> points;
+        quint64 revision;
+    };
+
+    // Writers
+    int addGraph(const QString &name = "No name");
+    void removeGraph(int graphIdx);
+    void setGraphName(int graphIdx, const QString &name);
+    void setGraphData(int graphIdx, const QVector<QPointF> &points);
+    int addMarker(double key);
+    void removeMarker(int markerIdx);
+    void setMarkerKey(int markerIdx, double key);
+    void setZoomRange(const QRectF &range);
+
+    // Readers
+    int graphCount() const;
+    QList<Graph> graphs() const;
+    Graph graph(int graphIdx) const;
+    QVector<QPointF> graphData(int graphIdx) const;
+    QList<double> markerKeys() const;
+    QRectF zoomRange() const;
+
+    // Measurements, run in the calling thread
+    QPointF markerPoint(int markerIdx, int graphIdx) const;
+    QVector<QPointF> decimatedGraphData(int graphIdx, const QRectF &range, int columns, bool xLog = false) const;
+
+signals:
+    void changed(int changes);
+
+private slots:
+    void deliverChanges();
+
+private:
+    void notify(Change change);
+
+    mutable QReadWriteLock mLock;
+    QList<Graph> mGraphs;
+    int mNextGraphId;
+    quint64 mRevision;
+    QList<double> mMarkerKeys;
+    QRectF mZoomRange;
+    // Changes not delivered yet, and whether a delivery is queued
+    QAtomicInt mPendingChanges;
+    QAtomicInt mDeliveryQueued;
+};
+
+#endif // IPCSCOPEMODEL_H
@@ -0,0 +1,140 @@
+#include "ipcscopepool.h"
+#include <QCoreApplication>
+
+IPCScopePool::IPCScopePool(QObject *parent) :
+    QObject(parent),
+    mMaxIdleCount(16),
+    mHitCount(0),
+    mReuseCount(0),
+    mMissCount(0),
+    mConstructionTime(0)
+{
+}
+
+IPCScopePool::~IPCScopePool()
+{
+    clear();
+}
+
+/*!
+ * \brief IPCScopePool::instance. Return the pool shared by the application. It is created on first call and deleted
+ * with the application object.
+ * \return
+ */
+IPCScopePool *IPCScopePool::instance()
+{
+    static QPointer<IPCScopePool> pool;
+    if(!pool){
+        pool = new IPCScopePool(QCoreApplication::instance());
+    }
+    return pool;
+}
+
+/*!
+ * \brief IPCScopePool::acquire. Return a scope for key. The scope released with the same key is returned unchanged if it
+ * is still idle. Otherwise the oldest idle scope of the same type is reset (see IPCScope::resetForReuse()) and returned,
+ * or a new scope is built.
+ * \param key
+ * \param parent. New parent of the scope.
+ * \param scopeType
+ * \return
+ */
+IPCScope *IPCScopePool::acquire(const QString &key, QWidget *parent, ScopeType scopeType)
+{
+    // Drop the scopes deleted while idle
+    for(int i = mIdleList.count()-1; i >= 0; i--){
+        if(!mIdleList.at(i).scope){
+            mIdleList.removeAt(i);
+        }
+    }
+    for(int i = mIdleList.count()-1; i >= 0; i--){
+        if((mIdleList.at(i).key == key) && (mIdleList.at(i).scopeType == scopeType)){
+            mHitCount++;
+            return take(i, parent);
+        }
+    }
+    for(int i = 0; i < mIdleList.count(); i++){
+        if(mIdleList.at(i).scopeType == scopeType){
+            mReuseCount++;
+            IPCScope *scope = take(i, parent);
+            scope->resetForReuse();
+            return scope;
+        }
+    }
+    mMissCount++;
+    IPCScope *scope = new IPCScope(parent, scopeType);
+    mConstructionTime += scope->constructionTime();
+    return scope;
+}
+
+/*!
+ * \brief IPCScopePool::release. Hand a scope back to the pool. The scope is hidden and detached from its parent, so it
+ * survives the deletion of its tab. The oldest idle scopes are deleted beyond the maximum idle count.
+ * \param key
+ * \param scope
+ */
+void IPCScopePool::release(const QString &key, IPCScope *scope)
+{
+    if(!scope){
+        qDebug() << Q_FUNC_INFO << "null scope";
+        return;
+    }
+    for(int i = 0; i < mIdleList.count(); i++){
+        if(mIdleList.at(i).scope == scope){
+            qDebug() << Q_FUNC_INFO << "scope already released:" << key;
+            return;
+        }
+    }
+    scope->hide();
+    scope->setParent(nullptr);
+    IdleScope idle;
+    idle.key = key;
+    idle.scopeType = scope->scopeType();
+    idle.scope = scope;
+    mIdleList.append(idle);
+    trim();
+}
+
+/*!
+ * \brief IPCScopePool::clear. Delete all the idle scopes.
+ */
+void IPCScopePool::clear()
+{
+    foreach(const IdleScope &idle, mIdleList){
+        delete idle.scope.data();
+    }
+    mIdleList.clear();
+}
+
+/*!
+ * \brief IPCScopePool::setMaxIdleCount. Set the maximum number of idle scopes kept. Default is 16.
+ * \param count
+ */
+void IPCScopePool::setMaxIdleCount(int count)
+{
+    mMaxIdleCount = qMax(0, count);
+    trim();
+}
+
+/*!
+ * \brief IPCScopePool::take. Remove an idle scope from the pool and give it a parent.
+ * \param idx
+ * \param parent
+ * \return
+ */
+IPCScope *IPCScopePool::take(int idx, QWidget *parent)
+{
+    IPCScope *scope = mIdleList.takeAt(idx).scope;
+    scope->setParent(parent);
+    return scope;
+}
+
+/*!
+ * \brief IPCScopePool::trim. Delete the oldest idle scopes beyond the maximum idle count.
+ */
+void IPCScopePool::trim()
+{
+    while(mIdleList.count() > mMaxIdleCount){
+        delete mIdleList.takeFirst().scope.data();
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef IPCSCOPEPOOL_H
+#define IPCSCOPEPOOL_H
+
+#include <QObject>
+#include <QPointer>
+#include <QList>
+#include "ipcscope.h"
+
+/*
+ * A scope pool recycles scopes instead of destroying them, typically when a tab is closed. A scope released with a key
+ * is handed back as is (graphs, markers, zoom and style) when the same key is acquired again. Otherwise an idle scope of
+ * the same type is cleared and reused, and a new scope is only built when none is available.
+ */
+class IPCScopePool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IPCScopePool(QObject *parent = nullptr);
+    virtual ~IPCScopePool();
+
+    // Shared pool of the application
+    static IPCScopePool *instance();
+
+    IPCScope *acquire(const QString &key, QWidget *parent = nullptr, ScopeType scopeType = stpLinear);
+    void release(const QString &key, IPCScope *scope);
+    void clear();
+
+    // Setters
+    void setMaxIdleCount(int count);
+
+    // Getters
+    int maxIdleCount() const {return mMaxIdleCount;}
+    int idleCount() const {return mIdleList.count();}
+    // Acquisitions served with the same configured scope, with a cleared scope, and with a new scope
+    int hitCount() const {return mHitCount;}
+    int reuseCount() const {return mReuseCount;}
+    int missCount() const {return mMissCount;}
+    // Total time spent constructing scopes, in ns
+    qint64 constructionTime() const {return mConstructionTime;}
+
+private:
+    struct IdleScope {
+        QString key;
+        ScopeType scopeType;
+        QPointer<IPCScope> scope;
+    };
+    IPCScope *take(int idx, QWidget *parent);
+    void trim();
+
+    // Idle scopes, the most recently released last
+    QList<IdleScope> mIdleList;
+    int mMaxIdleCount;
+    int mHitCount;
+    int mReuseCount;
+    int mMissCount;
+    qint64 mConstructionTime;
+};
+
+#endif // IPCSCOPEPOOL_H
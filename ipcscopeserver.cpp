@@ -0,0 +1,408 @@
+#include "ipcscopeserver.h"
+#include "ipcscope.h"
+
+// Maximum number of errors kept in the error queue
+static const int MaxErrorCount = 32;
+// Maximum length of a binary block: a trace of 16M points
+static const qint64 MaxBlockLength = Q_INT64_C(16*1024*1024) * 2*sizeof(double);
+
+/*!
+ * \brief matchKeyword. Return true if a header keyword (upper case) matches the short or the long form of a SCPI keyword.
+ * The short form is the upper case part of the keyword: "GRAPh" matches "GRAP" and "GRAPH".
+ * \param keyword
+ * \param form
+ * \return
+ */
+static bool matchKeyword(const QByteArray &keyword, const char *form)
+{
+    QByteArray longForm(form);
+    QByteArray shortForm;
+    foreach(char c, longForm){
+        if(!((c >= 'a') && (c <= 'z'))){
+            shortForm.append(c);
+        }
+    }
+    return (keyword == shortForm) || (keyword == longForm.toUpper());
+}
+
+IPCScopeServer::IPCScopeServer(IPCScope *scope, QObject *parent) :
+    QObject(parent),
+    mScope(scope)
+{
+    mServer = new QLocalServer(this);
+    connect(mServer, &QLocalServer::newConnection, this, &IPCScopeServer::onNewConnection);
+}
+
+IPCScopeServer::~IPCScopeServer()
+{
+    close();
+}
+
+/*!
+ * \brief IPCScopeServer::listen. Start listening on a local socket name (or path). Return false on failure.
+ * \param name
+ * \return
+ */
+bool IPCScopeServer::listen(const QString &name)
+{
+    close();
+    // Remove a stale socket left by a crashed process
+    QLocalServer::removeServer(name);
+    if(!mServer->listen(name)){
+        qDebug() << Q_FUNC_INFO << "couldn't listen on" << name << ":" << mServer->errorString();
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief IPCScopeServer::close. Stop listening and disconnect the clients.
+ */
+void IPCScopeServer::close()
+{
+    mServer->close();
+    QList<QLocalSocket *> sockets = mBuffers.keys();
+    mBuffers.clear();
+    foreach(QLocalSocket *socket, sockets){
+        socket->disconnect(this);
+        socket->abort();
+        socket->deleteLater();
+    }
+}
+
+/*!
+ * \brief IPCScopeServer::onNewConnection. Accept the pending clients.
+ */
+void IPCScopeServer::onNewConnection()
+{
+    while(mServer->hasPendingConnections()){
+        QLocalSocket *socket = mServer->nextPendingConnection();
+        mBuffers.insert(socket, QByteArray());
+        connect(socket, &QLocalSocket::readyRead, this, &IPCScopeServer::onReadyRead);
+        connect(socket, &QLocalSocket::disconnected, this, &IPCScopeServer::onDisconnected);
+    }
+}
+
+/*!
+ * \brief IPCScopeServer::onDisconnected. Forget a client.
+ */
+void IPCScopeServer::onDisconnected()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    if(socket){
+        mBuffers.remove(socket);
+        socket->deleteLater();
+    }
+}
+
+/*!
+ * \brief IPCScopeServer::onReadyRead. Execute all the complete commands received, with the scope updates disabled so that
+ * the batch is repainted once.
+ */
+void IPCScopeServer::onReadyRead()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    if(!socket || !mBuffers.contains(socket)){
+        return;
+    }
+    // The buffer is taken out of the hash, a reply may disconnect the client while the commands execute
+    QByteArray buffer;
+    buffer.swap(mBuffers[socket]);
+    buffer.append(socket->readAll());
+    if(!mScope){
+        return;
+    }
+    bool updatesEnabled = mScope->updatesEnabled();
+    mScope->setUpdatesEnabled(false);
+    processBuffer(socket, buffer);
+    mScope->setUpdatesEnabled(updatesEnabled);
+    if(mBuffers.contains(socket)){
+        mBuffers[socket].swap(buffer);
+    }
+}
+
+/*!
+ * \brief IPCScopeServer::processBuffer. Split the received bytes into commands and execute them. An incomplete command
+ * (no terminator yet, or a binary block not fully received) stays in the buffer. A block declared longer than
+ * MaxBlockLength is not waited for: the client is disconnected.
+ * \param socket
+ * \param buffer
+ */
+void IPCScopeServer::processBuffer(QLocalSocket *socket, QByteArray &buffer)
+{
+    const int size = buffer.size();
+    const char *data = buffer.constData();
+    auto isTerminator = [](char c){ return (c == '\n') || (c == '\r') || (c == ';'); };
+    int pos = 0;
+    forever{
+        // Skip the separators
+        while((pos < size) && (isTerminator(data[pos]) || (data[pos] == ' '))){
+            pos++;
+        }
+        if(pos >= size){
+            break;
+        }
+        // The header ends at a space or a terminator
+        int headerEnd = pos;
+        while((headerEnd < size) && (data[headerEnd] != ' ') && !isTerminator(data[headerEnd])){
+            headerEnd++;
+        }
+        if(headerEnd >= size){
+            break;
+        }
+        QByteArray header = buffer.mid(pos, headerEnd - pos);
+        QByteArray argument;
+        QByteArray block;
+        int next = headerEnd;
+        if(data[headerEnd] == ' '){
+            int argStart = headerEnd;
+            while((argStart < size) && (data[argStart] == ' ')){
+                argStart++;
+            }
+            if(argStart >= size){
+                break;
+            }
+            if(data[argStart] == '#'){
+                // IEEE 488.2 definite length block: #<number of digits><length><data>
+                if(argStart + 2 > size){
+                    break;
+                }
+                int digits = data[argStart+1] - '0';
+                if((digits < 1) || (digits > 9)){
+                    pushError(-161, "Invalid block data");
+                    int nl = buffer.indexOf('\n', argStart);
+                    if(nl < 0){
+                        break;
+                    }
+                    pos = nl + 1;
+                    continue;
+                }
+                if(argStart + 2 + digits > size){
+                    break;
+                }
+                // The length digits must all be decimal digits
+                QByteArray lengthText = buffer.mid(argStart + 2, digits);
+                bool ok = true;
+                foreach(char c, lengthText){
+                    ok = ok && (c >= '0') && (c <= '9');
+                }
+                qint64 length = ok ? lengthText.toLongLong(&ok) : -1;
+                if(!ok || (length < 0)){
+                    pushError(-161, "Invalid block data");
+                    int nl = buffer.indexOf('\n', argStart);
+                    if(nl < 0){
+                        break;
+                    }
+                    pos = nl + 1;
+                    continue;
+                }
+                if(length > MaxBlockLength){
+                    // Not buffered until it arrives: the client is dropped
+                    pushError(-223, "Too much data");
+                    buffer.clear();
+                    mBuffers.remove(socket);
+                    socket->disconnect(this);
+                    socket->abort();
+                    socket->deleteLater();
+                    return;
+                }
+                qint64 blockStart = argStart + 2 + digits;
+                if(blockStart + length > size){
+                    // Wait for the rest of the block
+                    break;
+                }
+                // Refer to the received bytes, the block is decoded straight into the graph storage
+                block = QByteArray::fromRawData(data + blockStart, length);
+                next = blockStart + length;
+            } else{
+                // Text argument, up to a terminator outside of quotes
+                bool quoted = false;
+                int end = argStart;
+                while((end < size) && (quoted || !isTerminator(data[end]))){
+                    if(data[end] == '"'){
+                        quoted = !quoted;
+                    }
+                    end++;
+                }
+                if(end >= size){
+                    break;
+                }
+                argument = buffer.mid(argStart, end - argStart).trimmed();
+                next = end;
+            }
+        }
+        execute(socket, header, argument, block);
+        pos = next;
+    }
+    buffer.remove(0, pos);
+}
+
+/*!
+ * \brief IPCScopeServer::execute. Execute one command.
+ * \param socket
+ * \param header
+ * \param argument. Text argument, empty if there is none.
+ * \param block. Binary block argument, null if there is none.
+ */
+void IPCScopeServer::execute(QLocalSocket *socket, const QByteArray &header, const QByteArray &argument, const QByteArray &block)
+{
+    bool query = header.endsWith('?');
+    QByteArray h = query ? header.left(header.size()-1) : header;
+    if(h.startsWith(':')){
+        h = h.mid(1);
+    }
+    // Split the header into keywords and numeric suffixes
+    QList<QByteArray> keywords;
+    QList<int> suffixes;
+    foreach(const QByteArray &node, h.split(':')){
+        int i = node.size();
+        while((i > 0) && (node.at(i-1) >= '0') && (node.at(i-1) <= '9')){
+            i--;
+        }
+        keywords.append(node.left(i).toUpper());
+        suffixes.append((i < node.size()) ? node.mid(i).toInt() : 1);
+    }
+    const int n = keywords.size();
+    auto is = [&](int i, const char *form){ return (i < n) && matchKeyword(keywords.at(i), form); };
+    QString text = QString::fromUtf8(argument);
+    if(text.startsWith('"') && text.endsWith('"') && (text.length() >= 2)){
+        text = text.mid(1, text.length()-2);
+    }
+
+    if((n == 1) && (keywords.at(0) == "*IDN") && query){
+        reply(socket, QString("IPCTEK,IPCScope,%1,1.0").arg(mScope->name()).toUtf8());
+    } else if((n == 1) && (keywords.at(0) == "*OPC") && query){
+        reply(socket, "1");
+    } else if((n == 1) && (keywords.at(0) == "*CLS")){
+        mErrors.clear();
+    } else if((n == 2) && is(0, "SYSTem") && is(1, "ERRor") && query){
+        reply(socket, mErrors.isEmpty() ? QByteArray("0,\"No error\"") : mErrors.takeFirst().toUtf8());
+    } else if((n == 2) && is(0, "GRAPh") && is(1, "DATA")){
+        int graphIdx = suffixes.at(0) - 1;
+        if((graphIdx < 0) || (graphIdx > mScope->graphCount()-1)){
+            pushError(-222, "Data out of range");
+        } else if(query){
+            replyBlock(socket, mScope->graphPoints(graphIdx));
+        } else if(block.isNull() || (block.size() % (2*sizeof(double)) != 0)){
+            pushError(-161, "Invalid block data");
+        } else{
+            mScope->setGraphData(graphIdx, IPCTraceBuffer::fromBytes(block));
+        }
+    } else if((n == 2) && is(0, "GRAPh") && is(1, "MODE")){
+        int graphIdx = suffixes.at(0) - 1;
+        if((graphIdx < 0) || (graphIdx > mScope->graphCount()-1)){
+            pushError(-222, "Data out of range");
+        } else if(query){
+            static const char *modeNames[] = {"", "CLE", "MAXH", "MINH", "AVER"};
+            reply(socket, modeNames[mScope->graphTraceMode(graphIdx)]);
+        } else{
+            QByteArray mode = argument.toUpper();
+            if(matchKeyword(mode, "CLEar")){
+                mScope->setGraphTraceMode(graphIdx, IPCScope::ClearWrite);
+            } else if(matchKeyword(mode, "MAXHold")){
+                mScope->setGraphTraceMode(graphIdx, IPCScope::MaxHold);
+            } else if(matchKeyword(mode, "MINHold")){
+                mScope->setGraphTraceMode(graphIdx, IPCScope::MinHold);
+            } else if(matchKeyword(mode, "AVERage")){
+                mScope->setGraphTraceMode(graphIdx, IPCScope::Average);
+            } else{
+                pushError(-224, "Illegal parameter value");
+            }
+        }
+    } else if((n == 2) && is(0, "GRAPh") && is(1, "ACTive")){
+        if(query){
+            reply(socket, QByteArray::number(mScope->activeGraphIdx() + 1));
+        } else{
+            int graphIdx = argument.toInt() - 1;
+            if((graphIdx < 0) || (graphIdx > mScope->graphCount()-1)){
+                pushError(-222, "Data out of range");
+            } else{
+                mScope->setActiveGraphIdx(graphIdx);
+            }
+        }
+    } else if((n == 2) && is(0, "MARKer") && is(1, "ADD") && !query){
+        mScope->addMarker();
+    } else if((n == 2) && is(0, "MARKer") && (is(1, "X") || is(1, "Y"))){
+        int markerIdx = suffixes.at(0) - 1;
+        bool ok = false;
+        double value = argument.toDouble(&ok);
+        if((markerIdx < 0) || (markerIdx > mScope->markerCount()-1)){
+            pushError(-222, "Data out of range");
+        } else if(query){
+            QPointF pos = mScope->marker(markerIdx)->pos();
+            reply(socket, QByteArray::number(is(1, "X") ? pos.x() : pos.y(), 'g', 15));
+        } else if(is(1, "X") && ok){
+            mScope->setMarkerKeyValue(markerIdx, value);
+        } else{
+            pushError(-224, "Illegal parameter value");
+        }
+    } else if((n == 1) && is(0, "ZOOM")){
+        if(query){
+            QRectF range = mScope->visibleRange();
+            reply(socket, QString("%1,%2,%3,%4").arg(range.left(), 0, 'g', 15).arg(range.bottom(), 0, 'g', 15)
+                  .arg(range.right(), 0, 'g', 15).arg(range.top(), 0, 'g', 15).toUtf8());
+        } else{
+            QList<QByteArray> values = argument.split(',');
+            double v[4];
+            bool ok = (values.size() == 4);
+            for(int i = 0; ok && (i < 4); i++){
+                v[i] = values.at(i).trimmed().toDouble(&ok);
+            }
+            if(ok){
+                mScope->setZoomRange(v[0], v[1], v[2], v[3]);
+            } else{
+                pushError(-224, "Illegal parameter value");
+            }
+        }
+    } else if((n == 2) && is(0, "ZOOM") && is(1, "FIT") && !query){
+        mScope->setZoomFit();
+    } else if((n == 2) && is(0, "EXPort") && is(1, "PNG") && !query){
+        if(!mScope->savePng(text)){
+            pushError(-250, "Mass storage error");
+        }
+    } else if((n == 2) && is(0, "EXPort") && is(1, "PDF") && !query){
+        mScope->savePdf(text, 0, 0, "IPCScope", mScope->name());
+    } else{
+        pushError(-113, "Undefined header");
+    }
+}
+
+/*!
+ * \brief IPCScopeServer::reply. Send a text response, terminated by a new line.
+ * \param socket
+ * \param text
+ */
+void IPCScopeServer::reply(QLocalSocket *socket, const QByteArray &text)
+{
+    socket->write(text);
+    socket->write("\n");
+}
+
+/*!
+ * \brief IPCScopeServer::replyBlock. Send points as a definite length binary block.
+ * \param socket
+ * \param points
+ */
+void IPCScopeServer::replyBlock(QLocalSocket *socket, const QVector<QPointF> &points)
+{
+    QByteArray data = IPCTraceBuffer::toBytes(points);
+    QByteArray length = QByteArray::number(data.size());
+    socket->write("#" + QByteArray::number(length.size()) + length);
+    socket->write(data);
+    socket->write("\n");
+}
+
+/*!
+ * \brief IPCScopeServer::pushError. Append an error to the SCPI error queue.
+ * \param code
+ * \param message
+ */
+void IPCScopeServer::pushError(int code, const QString &message)
+{
+    if(mErrors.size() >= MaxErrorCount){
+        mErrors.removeLast();
+        mErrors.append("-350,\"Queue overflow\"");
+        return;
+    }
+    mErrors.append(QString("%1,\"%2\"").arg(code).arg(message));
+}
@@ -0,0 +1,74 @@
+#ifndef IPCSCOPESERVER_H
+#define IPCSCOPESERVER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QByteArray>
+#include <QStringList>
+#include <QVector>
+#include <QPointF>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+class IPCScope;
+
+/*
+ * Local control server of a scope, with a SCPI-like command set. Commands are terminated by a new line. Headers accept
+ * the short (upper case part) or the long form, case insensitive, with an optional numeric suffix starting at 1.
+ * Trace payloads are IEEE 488.2 definite length binary blocks (#<n><length><data>) of little endian float64 x,y pairs.
+ *
+ *   *IDN?                                   Identification
+ *   *OPC?                                   Returns 1 once the previous commands are executed
+ *   SYSTem:ERRor?                           Oldest error of the queue
+ *   GRAPh<n>:DATA <block>                   Set the data of graph n
+ *   GRAPh<n>:DATA?                          Get the data of graph n as a binary block
+ *   GRAPh<n>:MODE CLEar|MAXHold|MINHold|AVERage   Set the trace mode (also a query)
+ *   GRAPh:ACTive <n>                        Set the active graph (also a query)
+ *   MARKer:ADD                              Add a marker
+ *   MARKer<n>:X <value>                     Set the key value of marker n (also a query)
+ *   MARKer<n>:Y?                            Get the value of marker n
+ *   ZOOM <x1>,<y1>,<x2>,<y2>                Zoom range, top left and bottom right points (also a query)
+ *   ZOOM:FIT                                Zoom to fit the graphs
+ *   EXPort:PNG "<file>"                     Save the scope to a png file
+ *   EXPort:PDF "<file>"                     Save the scope to a pdf file
+ *
+ * All the commands received in one read are executed with the scope updates disabled, so that a pipelined batch of
+ * commands results in a single repaint.
+ */
+class IPCScopeServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IPCScopeServer(IPCScope *scope, QObject *parent = nullptr);
+    virtual ~IPCScopeServer();
+
+    bool listen(const QString &name);
+    void close();
+
+    // Getters
+    bool isListening() const {return mServer->isListening();}
+    QString fullServerName() const {return mServer->fullServerName();}
+    int clientCount() const {return mBuffers.count();}
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+
+private:
+    void processBuffer(QLocalSocket *socket, QByteArray &buffer);
+    void execute(QLocalSocket *socket, const QByteArray &header, const QByteArray &argument, const QByteArray &block);
+    void reply(QLocalSocket *socket, const QByteArray &text);
+    void replyBlock(QLocalSocket *socket, const QVector<QPointF> &points);
+    void pushError(int code, const QString &message);
+
+    QPointer<IPCScope> mScope;
+    QLocalServer *mServer;
+    // Received bytes not yet executed, per client
+    QHash<QLocalSocket *, QByteArray> mBuffers;
+    // SCPI error queue
+    QStringList mErrors;
+};
+
+#endif // IPCSCOPESERVER_H
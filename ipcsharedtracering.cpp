@@ -0,0 +1,435 @@
+#include "ipcsharedtracering.h"
+#include <QThread>
+#include <QDebug>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <climits>
+#include <ctime>
+#endif
+
+// Size of the ring header, slots are aligned on this size
+static const qint64 HeaderSize = 64;
+// Number of attempts to read a consistent frame before giving up until the next wakeup
+static const int MaxReadAttempts = 4;
+
+/*
+ * Thread sleeping on the wake counter of a ring, queuing a poll of the ring each time the writer commits frames.
+ */
+class IPCSharedTraceRingWaiter : public QThread
+{
+public:
+    explicit IPCSharedTraceRingWaiter(IPCSharedTraceRing *ring) : mRing(ring) {}
+    void stop();
+protected:
+    void run() override;
+private:
+    IPCSharedTraceRing *mRing;
+};
+
+#ifdef Q_OS_LINUX
+/*!
+ * \brief futexWait. Sleep while the futex word equals value, at most timeoutMsec.
+ */
+static void futexWait(QAtomicInteger<quint32> *word, quint32 value, int timeoutMsec)
+{
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMsec / 1000;
+    timeout.tv_nsec = (timeoutMsec % 1000) * 1000000L;
+    // The ring is shared between processes: no FUTEX_PRIVATE_FLAG
+    syscall(SYS_futex, reinterpret_cast<quint32 *>(word), FUTEX_WAIT, value, &timeout, nullptr, 0);
+}
+
+/*!
+ * \brief futexWake. Wake all the threads sleeping on the futex word.
+ */
+static void futexWake(QAtomicInteger<quint32> *word)
+{
+    syscall(SYS_futex, reinterpret_cast<quint32 *>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+#endif
+
+/*!
+ * \brief IPCSharedTraceRingWaiter::run. Sleep on the wake counter, and queue a poll when it changes. A poll already
+ * pending isn't queued twice, so a fast writer can't flood the event loop.
+ */
+void IPCSharedTraceRingWaiter::run()
+{
+#ifdef Q_OS_LINUX
+    IPCSharedTraceRing::RingHeader *header = reinterpret_cast<IPCSharedTraceRing::RingHeader *>(mRing->mBase);
+    quint32 seen = header->wakeCounter.loadAcquire();
+    while(!isInterruptionRequested()){
+        futexWait(&header->wakeCounter, seen, 100);
+        quint32 counter = header->wakeCounter.loadAcquire();
+        if(counter != seen){
+            seen = counter;
+            if(mRing->mPollPending.testAndSetOrdered(0, 1)){
+                QMetaObject::invokeMethod(mRing, "poll", Qt::QueuedConnection);
+            }
+        }
+    }
+#endif
+}
+
+/*!
+ * \brief IPCSharedTraceRingWaiter::stop. Interrupt the thread and wait for it.
+ */
+void IPCSharedTraceRingWaiter::stop()
+{
+    requestInterruption();
+#ifdef Q_OS_LINUX
+    futexWake(&reinterpret_cast<IPCSharedTraceRing::RingHeader *>(mRing->mBase)->wakeCounter);
+#endif
+    wait();
+}
+
+IPCSharedTraceRing::IPCSharedTraceRing(QObject *parent) :
+    QObject(parent),
+    mOwner(false),
+    mBase(nullptr),
+    mSize(0),
+    mWakeupMode(wmPolling),
+    mLastSeq(0),
+    mFramesRead(0),
+    mTornFrames(0),
+    mSkippedFrames(0),
+    mWaiter(nullptr),
+    mPollPending(0)
+{
+    mTraceBuffer = new IPCTraceBuffer(this);
+    mPollTimer = new QTimer(this);
+    mPollTimer->setTimerType(Qt::PreciseTimer);
+    mPollTimer->setInterval(5);
+    connect(mPollTimer, &QTimer::timeout, this, &IPCSharedTraceRing::poll);
+}
+
+IPCSharedTraceRing::~IPCSharedTraceRing()
+{
+    close();
+}
+
+/*!
+ * \brief IPCSharedTraceRing::slotStride. Return the size of a slot in bytes, header included.
+ * \param slotCapacity
+ * \param sampleFormat
+ * \return
+ */
+qint64 IPCSharedTraceRing::slotStride(quint32 slotCapacity, quint32 sampleFormat)
+{
+    qint64 sampleSize = (sampleFormat == sfFloat32) ? sizeof(float) : sizeof(double);
+    qint64 stride = sizeof(SlotHeader) + 2*sampleSize*slotCapacity;
+    return (stride + HeaderSize - 1) / HeaderSize * HeaderSize;
+}
+
+/*!
+ * \brief IPCSharedTraceRing::slot. Return the slot holding a frame.
+ * \param frame
+ * \return
+ */
+IPCSharedTraceRing::SlotHeader *IPCSharedTraceRing::slot(quint64 frame) const
+{
+    const RingHeader *header = reinterpret_cast<const RingHeader *>(mBase);
+    qint64 offset = HeaderSize + (qint64)(frame % header->slotCount) * slotStride(header->slotCapacity, header->sampleFormat);
+    return reinterpret_cast<SlotHeader *>(mBase + offset);
+}
+
+/*!
+ * \brief IPCSharedTraceRing::map. Open (or create) the shared memory object and map it.
+ * \param name
+ * \param create. If true, the object is created with size bytes. Otherwise its size is read.
+ * \param size
+ * \return
+ */
+bool IPCSharedTraceRing::map(const QString &name, bool create, qint64 size)
+{
+#ifdef Q_OS_UNIX
+    QByteArray path = name.toLocal8Bit();
+    if(!path.startsWith('/')){
+        path.prepend('/');
+    }
+    int fd = create ? shm_open(path.constData(), O_RDWR | O_CREAT | O_TRUNC, 0660) : shm_open(path.constData(), O_RDWR, 0);
+    if(fd < 0){
+        qDebug() << Q_FUNC_INFO << "couldn't open shared memory" << name << ":" << strerror(errno);
+        return false;
+    }
+    if(create){
+        if(ftruncate(fd, size) != 0){
+            qDebug() << Q_FUNC_INFO << "couldn't size shared memory" << name << ":" << strerror(errno);
+            ::close(fd);
+            shm_unlink(path.constData());
+            return false;
+        }
+    } else{
+        struct stat st;
+        if(fstat(fd, &st) != 0){
+            ::close(fd);
+            return false;
+        }
+        size = st.st_size;
+    }
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(base == MAP_FAILED){
+        qDebug() << Q_FUNC_INFO << "couldn't map shared memory" << name << ":" << strerror(errno);
+        return false;
+    }
+    mBase = static_cast<uchar *>(base);
+    mSize = size;
+    mName = name;
+    mOwner = create;
+    return true;
+#else
+    Q_UNUSED(create)
+    Q_UNUSED(size)
+    qDebug() << Q_FUNC_INFO << "POSIX shared memory isn't available on this platform:" << name;
+    return false;
+#endif
+}
+
+/*!
+ * \brief IPCSharedTraceRing::open. Map an existing ring and start watching it. Return false if the ring doesn't exist or
+ * its header is invalid.
+ * \param name. Name of the shared memory object.
+ * \param mode. Wakeup mode. The futex mode falls back to polling on platforms without futex.
+ * \return
+ */
+bool IPCSharedTraceRing::open(const QString &name, WakeupMode mode)
+{
+    close();
+    if(!map(name, false, 0)){
+        return false;
+    }
+    const RingHeader *header = reinterpret_cast<const RingHeader *>(mBase);
+    if((mSize < HeaderSize) || (header->magic != RingMagic) || (header->version != RingVersion)
+            || (header->slotCount == 0) || (header->sampleFormat > sfFloat64)
+            || (mSize < HeaderSize + header->slotCount*slotStride(header->slotCapacity, header->sampleFormat))){
+        qDebug() << Q_FUNC_INFO << "invalid trace ring header:" << name;
+        close();
+        return false;
+    }
+
+    mWakeupMode = mode;
+#ifndef Q_OS_LINUX
+    mWakeupMode = wmPolling;
+#endif
+    if(mWakeupMode == wmFutex){
+        mWaiter = new IPCSharedTraceRingWaiter(this);
+        mWaiter->start();
+    } else{
+        mPollTimer->start();
+    }
+    poll();
+    return true;
+}
+
+/*!
+ * \brief IPCSharedTraceRing::create. Create a ring, on the writer side. An existing ring with the same name is replaced.
+ * \param name. Name of the shared memory object.
+ * \param slotCount. Number of frames the ring holds.
+ * \param slotCapacity. Maximum number of points per frame.
+ * \param format
+ * \return
+ */
+bool IPCSharedTraceRing::create(const QString &name, int slotCount, int slotCapacity, SampleFormat format)
+{
+    close();
+    if((slotCount <= 0) || (slotCapacity <= 0)){
+        qDebug() << Q_FUNC_INFO << "Non positive slot count or capacity:" << slotCount << slotCapacity;
+        return false;
+    }
+    if(!map(name, true, HeaderSize + slotCount*slotStride(slotCapacity, format))){
+        return false;
+    }
+    // The object is zero filled by ftruncate
+    RingHeader *header = reinterpret_cast<RingHeader *>(mBase);
+    header->magic = RingMagic;
+    header->version = RingVersion;
+    header->slotCount = slotCount;
+    header->slotCapacity = slotCapacity;
+    header->sampleFormat = format;
+    header->writeSeq.storeRelease(0);
+    return true;
+}
+
+/*!
+ * \brief IPCSharedTraceRing::write. Write a frame into the ring, on the writer side, and wake the readers. Points beyond
+ * the slot capacity are dropped.
+ * \param points
+ * \return
+ */
+bool IPCSharedTraceRing::write(const QVector<QPointF> &points)
+{
+    if(!mBase || !mOwner){
+        qDebug() << Q_FUNC_INFO << "The ring isn't open for writing:" << mName;
+        return false;
+    }
+    RingHeader *header = reinterpret_cast<RingHeader *>(mBase);
+    quint64 frame = header->writeSeq.loadAcquire();
+    SlotHeader *s = slot(frame);
+    quint32 count = qMin<quint32>(points.size(), header->slotCapacity);
+
+    s->seq.storeRelease(2*frame + 1);
+    std::atomic_thread_fence(std::memory_order_release);
+    if(header->sampleFormat == sfFloat64){
+        double *dst = reinterpret_cast<double *>(s + 1);
+        if(sizeof(qreal) == sizeof(double)){
+            std::memcpy(dst, points.constData(), count*sizeof(QPointF));
+        } else{
+            for(quint32 i = 0; i < count; i++){
+                dst[2*i] = points.at(i).x();
+                dst[2*i+1] = points.at(i).y();
+            }
+        }
+    } else{
+        float *dst = reinterpret_cast<float *>(s + 1);
+        for(quint32 i = 0; i < count; i++){
+            dst[2*i] = points.at(i).x();
+            dst[2*i+1] = points.at(i).y();
+        }
+    }
+    s->pointCount = count;
+    s->seq.storeRelease(2*frame + 2);
+    header->writeSeq.storeRelease(frame + 1);
+    header->wakeCounter.fetchAndAddRelease(1);
+#ifdef Q_OS_LINUX
+    futexWake(&header->wakeCounter);
+#endif
+    return true;
+}
+
+/*!
+ * \brief IPCSharedTraceRing::close. Stop watching the ring and unmap it. The writer also removes the shared memory object.
+ */
+void IPCSharedTraceRing::close()
+{
+    mPollTimer->stop();
+    if(mWaiter){
+        mWaiter->stop();
+        delete mWaiter;
+        mWaiter = nullptr;
+    }
+#ifdef Q_OS_UNIX
+    if(mBase){
+        munmap(mBase, mSize);
+        if(mOwner){
+            QByteArray path = mName.toLocal8Bit();
+            if(!path.startsWith('/')){
+                path.prepend('/');
+            }
+            shm_unlink(path.constData());
+        }
+    }
+#endif
+    mBase = nullptr;
+    mSize = 0;
+    mOwner = false;
+    mLastSeq = 0;
+    mFramesRead = 0;
+    mTornFrames = 0;
+    mSkippedFrames = 0;
+    mPollPending.storeRelease(0);
+}
+
+/*!
+ * \brief IPCSharedTraceRing::setPollInterval. Set the interval of the polling wakeup mode. Default is 5 ms.
+ * \param msec
+ */
+void IPCSharedTraceRing::setPollInterval(int msec)
+{
+    mPollTimer->setInterval(qMax(1, msec));
+}
+
+/*!
+ * \brief IPCSharedTraceRing::poll. Read the latest committed frame, if it wasn't read yet, and publish it to the trace
+ * buffer. Older frames not read yet are skipped: the display always shows the newest data.
+ */
+void IPCSharedTraceRing::poll()
+{
+    mPollPending.storeRelease(0);
+    if(!mBase){
+        return;
+    }
+    RingHeader *header = reinterpret_cast<RingHeader *>(mBase);
+    const quint32 capacity = header->slotCapacity;
+    for(int attempt = 0; attempt < MaxReadAttempts; attempt++){
+        quint64 written = header->writeSeq.loadAcquire();
+        if(written == mLastSeq){
+            return;
+        }
+        quint64 frame = written - 1;
+        SlotHeader *s = slot(frame);
+        quint64 seqBefore = s->seq.loadAcquire();
+        if(seqBefore != 2*frame + 2){
+            // The slot is already reused by a newer frame
+            mTornFrames++;
+            continue;
+        }
+        quint32 count = qMin(s->pointCount, capacity);
+        QVector<QPointF> points(count);
+        if(header->sampleFormat == sfFloat64){
+            const double *src = reinterpret_cast<const double *>(s + 1);
+            if(sizeof(qreal) == sizeof(double)){
+                std::memcpy(points.data(), src, count*sizeof(QPointF));
+            } else{
+                for(quint32 i = 0; i < count; i++){
+                    points[i] = QPointF(src[2*i], src[2*i+1]);
+                }
+            }
+        } else{
+            const float *src = reinterpret_cast<const float *>(s + 1);
+            QPointF *dst = points.data();
+            for(quint32 i = 0; i < count; i++){
+                dst[i] = QPointF(src[2*i], src[2*i+1]);
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(s->seq.loadAcquire() != seqBefore){
+            // Overwritten during the copy
+            mTornFrames++;
+            continue;
+        }
+        if(mFramesRead > 0){
+            mSkippedFrames += frame - mLastSeq;
+        }
+        mLastSeq = written;
+        mFramesRead++;
+        mTraceBuffer->publish(points);
+        return;
+    }
+}
+
+/*!
+ * \brief IPCSharedTraceRing::slotCount. Return the number of slots of the ring, 0 if it isn't open.
+ * \return
+ */
+int IPCSharedTraceRing::slotCount() const
+{
+    return mBase ? (int)reinterpret_cast<const RingHeader *>(mBase)->slotCount : 0;
+}
+
+/*!
+ * \brief IPCSharedTraceRing::slotCapacity. Return the maximum number of points per frame, 0 if the ring isn't open.
+ * \return
+ */
+int IPCSharedTraceRing::slotCapacity() const
+{
+    return mBase ? (int)reinterpret_cast<const RingHeader *>(mBase)->slotCapacity : 0;
+}
+
+/*!
+ * \brief IPCSharedTraceRing::sampleFormat. Return the sample format of the ring.
+ * \return
+ */
+IPCSharedTraceRing::SampleFormat IPCSharedTraceRing::sampleFormat() const
+{
+    return mBase ? (SampleFormat)reinterpret_cast<const RingHeader *>(mBase)->sampleFormat : sfFloat64;
+}
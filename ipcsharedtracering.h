@@ -0,0 +1,110 @@
+#ifndef IPCSHAREDTRACERING_H
+#define IPCSHAREDTRACERING_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QAtomicInteger>
+#include "ipctracebuffer.h"
+
+class IPCSharedTraceRingWaiter;
+
+/*
+ * Reader (and writer) of a named POSIX shared memory ring of trace frames, filled by an external acquisition process.
+ *
+ * Layout of the mapping, all values in host byte order:
+ *   RingHeader                      64 bytes
+ *   slot 0 .. slotCount-1           SlotHeader (16 bytes) then slotCapacity interleaved x,y pairs, float32 or float64,
+ *                                   each slot padded to a multiple of 64 bytes
+ *
+ * Writer protocol, for frame number f (starting at 0) in slot f % slotCount:
+ *   slot.seq = 2f+1 (odd: slot being written), store the points and pointCount, slot.seq = 2f+2 (release),
+ *   writeSeq = f+1 (release), then increment wakeCounter and wake the futex waiters on it.
+ *
+ * The reader only takes the latest frame, and checks slot.seq before and after the copy (seqlock): a frame overwritten
+ * during the copy is discarded and counted as torn. The frames are published to a trace buffer, to be attached to graphs.
+ */
+class IPCSharedTraceRing : public QObject
+{
+    Q_OBJECT
+public:
+    enum SampleFormat { sfFloat32=0   /// x,y pairs of float
+                       ,sfFloat64=1   /// x,y pairs of double, the layout of QPointF
+                      };
+    Q_ENUMS(SampleFormat)
+
+    enum WakeupMode { wmPolling   /// Check the ring on a timer
+                     ,wmFutex     /// Sleep on the wake counter of the ring (Linux), polling elsewhere
+                    };
+    Q_ENUMS(WakeupMode)
+
+    struct RingHeader {
+        quint32 magic;                      // RingMagic
+        quint32 version;                    // RingVersion
+        quint32 slotCount;
+        quint32 slotCapacity;               // Maximum number of points per frame
+        quint32 sampleFormat;               // SampleFormat
+        QAtomicInteger<quint32> wakeCounter;// Incremented for each frame, futex word
+        QAtomicInteger<quint64> writeSeq;   // Number of frames committed
+        quint8 reserved[32];
+    };
+    struct SlotHeader {
+        QAtomicInteger<quint64> seq;        // 2f+1 while frame f is written, 2f+2 once committed
+        quint32 pointCount;
+        quint32 reserved;
+    };
+    static const quint32 RingMagic = 0x52435049;    // "IPCR"
+    static const quint32 RingVersion = 1;
+
+    explicit IPCSharedTraceRing(QObject *parent = nullptr);
+    virtual ~IPCSharedTraceRing();
+
+    // Reader side: map an existing ring
+    bool open(const QString &name, WakeupMode mode = wmFutex);
+    // Writer side: create (or replace) a ring and write frames into it
+    bool create(const QString &name, int slotCount, int slotCapacity, SampleFormat format = sfFloat64);
+    bool write(const QVector<QPointF> &points);
+    void close();
+
+    void setPollInterval(int msec);
+
+    // Getters
+    bool isOpen() const {return mBase != nullptr;}
+    QString name() const {return mName;}
+    int slotCount() const;
+    int slotCapacity() const;
+    SampleFormat sampleFormat() const;
+    WakeupMode wakeupMode() const {return mWakeupMode;}
+    quint64 framesRead() const {return mFramesRead;}
+    quint64 tornFrames() const {return mTornFrames;}
+    quint64 skippedFrames() const {return mSkippedFrames;}
+    IPCTraceBuffer *traceBuffer() const {return mTraceBuffer;}
+
+public slots:
+    void poll();
+
+private:
+    bool map(const QString &name, bool create, qint64 size);
+    SlotHeader *slot(quint64 frame) const;
+    static qint64 slotStride(quint32 slotCapacity, quint32 sampleFormat);
+
+    friend class IPCSharedTraceRingWaiter;
+
+    QString mName;
+    bool mOwner;
+    uchar *mBase;
+    qint64 mSize;
+    WakeupMode mWakeupMode;
+    // Last frame read, number of frames read, torn and never shown
+    quint64 mLastSeq;
+    quint64 mFramesRead;
+    quint64 mTornFrames;
+    quint64 mSkippedFrames;
+    QTimer *mPollTimer;
+    IPCSharedTraceRingWaiter *mWaiter;
+    // Set while a poll queued by the waiter is pending
+    QAtomicInt mPollPending;
+    IPCTraceBuffer *mTraceBuffer;
+};
+
+#endif // IPCSHAREDTRACERING_H
@@ -0,0 +1,238 @@
+#include "ipcspatialindex.h"
+#include "ipcaxismapping.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Size of the grid cells, in pixels
+static const double CellSize = 8.0;
+
+IPCSpatialIndex::IPCSpatialIndex() :
+    mSorted(-1),
+    mGridValid(false),
+    mGridXLog(false),
+    mGridYLog(false),
+    mCols(0),
+    mRows(0)
+{
+}
+
+/*!
+ * \brief IPCSpatialIndex::setPoints. Set the data of the graph. Nothing is computed until the next query.
+ * \param points
+ */
+void IPCSpatialIndex::setPoints(const QVector<QPointF> &points)
+{
+    mPoints = points;
+    mSorted = -1;
+    mGridValid = false;
+}
+
+/*!
+ * \brief IPCSpatialIndex::setValueTransform. Set the transform of the y values. The points stay in their unit, only the
+ * points searched are converted.
+ * \param transform
+ */
+void IPCSpatialIndex::setValueTransform(const IPCUnitTransform &transform)
+{
+    mValueTransform = transform;
+    mGridValid = false;
+}
+
+/*!
+ * \brief IPCSpatialIndex::clear. Drop the grid, it is rebuilt on next query.
+ */
+void IPCSpatialIndex::clear()
+{
+    mGridValid = false;
+    mCellStart = QVector<int>();
+    mCellIndices = QVector<int>();
+    mCellPixels = QVector<QPointF>();
+}
+
+/*!
+ * \brief IPCSpatialIndex::memoryUsage. Return the memory used by the grid, in bytes. The points are shared with the graph
+ * and aren't counted.
+ * \return
+ */
+qint64 IPCSpatialIndex::memoryUsage() const
+{
+    return (qint64)(mCellStart.capacity() + mCellIndices.capacity())*sizeof(int) + (qint64)mCellPixels.capacity()*sizeof(QPointF);
+}
+
+/*!
+ * \brief IPCSpatialIndex::nearest. Search the point closest to a pixel position. For graphs sorted by x, this is the point
+ * with the closest key (as for a marker), found by binary search. For other graphs, this is the visible point with the
+ * smallest pixel distance.
+ * \param pixelPos. Position in chart coordinates.
+ * \param plotArea. Plot area of the chart.
+ * \param range. Visible range in graph's coordinates, top being the minimum y value.
+ * \param xLog. True if the x axis is log scale.
+ * \param yLog. True if the y axis is log scale.
+ * \param maxDistance. Maximum pixel distance.
+ * \param distance. If not null, receives the pixel distance of the point found.
+ * \return
+ */
+int IPCSpatialIndex::nearest(const QPointF &pixelPos, const QRectF &plotArea, const QRectF &range, bool xLog, bool yLog,
+                             double maxDistance, double *distance)
+{
+    const int n = mPoints.size();
+    if((n == 0) || plotArea.isEmpty()){
+        return -1;
+    }
+    const QPointF *p = mPoints.constData();
+    if(mSorted < 0){
+        mSorted = 1;
+        for(int i = 1; i < n; i++){
+            if(!(p[i].x() >= p[i-1].x())){
+                mSorted = 0;
+                break;
+            }
+        }
+    }
+    // The axis scales are resolved once, for the whole search
+    if(xLog){
+        return yLog ? search<IPCLogScale, IPCLogScale>(pixelPos, plotArea, range, maxDistance, distance)
+                    : search<IPCLogScale, IPCLinearScale>(pixelPos, plotArea, range, maxDistance, distance);
+    }
+    return yLog ? search<IPCLinearScale, IPCLogScale>(pixelPos, plotArea, range, maxDistance, distance)
+                : search<IPCLinearScale, IPCLinearScale>(pixelPos, plotArea, range, maxDistance, distance);
+}
+
+/*!
+ * \brief IPCSpatialIndex::search. Nearest point search, for one pair of axis scales. See nearest().
+ */
+template <typename XScale, typename YScale>
+int IPCSpatialIndex::search(const QPointF &pixelPos, const QRectF &plotArea, const QRectF &range, double maxDistance,
+                            double *distance)
+{
+    const IPCAxisMapping<XScale, YScale> mapping(plotArea, range);
+    if(!mapping.isValid()){
+        return -1;
+    }
+    const int n = mPoints.size();
+    const QPointF *p = mPoints.constData();
+
+    int best = -1;
+    double bestDist2 = maxDistance*maxDistance;
+    if(mSorted == 1){
+        // Key under the cursor, then the two points around it
+        double key = mapping.key(pixelPos.x());
+        const QPointF *it = std::lower_bound(p, p + n, key, [](const QPointF &point, double x){return point.x() < x;});
+        int idx = int(it - p);
+        for(int i = qMax(0, idx-1); i <= qMin(n-1, idx); i++){
+            double px = mapping.pixelX(p[i].x());
+            double py = mapping.pixelY(mValueTransform.apply(p[i].y()));
+            double dist2 = (px - pixelPos.x())*(px - pixelPos.x()) + (py - pixelPos.y())*(py - pixelPos.y());
+            if(dist2 <= bestDist2){
+                bestDist2 = dist2;
+                best = i;
+            }
+        }
+    } else{
+        if(!mGridValid || (mGridPlotArea != plotArea) || (mGridRange != range) || (mGridXLog != XScale::isLog)
+                || (mGridYLog != YScale::isLog)){
+            buildGrid<XScale, YScale>(plotArea, range);
+        }
+        int cx = (int)std::floor((pixelPos.x() - plotArea.left())/CellSize);
+        int cy = (int)std::floor((pixelPos.y() - plotArea.top())/CellSize);
+        int radius = (int)std::ceil(maxDistance/CellSize);
+        const int *start = mCellStart.constData();
+        const int *indices = mCellIndices.constData();
+        const QPointF *pixels = mCellPixels.constData();
+        for(int r = qMax(0, cy-radius); r <= qMin(mRows-1, cy+radius); r++){
+            for(int c = qMax(0, cx-radius); c <= qMin(mCols-1, cx+radius); c++){
+                int cell = r*mCols + c;
+                for(int k = start[cell]; k < start[cell+1]; k++){
+                    double dx = pixels[k].x() - pixelPos.x();
+                    double dy = pixels[k].y() - pixelPos.y();
+                    double dist2 = dx*dx + dy*dy;
+                    if(dist2 <= bestDist2){
+                        bestDist2 = dist2;
+                        best = indices[k];
+                    }
+                }
+            }
+        }
+    }
+    if(distance && (best >= 0)){
+        *distance = std::sqrt(bestDist2);
+    }
+    return best;
+}
+
+/*!
+ * \brief IPCSpatialIndex::buildGrid. Sort the visible points into a grid of CellSize pixels, storing their pixel position.
+ * The pixel positions are computed by blocks: the y values are converted to the shown unit, then all the points of the
+ * block are mapped, in loops without branches on the axis scales.
+ * \param plotArea
+ * \param range
+ */
+template <typename XScale, typename YScale>
+void IPCSpatialIndex::buildGrid(const QRectF &plotArea, const QRectF &range)
+{
+    const IPCAxisMapping<XScale, YScale> mapping(plotArea, range);
+    mGridPlotArea = plotArea;
+    mGridRange = range;
+    mGridXLog = XScale::isLog;
+    mGridYLog = YScale::isLog;
+    mCols = qMax(1, (int)std::ceil(plotArea.width()/CellSize));
+    mRows = qMax(1, (int)std::ceil(plotArea.height()/CellSize));
+
+    const int n = mPoints.size();
+    const QPointF *p = mPoints.constData();
+    const bool transformed = !mValueTransform.isIdentity();
+    auto cellOf = [&](const QPointF &pixel){
+        double c = std::floor((pixel.x() - plotArea.left())/CellSize);
+        double r = std::floor((pixel.y() - plotArea.top())/CellSize);
+        // Written so that NaN positions are rejected
+        if(!((c >= 0) && (c < mCols) && (r >= 0) && (r < mRows))){
+            return -1;
+        }
+        return int(r)*mCols + int(c);
+    };
+
+    // Counting sort of the visible points by cell, keeping the cell of each point
+    mCellStart.fill(0, mCols*mRows + 1);
+    int *start = mCellStart.data();
+    QVector<int> pointCells(n);
+    int *cells = pointCells.data();
+    const int blockSize = 256;
+    QPointF block[blockSize];
+    for(int first = 0; first < n; first += blockSize){
+        const int count = qMin(blockSize, n - first);
+        if(transformed){
+            mValueTransform.apply(p + first, count, block);
+            mapping.map(block, count, block);
+        } else{
+            mapping.map(p + first, count, block);
+        }
+        for(int k = 0; k < count; k++){
+            int cell = cellOf(block[k]);
+            cells[first + k] = cell;
+            if(cell >= 0){
+                start[cell+1]++;
+            }
+        }
+    }
+    for(int c = 0; c < mCols*mRows; c++){
+        start[c+1] += start[c];
+    }
+    int count = start[mCols*mRows];
+    mCellIndices.resize(count);
+    mCellPixels.resize(count);
+    QVector<int> cursor = mCellStart;
+    int *cur = cursor.data();
+    int *indices = mCellIndices.data();
+    QPointF *pixels = mCellPixels.data();
+    // Only the visible points are mapped again
+    for(int i = 0; i < n; i++){
+        int cell = cells[i];
+        if(cell >= 0){
+            int k = cur[cell]++;
+            indices[k] = i;
+            pixels[k] = mapping.pixel(QPointF(p[i].x(), transformed ? mValueTransform.apply(p[i].y()) : p[i].y()));
+        }
+    }
+    mGridValid = true;
+}
@@ -0,0 +1,55 @@
+#ifndef IPCSPATIALINDEX_H
+#define IPCSPATIALINDEX_H
+
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+#include "ipcunittransform.h"
+
+/*
+ * Nearest point search on a graph, in pixel distance. The index is rebuilt lazily, on the first query after the data,
+ * the visible range or the plot area changed. Graphs sorted by x are searched by binary search on the key. Other graphs
+ * use a uniform grid of the visible points in pixel coordinates, so a query only visits the cells around the cursor.
+ */
+class IPCSpatialIndex
+{
+public:
+    IPCSpatialIndex();
+
+    // Data of the graph. The vector is shared, not copied, the index is rebuilt on next query.
+    void setPoints(const QVector<QPointF> &points);
+    void clear();
+    // Transform of the y values, from the unit of the points to the unit of the range
+    void setValueTransform(const IPCUnitTransform &transform);
+
+    // Return the index of the point closest to pixelPos (chart coordinates), or -1 if there is none within maxDistance pixels
+    int nearest(const QPointF &pixelPos, const QRectF &plotArea, const QRectF &range, bool xLog, bool yLog,
+                double maxDistance, double *distance = nullptr);
+    const QVector<QPointF> &points() const {return mPoints;}
+    qint64 memoryUsage() const;
+
+private:
+    template <typename XScale, typename YScale>
+    int search(const QPointF &pixelPos, const QRectF &plotArea, const QRectF &range, double maxDistance, double *distance);
+    template <typename XScale, typename YScale>
+    void buildGrid(const QRectF &plotArea, const QRectF &range);
+
+    QVector<QPointF> mPoints;
+    // -1: unknown, 0: unsorted, 1: sorted by x
+    int mSorted;
+    IPCUnitTransform mValueTransform;
+    // Grid state: mapping it was built for
+    bool mGridValid;
+    QRectF mGridPlotArea;
+    QRectF mGridRange;
+    bool mGridXLog;
+    bool mGridYLog;
+    // Grid of the visible points, compressed row storage
+    int mCols;
+    int mRows;
+    QVector<int> mCellStart;
+    QVector<int> mCellIndices;
+    QVector<QPointF> mCellPixels;
+};
+
+#endif // IPCSPATIALINDEX_H
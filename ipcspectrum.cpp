@@ -0,0 +1,315 @@
+#include "ipcspectrum.h"
+#include <QList>
+#include <QPair>
+#include <QMutex>
+#include <QString>
+#include <QDebug>
+#include <cmath>
+
+// Cache of the last window coefficients computed, shared by all the instances, most recently used first
+static const int WindowCacheSize = 8;
+static QMutex windowMutex;
+static QList<QPair<QString, QVector<double> > > windowCache;
+
+/*!
+ * \brief besselI0. Modified Bessel function of the first kind, order 0, by its power series.
+ */
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    double halfX = x / 2.0;
+    for(int k = 1; k < 64; k++){
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+        if(term < sum * 1e-17){
+            break;
+        }
+    }
+    return sum;
+}
+
+/*!
+ * \brief IPCSpectrum::IPCSpectrum. Constructor. Hann window, automatic size, dBFS scale with a full scale of 1.
+ */
+IPCSpectrum::IPCSpectrum() :
+    mSize(0),
+    mWindow(swHann),
+    mKaiserBeta(9.0),
+    mSampleRate(1.0),
+    mCenterFrequency(0.0),
+    mScale(ssDbfs),
+    mFullScale(1.0),
+    mImpedance(50.0),
+    mCoherentGain(0.0),
+    mEnbwBins(0.0)
+{
+
+}
+
+/*!
+ * \brief IPCSpectrum::setSize. Set the transform size. 0 selects the largest power of two not above the sample count.
+ * \param size Transform size, a power of two or 0
+ */
+void IPCSpectrum::setSize(int size)
+{
+    if(size != 0 && !IPCFft::isPowerOfTwo(size)){
+        qDebug() << Q_FUNC_INFO << "Size must be a power of two";
+        return;
+    }
+    mSize = size;
+}
+
+/*!
+ * \brief IPCSpectrum::setWindow. Set the window applied before the transform.
+ * \param window Window type
+ * \param kaiserBeta Shape of the Kaiser window, ignored by the other windows
+ */
+void IPCSpectrum::setWindow(Window window, double kaiserBeta)
+{
+    mWindow = window;
+    mKaiserBeta = kaiserBeta;
+    mCoefficients.clear();
+}
+
+/*!
+ * \brief IPCSpectrum::setSampleRate. Set the sample rate of the time samples, in Hz.
+ * \param sampleRate Sample rate
+ */
+void IPCSpectrum::setSampleRate(double sampleRate)
+{
+    if(sampleRate <= 0){
+        qDebug() << Q_FUNC_INFO << "Sample rate must be positive";
+        return;
+    }
+    mSampleRate = sampleRate;
+}
+
+/*!
+ * \brief IPCSpectrum::binWidth. Return the spacing of the bins of the last transform, in Hz.
+ */
+double IPCSpectrum::binWidth() const
+{
+    if(mFft.size() == 0){
+        return 0.0;
+    }
+    return mSampleRate / mFft.size();
+}
+
+/*!
+ * \brief IPCSpectrum::enbwBins. Return the equivalent noise bandwidth of the window of the last transform, in bins.
+ */
+double IPCSpectrum::enbwBins() const
+{
+    return mEnbwBins;
+}
+
+/*!
+ * \brief IPCSpectrum::enbw. Return the equivalent noise bandwidth of the last transform, in Hz. This is the resolution
+ * bandwidth to use when reading noise densities from the spectrum.
+ */
+double IPCSpectrum::enbw() const
+{
+    return mEnbwBins * binWidth();
+}
+
+/*!
+ * \brief IPCSpectrum::windowCoefficients. Return the coefficients of a periodic window. The last windows used are
+ * cached.
+ * \param window Window type
+ * \param size Number of coefficients
+ * \param kaiserBeta Shape of the Kaiser window
+ */
+QVector<double> IPCSpectrum::windowCoefficients(Window window, int size, double kaiserBeta)
+{
+    if(size <= 0){
+        return QVector<double>();
+    }
+    QString key = QString("%1/%2/%3").arg(window).arg(size).arg(window == swKaiser ? kaiserBeta : 0.0);
+    QMutexLocker locker(&windowMutex);
+    for(int i = 0; i < windowCache.size(); i++){
+        if(windowCache.at(i).first == key){
+            windowCache.move(i, 0);
+            return windowCache.first().second;
+        }
+    }
+    locker.unlock();
+
+    QVector<double> coefficients(size);
+    double *w = coefficients.data();
+    const double twoPi = 2.0 * M_PI;
+    switch(window){
+    case swRectangular:
+        coefficients.fill(1.0);
+        break;
+    case swHann:
+        for(int i = 0; i < size; i++){
+            w[i] = 0.5 - 0.5 * std::cos(twoPi * i / size);
+        }
+        break;
+    case swFlatTop:
+        for(int i = 0; i < size; i++){
+            double x = twoPi * i / size;
+            w[i] = 0.21557895 - 0.41663158 * std::cos(x) + 0.277263158 * std::cos(2*x)
+                    - 0.083578947 * std::cos(3*x) + 0.006947368 * std::cos(4*x);
+        }
+        break;
+    case swBlackmanHarris:
+        for(int i = 0; i < size; i++){
+            double x = twoPi * i / size;
+            w[i] = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2*x) - 0.01168 * std::cos(3*x);
+        }
+        break;
+    case swKaiser:{
+        double norm = besselI0(kaiserBeta);
+        for(int i = 0; i < size; i++){
+            double r = 2.0 * i / size - 1.0;
+            w[i] = besselI0(kaiserBeta * std::sqrt(qMax(0.0, 1.0 - r*r))) / norm;
+        }
+        break;
+    }
+    }
+
+    locker.relock();
+    windowCache.prepend(qMakePair(key, coefficients));
+    while(windowCache.size() > WindowCacheSize){
+        windowCache.removeLast();
+    }
+    return coefficients;
+}
+
+/*!
+ * \brief IPCSpectrum::transformSize. Return the transform size used for count samples.
+ * \param count Number of samples
+ */
+int IPCSpectrum::transformSize(int count) const
+{
+    if(mSize > 0){
+        return mSize;
+    }
+    int size = 1;
+    while(size <= count / 2){
+        size <<= 1;
+    }
+    return size;
+}
+
+/*!
+ * \brief IPCSpectrum::prepare. Update the transform, the window and its gains for a transform size. The window spans
+ * the samples only, not the zero padding, so that the gains are those of the window applied.
+ * \param size Transform size
+ * \param length Number of samples transformed, at most size
+ */
+void IPCSpectrum::prepare(int size, int length)
+{
+    if(mFft.size() != size){
+        mFft.setSize(size);
+        mCoefficients.clear();
+    }
+    if(mCoefficients.size() == length){
+        return;
+    }
+    mCoefficients = windowCoefficients(mWindow, length, mKaiserBeta);
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    foreach(double w, mCoefficients){
+        sum += w;
+        sumSquares += w * w;
+    }
+    mCoherentGain = sum;
+    mEnbwBins = (sum > 0) ? size * sumSquares / (sum * sum) : 0.0;
+}
+
+/*!
+ * \brief IPCSpectrum::toDb. Convert a tone amplitude to the current scale.
+ * \param amplitude Peak amplitude
+ */
+double IPCSpectrum::toDb(double amplitude) const
+{
+    // Floor the result instead of returning -inf for empty bins
+    const double floor = 1e-30;
+    if(mScale == ssDbm){
+        double power = amplitude * amplitude / (2.0 * mImpedance);
+        return 10.0 * std::log10(qMax(power / 1e-3, floor));
+    }
+    return 20.0 * std::log10(qMax(amplitude / mFullScale, floor));
+}
+
+/*!
+ * \brief IPCSpectrum::process. Return the one sided spectrum of real samples, from DC to Nyquist.
+ * \param samples Time samples
+ * \param count Number of samples
+ */
+QVector<QPointF> IPCSpectrum::process(const double *samples, int count)
+{
+    if(samples == nullptr || count < 2){
+        qDebug() << Q_FUNC_INFO << "Not enough samples";
+        return QVector<QPointF>();
+    }
+    int size = transformSize(count);
+    if(size < 2){
+        qDebug() << Q_FUNC_INFO << "Transform size must be at least 2";
+        return QVector<QPointF>();
+    }
+    int used = qMin(count, size);
+    prepare(size, used);
+
+    QVector<double> windowed(size, 0.0);
+    double *dst = windowed.data();
+    const double *w = mCoefficients.constData();
+    for(int i = 0; i < used; i++){
+        dst[i] = samples[i] * w[i];
+    }
+    QVector<std::complex<double> > bins = mFft.transformReal(dst);
+
+    // A tone of amplitude A gives |X| = A.sum(w)/2 in its bin; DC and Nyquist are not split between two bins
+    int half = size / 2;
+    double df = mSampleRate / size;
+    QVector<QPointF> points(half + 1);
+    QPointF *out = points.data();
+    for(int k = 0; k <= half; k++){
+        double gain = (k == 0 || k == half) ? 1.0 : 2.0;
+        out[k] = QPointF(k * df, toDb(gain * std::abs(bins.at(k)) / mCoherentGain));
+    }
+    return points;
+}
+
+/*!
+ * \brief IPCSpectrum::process. Return the two sided spectrum of complex (IQ) samples, from -fs/2 to fs/2 around the
+ * center frequency.
+ * \param samples Time samples
+ * \param count Number of samples
+ */
+QVector<QPointF> IPCSpectrum::process(const std::complex<double> *samples, int count)
+{
+    if(samples == nullptr || count < 2){
+        qDebug() << Q_FUNC_INFO << "Not enough samples";
+        return QVector<QPointF>();
+    }
+    int size = transformSize(count);
+    if(size < 2){
+        qDebug() << Q_FUNC_INFO << "Transform size must be at least 2";
+        return QVector<QPointF>();
+    }
+    int used = qMin(count, size);
+    prepare(size, used);
+
+    QVector<std::complex<double> > windowed(size, std::complex<double>(0.0, 0.0));
+    std::complex<double> *dst = windowed.data();
+    const double *w = mCoefficients.constData();
+    for(int i = 0; i < used; i++){
+        dst[i] = std::complex<double>(samples[i].real() * w[i], samples[i].imag() * w[i]);
+    }
+    mFft.transform(dst);
+
+    // Negative frequencies first
+    int half = size / 2;
+    double df = mSampleRate / size;
+    QVector<QPointF> points(size);
+    QPointF *out = points.data();
+    for(int i = 0; i < size; i++){
+        int k = (i + half) % size;
+        out[i] = QPointF(mCenterFrequency + (i - half) * df, toDb(std::abs(dst[k]) / mCoherentGain));
+    }
+    return points;
+}
@@ -0,0 +1,84 @@
+#ifndef IPCSPECTRUM_H
+#define IPCSPECTRUM_H
+
+#include <QVector>
+#include <QPointF>
+#include <complex>
+#include "ipcfft.h"
+
+/*
+ * Spectrum front end: windows real or complex (IQ) time samples, transforms them and scales the magnitudes in dBFS or
+ * dBm. The scaling is calibrated for tones: a sine of amplitude A reads A at its frequency whatever the window. The
+ * resolution bandwidth is the equivalent noise bandwidth (ENBW) of the window. Windows are computed once per type and
+ * size, and shared.
+ */
+class IPCSpectrum
+{
+public:
+    IPCSpectrum();
+
+    enum Window { swRectangular      /// No window
+                 ,swHann             /// Hann
+                 ,swFlatTop          /// 5 terms flat top, for amplitude accuracy
+                 ,swBlackmanHarris   /// 4 terms Blackman-Harris, for dynamic range
+                 ,swKaiser           /// Kaiser, shaped by beta
+                };
+
+    enum Scale { ssDbfs     /// dB relative to the full scale amplitude
+                ,ssDbm      /// dB relative to 1 mW, samples being volts across the impedance
+               };
+
+    // Setters
+    void setSize(int size);
+    void setWindow(Window window, double kaiserBeta = 9.0);
+    void setSampleRate(double sampleRate);
+    void setCenterFrequency(double frequency){mCenterFrequency = frequency;}
+    void setScale(Scale scale){mScale = scale;}
+    void setFullScale(double amplitude){mFullScale = amplitude;}
+    void setImpedance(double ohms){mImpedance = ohms;}
+
+    // Getters
+    int size() const {return mSize;}
+    Window window() const {return mWindow;}
+    double kaiserBeta() const {return mKaiserBeta;}
+    double sampleRate() const {return mSampleRate;}
+    double centerFrequency() const {return mCenterFrequency;}
+    Scale scale() const {return mScale;}
+    double fullScale() const {return mFullScale;}
+    double impedance() const {return mImpedance;}
+    double binWidth() const;
+    double enbwBins() const;
+    double enbw() const;
+    double rbw() const {return enbw();}
+    // Window coefficients of the last transform
+    const QVector<double> &coefficients() const {return mCoefficients;}
+
+    // Spectra. Real samples give the bins from DC to Nyquist, complex samples give the bins from -fs/2 to fs/2 around
+    // the center frequency. With size 0, the size is the largest power of two not above count. The window spans the
+    // samples, missing samples are zero padded after it, extra samples are ignored.
+    QVector<QPointF> process(const double *samples, int count);
+    QVector<QPointF> process(const std::complex<double> *samples, int count);
+
+    static QVector<double> windowCoefficients(Window window, int size, double kaiserBeta = 9.0);
+
+private:
+    int transformSize(int count) const;
+    void prepare(int size, int length);
+    double toDb(double amplitude) const;
+
+    int mSize;
+    Window mWindow;
+    double mKaiserBeta;
+    double mSampleRate;
+    double mCenterFrequency;
+    Scale mScale;
+    double mFullScale;
+    double mImpedance;
+    // State for the current transform size
+    IPCFft mFft;
+    QVector<double> mCoefficients;
+    double mCoherentGain;
+    double mEnbwBins;
+};
+
+#endif // IPCSPECTRUM_H
@@ -0,0 +1,143 @@
+#include "ipcstatistics.h"
+#include <cmath>
+
+// Values added per block
+static const int BlockSize = 256;
+
+/*!
+ * \brief IPCStatistics::IPCStatistics. Constructor.
+ * \param compression Compression of the quantile sketch, see IPCQuantileSketch
+ */
+IPCStatistics::IPCStatistics(double compression) :
+    mCount(0),
+    mMean(0),
+    mM2(0),
+    mSketch(compression)
+{
+}
+
+/*!
+ * \brief IPCStatistics::add. Add a value.
+ * \param value
+ */
+void IPCStatistics::add(double value)
+{
+    if(!std::isnan(value)){
+        addBlock(&value, 1);
+    }
+}
+
+/*!
+ * \brief IPCStatistics::add. Add count values.
+ * \param values
+ * \param count
+ */
+void IPCStatistics::add(const double *values, int count)
+{
+    double block[BlockSize];
+    for(int i = 0; i < count; i += BlockSize){
+        int n = 0;
+        int end = qMin(count, i + BlockSize);
+        for(int j = i; j < end; j++){
+            if(!std::isnan(values[j])){
+                block[n++] = values[j];
+            }
+        }
+        addBlock(block, n);
+    }
+}
+
+/*!
+ * \brief IPCStatistics::add. Add the y values of count points.
+ * \param points
+ * \param count
+ */
+void IPCStatistics::add(const QPointF *points, int count)
+{
+    double block[BlockSize];
+    for(int i = 0; i < count; i += BlockSize){
+        int n = 0;
+        int end = qMin(count, i + BlockSize);
+        for(int j = i; j < end; j++){
+            if(!std::isnan(points[j].y())){
+                block[n++] = points[j].y();
+            }
+        }
+        addBlock(block, n);
+    }
+}
+
+/*!
+ * \brief IPCStatistics::addBlock. Add a block of values without NaN: its mean and squared deviations are computed in
+ * two passes, then merged into the accumulators.
+ * \param values
+ * \param count
+ */
+void IPCStatistics::addBlock(const double *values, int count)
+{
+    if(count <= 0){
+        return;
+    }
+    double sum = 0;
+    for(int i = 0; i < count; i++){
+        sum += values[i];
+    }
+    const double blockMean = sum / count;
+    double m2 = 0;
+    for(int i = 0; i < count; i++){
+        double d = values[i] - blockMean;
+        m2 += d*d;
+    }
+    const qint64 total = mCount + count;
+    const double delta = blockMean - mMean;
+    mMean += delta * count / total;
+    mM2 += m2 + delta*delta * ((double)mCount * count / total);
+    mCount = total;
+    mSketch.add(values, count);
+}
+
+/*!
+ * \brief IPCStatistics::merge. Add the values of other statistics.
+ * \param other
+ */
+void IPCStatistics::merge(const IPCStatistics &other)
+{
+    if(other.mCount == 0){
+        return;
+    }
+    const qint64 total = mCount + other.mCount;
+    const double delta = other.mMean - mMean;
+    mMean += delta * other.mCount / total;
+    mM2 += other.mM2 + delta*delta * ((double)mCount * other.mCount / total);
+    mCount = total;
+    mSketch.merge(other.mSketch);
+}
+
+/*!
+ * \brief IPCStatistics::reset. Remove all the values.
+ */
+void IPCStatistics::reset()
+{
+    mCount = 0;
+    mMean = 0;
+    mM2 = 0;
+    mSketch.reset();
+}
+
+/*!
+ * \brief IPCStatistics::variance. Return the population variance of the values.
+ * \return
+ */
+double IPCStatistics::variance() const
+{
+    return mCount > 0 ? mM2 / mCount : qQNaN();
+}
+
+/*!
+ * \brief IPCStatistics::stdDev. Return the population standard deviation of the values.
+ * \return
+ */
+double IPCStatistics::stdDev() const
+{
+    return std::sqrt(variance());
+}
@@ -0,0 +1,48 @@
+#ifndef IPCSTATISTICS_H
+#define IPCSTATISTICS_H
+
+#include <QtGlobal>
+#include <QPointF>
+#include "ipcquantilesketch.h"
+
+/*
+ * Streaming statistics of values: count, mean, standard deviation, min, max and quantiles. Mean and variance are
+ * Welford accumulators, updated by blocks (the mean and squared deviations of a block, merged with Chan's formula),
+ * which is as accurate as value by value and leaves the block loops free of divisions. Quantiles come from a t-digest.
+ * The memory is constant however many values are added, and statistics merge, e.g. the statistics of several threads.
+ */
+class IPCStatistics
+{
+public:
+    IPCStatistics(double compression = 100);
+
+    // NaN values are ignored
+    void add(double value);
+    void add(const double *values, int count);
+    // y values of points
+    void add(const QPointF *points, int count);
+    void merge(const IPCStatistics &other);
+    void reset();
+
+    // Getters. Without values, the mean, deviation, bounds and quantiles are NaN.
+    qint64 count() const {return mCount;}
+    double mean() const {return mCount > 0 ? mMean : qQNaN();}
+    double variance() const;
+    double stdDev() const;
+    double min() const {return mSketch.min();}
+    double max() const {return mSketch.max();}
+    double quantile(double q) const {return mSketch.quantile(q);}
+    double percentile(double p) const {return mSketch.quantile(p / 100);}
+    const IPCQuantileSketch &sketch() const {return mSketch;}
+
+private:
+    void addBlock(const double *values, int count);
+
+    qint64 mCount;
+    double mMean;
+    // Sum of the squared deviations from the mean
+    double mM2;
+    IPCQuantileSketch mSketch;
+};
+
+#endif // IPCSTATISTICS_H
@@ -0,0 +1,238 @@
+#include "ipcstatisticstable.h"
+#include "ipctracer.h"
+#include <cmath>
+
+// Columns before the percentiles: name, count, mean, standard deviation, min, max
+static const int PercentileColumn = 6;
+
+IPCStatisticsTable::IPCStatisticsTable(QWidget *parent) :
+    QTableWidget(1,0,parent),
+    mPrecision(2),
+    mColor(QColor(Qt::black)),
+    mFont(QFont())
+{
+    mPercentiles << 5 << 50 << 95;
+    viewSetup();
+    setupColumns();
+}
+
+/*!
+ * \brief IPCStatisticsTable::setPercentiles. Change the percentiles shown. The graph rows are filled on their next
+ * update.
+ * \param percentiles In %, in [0, 100]
+ */
+void IPCStatisticsTable::setPercentiles(const QList<double> &percentiles)
+{
+    foreach(double percentile, percentiles){
+        if(!(percentile >= 0 && percentile <= 100)){
+            qDebug() << Q_FUNC_INFO << "Percentile out of [0, 100]:" << percentile;
+            return;
+        }
+    }
+    mPercentiles = percentiles;
+    setupColumns();
+}
+
+/*!
+ * \brief IPCStatisticsTable::setColor. Set color for all the items in the table.
+ * \param color
+ */
+void IPCStatisticsTable::setColor(const QColor &color)
+{
+    mColor = color;
+    for(int i = 0; i < this->rowCount(); i++){
+        for(int j = 0; j < this->columnCount(); j++){
+            if(this->item(i, j)){
+                this->item(i, j)->setTextColor(mColor);
+            }
+        }
+    }
+}
+
+/*!
+ * \brief IPCStatisticsTable::setFont. Change the font of all items in the table. The titles are bold.
+ * \param font
+ */
+void IPCStatisticsTable::setFont(const QFont &font)
+{
+    mFont = font;
+    QFont titleFont = font;
+    titleFont.setBold(true);
+    for(int i = 0; i < this->rowCount(); i++){
+        for(int j = 0; j < this->columnCount(); j++){
+            if(this->item(i, j)){
+                this->item(i, j)->setFont((i == 0) ? titleFont : mFont);
+            }
+        }
+    }
+    resizeToContents();
+}
+
+/*!
+ * \brief IPCStatisticsTable::setGraphStatistics. Show the statistics of a graph. Values are NaN, shown as "-", until
+ * the graph has data.
+ * \param graphRow
+ * \param name
+ * \param statistics
+ * \param unit
+ */
+void IPCStatisticsTable::setGraphStatistics(int graphRow, const QString &name, const IPCStatistics &statistics,
+                                            const QString &unit)
+{
+    IPC_TRACE_SPAN("IPCStatisticsTable::setGraphStatistics");
+    if(graphRow < 0){
+        qDebug() << Q_FUNC_INFO << "index out of range.";
+        return;
+    }
+    int row = graphRow + 1;
+    if(row >= this->rowCount()){
+        this->setRowCount(row + 1);
+    }
+    QList<double> values;
+    values << statistics.mean() << statistics.stdDev() << statistics.min() << statistics.max();
+    foreach(double percentile, mPercentiles){
+        values << statistics.percentile(percentile);
+    }
+    setText(row, 0, name);
+    setText(row, 1, QString::number(statistics.count()));
+    for(int i = 0; i < values.length(); i++){
+        double value = values.at(i);
+        setText(row, i + 2, std::isnan(value) ? QString("-") : QString::number(value, 'f', mPrecision));
+    }
+    setText(row, this->columnCount() - 1, unit);
+    resizeToContents();
+}
+
+/*!
+ * \brief IPCStatisticsTable::setGraphCount. Remove the graph rows after the first count ones.
+ * \param count
+ */
+void IPCStatisticsTable::setGraphCount(int count)
+{
+    if(count < graphCount()){
+        this->setRowCount(qMax(0, count) + 1);
+        resizeToContents();
+    }
+}
+
+/*!
+ * \brief IPCStatisticsTable::setText. Set the text of a cell, creating its item on first use.
+ * \param row
+ * \param column
+ * \param text
+ */
+void IPCStatisticsTable::setText(int row, int column, const QString &text)
+{
+    QTableWidgetItem *item = this->item(row, column);
+    if(!item){
+        item = new QTableWidgetItem();
+        item->setTextColor(mColor);
+        QFont font = mFont;
+        font.setBold(row == 0);
+        item->setFont(font);
+        item->setFlags(item->flags() & ~Qt::ItemIsSelectable);
+        this->setItem(row, column, item);
+    }
+    item->setText(text);
+}
+
+/*!
+ * \brief IPCStatisticsTable::setupColumns. Set the columns and their titles for the percentiles shown.
+ */
+void IPCStatisticsTable::setupColumns()
+{
+    this->setColumnCount(PercentileColumn + mPercentiles.length() + 1);
+    QStringList titles;
+    titles << "" << "n" << "mean" << "std" << "min" << "max";
+    foreach(double percentile, mPercentiles){
+        titles << QString("p%1").arg(percentile);
+    }
+    titles << "";
+    for(int i = 0; i < titles.length(); i++){
+        setText(0, i, titles.at(i));
+    }
+    resizeToContents();
+}
+
+/*!
+ * \brief IPCStatisticsTable::viewSetup. Setup the table display, as the marker table.
+ */
+void IPCStatisticsTable::viewSetup()
+{
+    // Do not show the headers
+    this->horizontalHeader()->setVisible(false);
+    this->verticalHeader()->setVisible(false);
+    // Do not show grid
+    this->setShowGrid(false);
+    // Do not show the border
+    this->setFrameStyle(QFrame::NoFrame);
+    // Transparent background
+    this->setStyleSheet("background-color: transparent;");
+    // Stretch
+    this->setFixedSize(2, 2);
+    this->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    this->horizontalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    this->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    // Hide the scroll bar
+    this->verticalScrollBar()->setVisible(false);
+    this->horizontalScrollBar()->setVisible(false);
+}
+
+/*!
+ * \brief IPCStatisticsTable::resizeToContents. Resize columns' width to fit the contents.
+ */
+void IPCStatisticsTable::resizeToContents()
+{
+    IPC_TRACE_SPAN("IPCStatisticsTable::resizeToContents");
+    int nbCol = this->columnCount();
+    int nbRow = this->rowCount();
+    int tableWidth = 0;
+    int tableHeight = 0;
+    for(int j = 0; j < nbRow; j++){
+        int height = 0;
+        for(int i = 0; i < nbCol; i++){
+            QTableWidgetItem *item = this->item(j,i);
+            if(item){
+                height = qMax(height, QFontMetrics(item->font()).height());
+            }
+        }
+        height += this->contentsMargins().top() + this->contentsMargins().bottom();
+        this->verticalHeader()->resizeSection(j, height + 5);
+        tableHeight += this->rowHeight(j);
+    }
+    for(int i = 0; i < nbCol; i++){
+        int maxWidth = 0;
+        for(int j = 0; j < nbRow; j++){
+            QTableWidgetItem *item = this->item(j,i);
+            if(item){
+                maxWidth = qMax(maxWidth, QFontMetrics(item->font()).horizontalAdvance(item->text()));
+            }
+        }
+        // Resize the column, add padding
+        int finalWidth =  maxWidth + this->contentsMargins().left() + this->contentsMargins().right() + 12;
+        this->horizontalHeader()->resizeSection(i, finalWidth);
+        tableWidth += this->columnWidth(i);
+    }
+    this->setFixedSize(tableWidth+7, tableHeight+7);
+}
+
+/*!
+ * \brief IPCStatisticsTable::mousePressEvent. Register the clicked point, to move the table in mouseMoveEvent().
+ * \param event
+ */
+void IPCStatisticsTable::mousePressEvent(QMouseEvent *event)
+{
+    mLastMousePos = event->globalPos();
+    mOrigin = this->pos();
+}
+
+/*!
+ * \brief IPCStatisticsTable::mouseMoveEvent. Move the table around with the mouse.
+ * \param event
+ */
+void IPCStatisticsTable::mouseMoveEvent(QMouseEvent *event)
+{
+    QPoint delta = event->globalPos() - mLastMousePos;
+    this->move(mOrigin + delta);
+    QWidget::mouseMoveEvent(event);
+}
@@ -0,0 +1,61 @@
+#ifndef IPCSTATISTICSTABLE_H
+#define IPCSTATISTICSTABLE_H
+
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QScrollBar>
+#include <QMouseEvent>
+#include <QDebug>
+#include "ipcstatistics.h"
+
+/*
+ * Table of the statistics of the graphs, shown over the scope next to the marker table. The first row holds the column
+ * titles, then one row per graph: name, number of values, mean, standard deviation, min, max, the percentiles and the
+ * unit. Like the marker table, it is transparent and can be moved with the mouse.
+ */
+class IPCStatisticsTable : public QTableWidget
+{
+    Q_OBJECT
+public:
+    IPCStatisticsTable(QWidget *parent = nullptr);
+
+    // Resize to contents
+    void resizeToContents();
+    // Set the statistics of the graph shown in row graphRow, adding rows as needed
+    void setGraphStatistics(int graphRow, const QString &name, const IPCStatistics &statistics,
+                            const QString &unit = QString());
+    // Keep the first count graph rows
+    void setGraphCount(int count);
+    int graphCount() const {return this->rowCount() - 1;}
+    // Setters
+    void setPercentiles(const QList<double> &percentiles);
+    void setPrecision(int precision){mPrecision = precision;}
+    void setColor(const QColor &color);
+    void setFont(const QFont &font);
+    // Getters
+    QList<double> percentiles() const {return mPercentiles;}
+    int precision() const{return mPrecision;}
+    QColor color() const{return mColor;}
+    QFont font() const{return mFont;}
+
+protected:
+    void viewSetup();
+    void setupColumns();
+    void setText(int row, int column, const QString &text);
+    void mousePressEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
+    void mouseMoveEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
+private:
+    /* Used to move the table upon mouse move */
+    QPoint mOrigin;
+    QPoint mLastMousePos;
+    // Percentiles shown, in %
+    QList<double> mPercentiles;
+    // Value display precision
+    int mPrecision;
+    // Color
+    QColor mColor;
+    // Font
+    QFont mFont;
+};
+
+#endif // IPCSTATISTICSTABLE_H
@@ -0,0 +1,145 @@
+#include "ipctracebuffer.h"
+#include <QDebug>
+#include <QtEndian>
+#include <cstring>
+
+IPCTraceBuffer::IPCTraceBuffer(QObject *parent) :
+    QObject(parent),
+    mFrameIndex(0)
+{
+}
+
+/*!
+ * \brief IPCTraceBuffer::publish. Publish a new frame. The vector is shared, not copied: the caller's copy detaches
+ * only if it is modified afterwards, which leaves the published snapshot untouched.
+ * \param points
+ */
+void IPCTraceBuffer::publish(const QVector<QPointF> &points)
+{
+    {
+        QMutexLocker locker(&mMutex);
+        mSnapshot = points;
+        mFrameIndex++;
+    }
+    emit frameReady();
+}
+
+/*!
+ * \brief IPCTraceBuffer::publish. For C style convenience. Form a frame from x array and y array then publish it.
+ * \param x
+ * \param y
+ * \param len
+ */
+void IPCTraceBuffer::publish(const double *x, const double *y, int len)
+{
+    if(len <= 0){
+        qDebug() << Q_FUNC_INFO << "Non positive length:" << len;
+        return;
+    }
+    QVector<QPointF> points(len);
+    QPointF *dst = points.data();
+    for(int i = 0; i < len; i++){
+        dst[i].setX(x[i]);
+        dst[i].setY(y[i]);
+    }
+    publish(points);
+}
+
+/*!
+ * \brief IPCTraceBuffer::clear. Publish an empty frame.
+ */
+void IPCTraceBuffer::clear()
+{
+    publish(QVector<QPointF>());
+}
+
+/*!
+ * \brief IPCTraceBuffer::snapshot. Return the current frame. The returned vector shares its data with the buffer.
+ * \param frameIndex. If not null, receives the index of the returned frame.
+ * \return
+ */
+QVector<QPointF> IPCTraceBuffer::snapshot(quint64 *frameIndex) const
+{
+    QMutexLocker locker(&mMutex);
+    if(frameIndex){
+        *frameIndex = mFrameIndex;
+    }
+    return mSnapshot;
+}
+
+/*!
+ * \brief IPCTraceBuffer::frameIndex. Return the index of the current frame. The index is incremented for each published frame.
+ * \return
+ */
+quint64 IPCTraceBuffer::frameIndex() const
+{
+    QMutexLocker locker(&mMutex);
+    return mFrameIndex;
+}
+
+/*!
+ * \brief IPCTraceBuffer::pointCount. Return the number of points in the current frame.
+ * \return
+ */
+int IPCTraceBuffer::pointCount() const
+{
+    QMutexLocker locker(&mMutex);
+    return mSnapshot.size();
+}
+
+/*!
+ * \brief IPCTraceBuffer::fromBytes. Decode little endian float64 x,y pairs. On little endian hosts with double
+ * precision qreal, the bytes are copied straight into the points. Trailing bytes of an incomplete pair are ignored.
+ * \param bytes
+ * \return
+ */
+QVector<QPointF> IPCTraceBuffer::fromBytes(const QByteArray &bytes)
+{
+    const int count = bytes.size() / (2*sizeof(double));
+    QVector<QPointF> points(count);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if(sizeof(qreal) == sizeof(double)){
+        std::memcpy(points.data(), bytes.constData(), count*sizeof(QPointF));
+        return points;
+    }
+#endif
+    const char *src = bytes.constData();
+    QPointF *dst = points.data();
+    for(int i = 0; i < count; i++){
+        quint64 bits[2];
+        double values[2];
+        std::memcpy(bits, src + i*2*sizeof(double), 2*sizeof(double));
+        bits[0] = qFromLittleEndian(bits[0]);
+        bits[1] = qFromLittleEndian(bits[1]);
+        std::memcpy(values, bits, 2*sizeof(double));
+        dst[i] = QPointF(values[0], values[1]);
+    }
+    return points;
+}
+
+/*!
+ * \brief IPCTraceBuffer::toBytes. Encode points into little endian float64 x,y pairs.
+ * \param points
+ * \return
+ */
+QByteArray IPCTraceBuffer::toBytes(const QVector<QPointF> &points)
+{
+    const int count = points.size();
+    QByteArray data(count*2*sizeof(double), Qt::Uninitialized);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if(sizeof(qreal) == sizeof(double)){
+        std::memcpy(data.data(), points.constData(), data.size());
+        return data;
+    }
+#endif
+    char *dst = data.data();
+    for(int i = 0; i < count; i++){
+        double values[2] = {points.at(i).x(), points.at(i).y()};
+        quint64 bits[2];
+        std::memcpy(bits, values, 2*sizeof(double));
+        bits[0] = qToLittleEndian(bits[0]);
+        bits[1] = qToLittleEndian(bits[1]);
+        std::memcpy(dst + i*2*sizeof(double), bits, 2*sizeof(double));
+    }
+    return data;
+}
@@ -0,0 +1,47 @@
+#ifndef IPCTRACEBUFFER_H
+#define IPCTRACEBUFFER_H
+
+#include <QObject>
+#include <QVector>
+#include <QPointF>
+#include <QMutex>
+#include <QByteArray>
+
+/*
+ * A trace buffer holds one immutable, reference counted snapshot of a trace. Several graphs (in one or
+ * several scopes) can be attached to the same buffer: a frame published once is shared by all of them
+ * through Qt's implicit sharing, so the memory grows with the number of distinct traces, not the number of views.
+ */
+class IPCTraceBuffer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IPCTraceBuffer(QObject *parent = nullptr);
+
+    // Publish a new frame. These methods are thread safe.
+    void publish(const QVector<QPointF> &points);
+    void publish(const double *x, const double *y, int len);
+    void clear();
+
+    // Getters
+    QVector<QPointF> snapshot(quint64 *frameIndex = nullptr) const;
+    quint64 frameIndex() const;
+    int pointCount() const;
+
+    // Portable encoding of points: little endian float64 x,y pairs
+    static QByteArray toBytes(const QVector<QPointF> &points);
+    static QVector<QPointF> fromBytes(const QByteArray &bytes);
+
+signals:
+    // Emitted each time a new frame is published. Receivers living in another thread are notified through a queued connection.
+    void frameReady();
+
+private:
+    mutable QMutex mMutex;
+    // Current frame. Never modified in place, a new frame replaces the old one.
+    QVector<QPointF> mSnapshot;
+    // Incremented for each published frame
+    quint64 mFrameIndex;
+};
+
+#endif // IPCTRACEBUFFER_H
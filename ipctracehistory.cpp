@@ -0,0 +1,445 @@
+#include "ipctracehistory.h"
+#include <QtConcurrent>
+#include <QFloat16>
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+#include <cmath>
+
+// Maximum number of frames waiting for compression. Older pending frames are dropped if the encoder can't keep up.
+static const int MaxPendingFrames = 64;
+// hcDelta codes: the finite values are quantized on codes 0 to DeltaLevels-1, the last codes keep the non finite ones
+static const int DeltaLevels = 65533;
+static const int DeltaNaN = 65533;
+static const int DeltaPositiveInf = 65534;
+static const int DeltaNegativeInf = 65535;
+
+IPCTraceHistory::IPCTraceHistory(QObject *parent) :
+    QObject(parent),
+    mEncoderRunning(false),
+    mMemoryUsage(0),
+    mMemoryBudget(64*1024*1024),
+    mCompression(hcFloat16),
+    mDroppedFrames(0)
+{
+}
+
+IPCTraceHistory::~IPCTraceHistory()
+{
+    waitForDone();
+}
+
+/*!
+ * \brief IPCTraceHistory::record. Record a frame. The frame is only queued (the vector is shared, not copied), it is
+ * compressed later in a worker thread. This keeps the cost on the caller's side constant whatever the number of points.
+ * \param points
+ */
+void IPCTraceHistory::record(const QVector<QPointF> &points)
+{
+    QMutexLocker locker(&mMutex);
+    if(mPending.size() >= MaxPendingFrames){
+        mPending.removeFirst();
+        mDroppedFrames++;
+    }
+    PendingFrame pending;
+    pending.points = points;
+    pending.timestamp = QDateTime::currentMSecsSinceEpoch();
+    mPending.append(pending);
+    if(!mEncoderRunning){
+        mEncoderRunning = true;
+        mEncoder = QtConcurrent::run([this](){ encodePending(); });
+    }
+}
+
+/*!
+ * \brief IPCTraceHistory::clear. Remove all the recorded frames. Waits for the frame being encoded, if any, so that it
+ * isn't stored after the clear.
+ */
+void IPCTraceHistory::clear()
+{
+    QMutexLocker encodeLocker(&mEncodeMutex);
+    QMutexLocker locker(&mMutex);
+    mPending.clear();
+    mFrames.clear();
+    mMemoryUsage = 0;
+    mDroppedFrames = 0;
+}
+
+/*!
+ * \brief IPCTraceHistory::waitForDone. Block until all the recorded frames are compressed and stored.
+ */
+void IPCTraceHistory::waitForDone()
+{
+    mEncoder.waitForFinished();
+}
+
+/*!
+ * \brief IPCTraceHistory::setMemoryBudget. Set the maximum memory used by the stored frames. The oldest frames are
+ * dropped when the budget is exceeded.
+ * \param bytes
+ */
+void IPCTraceHistory::setMemoryBudget(qint64 bytes)
+{
+    QMutexLocker locker(&mMutex);
+    mMemoryBudget = bytes;
+    enforceBudget();
+}
+
+/*!
+ * \brief IPCTraceHistory::setCompression. Change the compression of the frames recorded from now on.
+ * \param compression
+ */
+void IPCTraceHistory::setCompression(Compression compression)
+{
+    QMutexLocker locker(&mMutex);
+    mCompression = compression;
+}
+
+/*!
+ * \brief IPCTraceHistory::compressStoredFrames. Compress the stored frames kept without compression (hcNone), and use
+ * compression for the frames recorded from now on. The x values stay shared. Return the number of bytes freed.
+ * \param compression
+ * \return
+ */
+qint64 IPCTraceHistory::compressStoredFrames(Compression compression)
+{
+    QMutexLocker locker(&mMutex);
+    mCompression = compression;
+    if(compression == hcNone){
+        return 0;
+    }
+    qint64 before = mMemoryUsage;
+    for(int i = 0; i < mFrames.size(); i++){
+        Frame &frame = mFrames[i];
+        if(frame.compression != hcNone){
+            continue;
+        }
+        Frame encoded = encode(decode(frame), frame.timestamp, compression);
+        qint64 delta = encoded.y.size() - frame.y.size();
+        frame.y = encoded.y;
+        frame.compression = compression;
+        frame.yMin = encoded.yMin;
+        frame.yStep = encoded.yStep;
+        frame.bytes += delta;
+        mMemoryUsage += delta;
+    }
+    return before - mMemoryUsage;
+}
+
+/*!
+ * \brief IPCTraceHistory::frameCount. Return the number of stored frames.
+ * \return
+ */
+int IPCTraceHistory::frameCount() const
+{
+    QMutexLocker locker(&mMutex);
+    return mFrames.size();
+}
+
+/*!
+ * \brief IPCTraceHistory::memoryUsage. Return the memory used by the stored frames, in bytes.
+ * \return
+ */
+qint64 IPCTraceHistory::memoryUsage() const
+{
+    QMutexLocker locker(&mMutex);
+    return mMemoryUsage;
+}
+
+/*!
+ * \brief IPCTraceHistory::droppedFrames. Return the number of frames dropped because the encoder couldn't keep up.
+ * \return
+ */
+int IPCTraceHistory::droppedFrames() const
+{
+    QMutexLocker locker(&mMutex);
+    return mDroppedFrames;
+}
+
+/*!
+ * \brief IPCTraceHistory::frame. Decode and return a stored frame. Index 0 is the oldest frame.
+ * \param frameIdx
+ * \return
+ */
+QVector<QPointF> IPCTraceHistory::frame(int frameIdx) const
+{
+    Frame frame;
+    {
+        QMutexLocker locker(&mMutex);
+        if((frameIdx < 0) || (frameIdx > mFrames.size()-1)){
+            qDebug() << Q_FUNC_INFO << "index out of range:" << frameIdx;
+            return QVector<QPointF>();
+        }
+        frame = mFrames.at(frameIdx);
+    }
+    // Decode out of the lock, the frame data is shared
+    return decode(frame);
+}
+
+/*!
+ * \brief IPCTraceHistory::frameTimestamp. Return the recording time of a frame, in ms since epoch.
+ * \param frameIdx
+ * \return
+ */
+qint64 IPCTraceHistory::frameTimestamp(int frameIdx) const
+{
+    QMutexLocker locker(&mMutex);
+    if((frameIdx < 0) || (frameIdx > mFrames.size()-1)){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << frameIdx;
+        return 0;
+    }
+    return mFrames.at(frameIdx).timestamp;
+}
+
+/*!
+ * \brief IPCTraceHistory::exportRange. Export the frames from firstFrameIdx to lastFrameIdx (included) into a text file.
+ * Each frame starts with a comment line giving its index and timestamp, followed by one "x y" line per point.
+ * \param firstFrameIdx
+ * \param lastFrameIdx
+ * \param fileName
+ * \return
+ */
+bool IPCTraceHistory::exportRange(int firstFrameIdx, int lastFrameIdx, const QString &fileName) const
+{
+    int count = frameCount();
+    if((firstFrameIdx < 0) || (lastFrameIdx > count-1) || (firstFrameIdx > lastFrameIdx)){
+        qDebug() << Q_FUNC_INFO << "invalid range:" << firstFrameIdx << lastFrameIdx;
+        return false;
+    }
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)){
+        qDebug() << Q_FUNC_INFO << "couldn't open" << fileName;
+        return false;
+    }
+    QTextStream out(&file);
+    out.setRealNumberPrecision(12);
+    for(int i = firstFrameIdx; i <= lastFrameIdx; i++){
+        QVector<QPointF> points = frame(i);
+        out << "# frame " << i << " " << QDateTime::fromMSecsSinceEpoch(frameTimestamp(i)).toString(Qt::ISODateWithMs) << "\n";
+        foreach(const QPointF &point, points){
+            out << point.x() << "\t" << point.y() << "\n";
+        }
+    }
+    return out.status() == QTextStream::Ok;
+}
+
+/*!
+ * \brief IPCTraceHistory::encodePending. Worker thread loop: compress the pending frames and store them.
+ */
+void IPCTraceHistory::encodePending()
+{
+    forever{
+        // Held from taking a frame to storing it, see clear()
+        QMutexLocker encodeLocker(&mEncodeMutex);
+        PendingFrame pending;
+        Compression compression;
+        QVector<double> lastX;
+        {
+            QMutexLocker locker(&mMutex);
+            if(mPending.isEmpty()){
+                mEncoderRunning = false;
+                return;
+            }
+            pending = mPending.takeFirst();
+            compression = mCompression;
+            if(!mFrames.isEmpty()){
+                lastX = mFrames.last().x;
+            }
+        }
+        Frame frame = encode(pending.points, pending.timestamp, compression);
+        // Share the x values with the previous frame if they are identical (typical of swept traces)
+        if((lastX.size() == frame.x.size()) && (lastX == frame.x)){
+            frame.bytes -= frame.x.size()*sizeof(double);
+            frame.x = lastX;
+        }
+        int count;
+        {
+            QMutexLocker locker(&mMutex);
+            mFrames.append(frame);
+            mMemoryUsage += frame.bytes;
+            enforceBudget();
+            count = mFrames.size();
+        }
+        encodeLocker.unlock();
+        emit framesRecorded(count);
+    }
+}
+
+/*!
+ * \brief IPCTraceHistory::encode. Compress one frame.
+ * \param points
+ * \param timestamp
+ * \param compression
+ * \return
+ */
+IPCTraceHistory::Frame IPCTraceHistory::encode(const QVector<QPointF> &points, qint64 timestamp, Compression compression) const
+{
+    const int n = points.size();
+    const QPointF *p = points.constData();
+    Frame frame;
+    frame.compression = compression;
+    frame.yMin = 0;
+    frame.yStep = 0;
+    frame.timestamp = timestamp;
+
+    frame.x.resize(n);
+    double *x = frame.x.data();
+    for(int i = 0; i < n; i++){
+        x[i] = p[i].x();
+    }
+
+    switch(compression){
+    case hcNone:
+    {
+        frame.y.resize(n*sizeof(double));
+        double *y = reinterpret_cast<double *>(frame.y.data());
+        for(int i = 0; i < n; i++){
+            y[i] = p[i].y();
+        }
+        break;
+    }
+    case hcFloat16:
+    {
+        QVector<float> y(n);
+        float *yPtr = y.data();
+        for(int i = 0; i < n; i++){
+            yPtr[i] = p[i].y();
+        }
+        frame.y.resize(n*sizeof(qfloat16));
+        qFloatToFloat16(reinterpret_cast<qfloat16 *>(frame.y.data()), y.constData(), n);
+        break;
+    }
+    case hcDelta:
+    {
+        // Quantize on 16 bits over the frame range
+        double yMin = 0;
+        double yMax = 0;
+        bool first = true;
+        for(int i = 0; i < n; i++){
+            double y = p[i].y();
+            if(!std::isfinite(y)){
+                continue;
+            }
+            if(first){
+                yMin = y;
+                yMax = y;
+                first = false;
+            } else{
+                yMin = qMin(yMin, y);
+                yMax = qMax(yMax, y);
+            }
+        }
+        double step = (yMax - yMin) / (DeltaLevels - 1);
+        frame.yMin = yMin;
+        frame.yStep = step;
+        // Delta encode the quantized values, zigzag + variable length integers: smooth traces use 1 or 2 bytes per point
+        frame.y.reserve(n*2);
+        int previous = 0;
+        for(int i = 0; i < n; i++){
+            double y = p[i].y();
+            int q = 0;
+            if(std::isnan(y)){
+                q = DeltaNaN;
+            } else if(std::isinf(y)){
+                q = (y > 0) ? DeltaPositiveInf : DeltaNegativeInf;
+            } else if(step > 0){
+                q = qBound(0, (int)std::lround((y - yMin) / step), DeltaLevels - 1);
+            }
+            int delta = q - previous;
+            previous = q;
+            quint32 zigzag = (quint32(delta) << 1) ^ quint32(delta >> 31);
+            while(zigzag >= 0x80){
+                frame.y.append(char((zigzag & 0x7f) | 0x80));
+                zigzag >>= 7;
+            }
+            frame.y.append(char(zigzag));
+        }
+        frame.y.squeeze();
+        break;
+    }
+    }
+    frame.bytes = sizeof(Frame) + frame.x.size()*sizeof(double) + frame.y.size();
+    return frame;
+}
+
+/*!
+ * \brief IPCTraceHistory::decode. Decompress one frame.
+ * \param frame
+ * \return
+ */
+QVector<QPointF> IPCTraceHistory::decode(const Frame &frame)
+{
+    const int n = frame.x.size();
+    QVector<QPointF> points(n);
+    QPointF *p = points.data();
+    const double *x = frame.x.constData();
+
+    switch(frame.compression){
+    case hcNone:
+    {
+        const double *y = reinterpret_cast<const double *>(frame.y.constData());
+        for(int i = 0; i < n; i++){
+            p[i] = QPointF(x[i], y[i]);
+        }
+        break;
+    }
+    case hcFloat16:
+    {
+        QVector<float> y(n);
+        qFloatFromFloat16(y.data(), reinterpret_cast<const qfloat16 *>(frame.y.constData()), n);
+        const float *yPtr = y.constData();
+        for(int i = 0; i < n; i++){
+            p[i] = QPointF(x[i], yPtr[i]);
+        }
+        break;
+    }
+    case hcDelta:
+    {
+        const uchar *data = reinterpret_cast<const uchar *>(frame.y.constData());
+        int pos = 0;
+        int q = 0;
+        for(int i = 0; i < n; i++){
+            quint32 zigzag = 0;
+            int shift = 0;
+            uchar byte;
+            do{
+                byte = data[pos++];
+                zigzag |= quint32(byte & 0x7f) << shift;
+                shift += 7;
+            } while(byte & 0x80);
+            q += int(zigzag >> 1) ^ -int(zigzag & 1);
+            double y = frame.yMin + q*frame.yStep;
+            if(q == DeltaNaN){
+                y = qQNaN();
+            } else if(q == DeltaPositiveInf){
+                y = qInf();
+            } else if(q == DeltaNegativeInf){
+                y = -qInf();
+            }
+            p[i] = QPointF(x[i], y);
+        }
+        break;
+    }
+    }
+    return points;
+}
+
+/*!
+ * \brief IPCTraceHistory::enforceBudget. Drop the oldest frames until the memory usage fits the budget. The newest frame
+ * is always kept. Must be called with the mutex locked.
+ */
+void IPCTraceHistory::enforceBudget()
+{
+    while((mMemoryUsage > mMemoryBudget) && (mFrames.size() > 1)){
+        Frame oldest = mFrames.takeFirst();
+        mMemoryUsage -= oldest.bytes;
+        // If the x values were shared with the next frame, they are now accounted to it
+        Frame &next = mFrames.first();
+        if((next.x.constData() == oldest.x.constData()) && (oldest.bytes > (qint64)(sizeof(Frame) + oldest.y.size()))){
+            qint64 xBytes = next.x.size()*sizeof(double);
+            next.bytes += xBytes;
+            mMemoryUsage += xBytes;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef IPCTRACEHISTORY_H
+#define IPCTRACEHISTORY_H
+
+#include <QObject>
+#include <QVector>
+#include <QPointF>
+#include <QList>
+#include <QByteArray>
+#include <QMutex>
+#include <QFuture>
+
+/*
+ * Ring buffer of the last frames of a graph, bounded by a memory budget. Recording only queues the (implicitly shared)
+ * frame, the compression runs in a worker thread. Frames which share the same x values store them only once.
+ */
+class IPCTraceHistory : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IPCTraceHistory(QObject *parent = nullptr);
+    virtual ~IPCTraceHistory();
+
+    enum Compression { hcNone       /// y values stored as double, lossless
+                      ,hcFloat16    /// y values stored as half precision floats
+                      ,hcDelta      /// y values quantized on 16 bits over the frame range, then delta encoded
+                     };
+    Q_ENUMS(Compression)
+
+    // Recording
+    void record(const QVector<QPointF> &points);
+    void clear();
+    void waitForDone();
+
+    // Setters
+    void setMemoryBudget(qint64 bytes);
+    void setCompression(Compression compression);
+    qint64 compressStoredFrames(Compression compression);
+
+    // Getters
+    qint64 memoryBudget() const {return mMemoryBudget;}
+    Compression compression() const {return mCompression;}
+    int frameCount() const;
+    qint64 memoryUsage() const;
+    int droppedFrames() const;
+    QVector<QPointF> frame(int frameIdx) const;
+    qint64 frameTimestamp(int frameIdx) const;
+
+    // Export
+    bool exportRange(int firstFrameIdx, int lastFrameIdx, const QString &fileName) const;
+
+signals:
+    // Emitted from the worker thread when new frames are stored
+    void framesRecorded(int frameCount);
+
+private:
+    struct Frame {
+        QVector<double> x;          // Shared with the previous frame when the x values are identical
+        QByteArray y;               // Encoded y values
+        Compression compression;
+        double yMin;                // hcDelta: value of the quantization step 0
+        double yStep;               // hcDelta: quantization step
+        qint64 timestamp;           // Recording time, ms since epoch
+        qint64 bytes;               // Memory accounted to this frame
+    };
+    struct PendingFrame {
+        QVector<QPointF> points;
+        qint64 timestamp;
+    };
+
+    void encodePending();
+    Frame encode(const QVector<QPointF> &points, qint64 timestamp, Compression compression) const;
+    static QVector<QPointF> decode(const Frame &frame);
+    void enforceBudget();
+
+    mutable QMutex mMutex;
+    // Held by the worker while it encodes a frame. Locked before mMutex.
+    QMutex mEncodeMutex;
+    // Stored frames, oldest first
+    QList<Frame> mFrames;
+    // Frames waiting for compression
+    QList<PendingFrame> mPending;
+    QFuture<void> mEncoder;
+    bool mEncoderRunning;
+    qint64 mMemoryUsage;
+    qint64 mMemoryBudget;
+    Compression mCompression;
+    int mDroppedFrames;
+};
+
+#endif // IPCTRACEHISTORY_H
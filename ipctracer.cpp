@@ -0,0 +1,201 @@
+#include "ipctracer.h"
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QList>
+#include <QVector>
+#include <QThread>
+#include <QCoreApplication>
+#include <QSaveFile>
+#include <QDebug>
+
+// Spans kept per thread, a power of two
+static const int RingCapacity = 1 << 16;
+
+QAtomicInt IPCTracer::sEnabled(0);
+
+namespace {
+struct Span {
+    const char *name;
+    qint64 start;
+    qint64 duration;
+};
+
+// Ring of one thread: only written by its thread, the count is published after each span
+struct ThreadRing {
+    Span *spans;
+    QAtomicInteger<quint64> count;
+    QAtomicInteger<quint64> cleared;
+    int id;
+    QString name;
+};
+}
+
+/*!
+ * \brief registry. Rings of all the threads that recorded a span. Rings are kept until the end of the process, so that
+ * spans of finished threads can still be exported.
+ */
+static QList<ThreadRing *> &registry()
+{
+    static QList<ThreadRing *> rings;
+    return rings;
+}
+
+static QMutex &registryMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+static thread_local ThreadRing *tRing = nullptr;
+
+/*!
+ * \brief registerThread. Create the ring of the calling thread.
+ */
+static ThreadRing *registerThread()
+{
+    ThreadRing *ring = new ThreadRing;
+    ring->spans = new Span[RingCapacity];
+    ring->count.storeRelease(0);
+    ring->cleared.storeRelease(0);
+    QThread *thread = QThread::currentThread();
+    QMutexLocker locker(&registryMutex());
+    ring->id = registry().size() + 1;
+    ring->name = thread->objectName();
+    if(ring->name.isEmpty()){
+        bool main = QCoreApplication::instance() && (QCoreApplication::instance()->thread() == thread);
+        ring->name = main ? QString("Main") : QString("Thread %1").arg(ring->id);
+    }
+    registry().append(ring);
+    tRing = ring;
+    return ring;
+}
+
+/*!
+ * \brief IPCTracer::setEnabled. Start or stop recording spans.
+ * \param enabled
+ */
+void IPCTracer::setEnabled(bool enabled)
+{
+    sEnabled.storeRelease(enabled ? 1 : 0);
+}
+
+/*!
+ * \brief IPCTracer::clear. Drop the spans recorded so far, in all threads.
+ */
+void IPCTracer::clear()
+{
+    QMutexLocker locker(&registryMutex());
+    foreach(ThreadRing *ring, registry()){
+        ring->cleared.storeRelease(ring->count.loadAcquire());
+    }
+}
+
+/*!
+ * \brief IPCTracer::now. Return the time elapsed since the first use of the tracer, in ns.
+ */
+qint64 IPCTracer::now()
+{
+    static const QElapsedTimer timer = []() {QElapsedTimer t; t.start(); return t;}();
+    return timer.nsecsElapsed();
+}
+
+/*!
+ * \brief IPCTracer::record. Record a span in the ring of the calling thread, overwriting the oldest one once full.
+ * \param name
+ * \param start
+ * \param end
+ */
+void IPCTracer::record(const char *name, qint64 start, qint64 end)
+{
+    ThreadRing *ring = tRing ? tRing : registerThread();
+    quint64 n = ring->count.loadAcquire();
+    Span &span = ring->spans[n & (RingCapacity - 1)];
+    span.name = name;
+    span.start = start;
+    span.duration = end - start;
+    ring->count.storeRelease(n + 1);
+}
+
+/*!
+ * \brief jsonString. Quote a name for json.
+ */
+static QByteArray jsonString(const QByteArray &text)
+{
+    QByteArray result("\"");
+    foreach(char c, text){
+        if(c == '"' || c == '\\'){
+            result.append('\\');
+        }
+        if(uchar(c) >= 0x20){
+            result.append(c);
+        }
+    }
+    result.append('"');
+    return result;
+}
+
+/*!
+ * \brief IPCTracer::chromeTrace. Return the spans of all threads in the Chrome trace event format: one complete ("X")
+ * event per span, times in us, and one metadata event per thread for its name.
+ */
+QByteArray IPCTracer::chromeTrace()
+{
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QList<ThreadRing *> rings;
+    {
+        QMutexLocker locker(&registryMutex());
+        rings = registry();
+    }
+    QByteArray json("{\"traceEvents\":[\n");
+    bool first = true;
+    foreach(ThreadRing *ring, rings){
+        const QByteArray tid = QByteArray::number(ring->id);
+        if(!first){
+            json.append(",\n");
+        }
+        first = false;
+        json.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid +
+                    ",\"args\":{\"name\":" + jsonString(ring->name.toUtf8()) + "}}");
+
+        // Copy the spans, then drop those the thread overwrote during the copy. The span being recorded is counted
+        // once written: the slot of span number after may be overwritten too.
+        quint64 end = ring->count.loadAcquire();
+        quint64 begin = qMax(ring->cleared.loadAcquire(), end > RingCapacity ? end - RingCapacity : 0);
+        QVector<Span> spans;
+        spans.reserve(int(end - begin));
+        for(quint64 i = begin; i < end; i++){
+            spans.append(ring->spans[i & (RingCapacity - 1)]);
+        }
+        quint64 after = ring->count.loadAcquire();
+        quint64 overwritten = after + 1 - RingCapacity;
+        int skip = (after + 1 > RingCapacity + begin) ? int(qMin<quint64>(overwritten - begin, spans.size())) : 0;
+        for(int i = skip; i < spans.size(); i++){
+            const Span &span = spans.at(i);
+            json.append(",\n{\"name\":" + jsonString(span.name) + ",\"cat\":\"ipc\",\"ph\":\"X\",\"ts\":" +
+                        QByteArray::number(span.start/1000.0, 'f', 3) + ",\"dur\":" +
+                        QByteArray::number(span.duration/1000.0, 'f', 3) + ",\"pid\":" + pid + ",\"tid\":" + tid + "}");
+        }
+    }
+    json.append("\n],\"displayTimeUnit\":\"ns\"}\n");
+    return json;
+}
+
+/*!
+ * \brief IPCTracer::exportChromeTrace. Write the spans to a Chrome trace JSON file.
+ * \param fileName
+ * \return
+ */
+bool IPCTracer::exportChromeTrace(const QString &fileName)
+{
+    QSaveFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly)){
+        qDebug() << Q_FUNC_INFO << "couldn't open" << fileName << ":" << file.errorString();
+        return false;
+    }
+    QByteArray json = chromeTrace();
+    if(file.write(json) != json.size()){
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
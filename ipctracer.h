@@ -0,0 +1,59 @@
+#ifndef IPCTRACER_H
+#define IPCTRACER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QAtomicInt>
+
+/*
+ * Lightweight tracing of the scope code paths, exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+ * Spans are recorded by IPC_TRACE_SPAN(name), compiled out unless IPC_TRACING is defined, and gated at runtime by
+ * setEnabled() (off by default): a disabled span costs one atomic load. Each thread records into its own ring of the
+ * last 65536 spans, without any lock: only the first span of a thread registers its ring, under a mutex.
+ * Exporting while threads are tracing is supported, spans overwritten during the export are dropped.
+ */
+class IPCTracer
+{
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled() {return sEnabled.loadAcquire() != 0;}
+    // Drop the spans recorded so far
+    static void clear();
+
+    // Monotonic time, in ns, shared by all threads
+    static qint64 now();
+    // Record a span of the calling thread. The name must outlive the tracer (string literal).
+    static void record(const char *name, qint64 start, qint64 end);
+
+    // Chrome trace event format, complete events with thread names
+    static QByteArray chromeTrace();
+    static bool exportChromeTrace(const QString &fileName);
+
+private:
+    static QAtomicInt sEnabled;
+};
+
+// Scoped span: records its lifetime when the tracer is enabled at construction
+class IPCTraceSpan
+{
+public:
+    explicit IPCTraceSpan(const char *name) :
+        mName(IPCTracer::isEnabled() ? name : nullptr),
+        mStart(mName ? IPCTracer::now() : 0) {}
+    ~IPCTraceSpan() {if(mName) IPCTracer::record(mName, mStart, IPCTracer::now());}
+
+private:
+    Q_DISABLE_COPY(IPCTraceSpan)
+    const char *mName;
+    qint64 mStart;
+};
+
+#define IPC_TRACE_CONCAT_(a, b) a##b
+#define IPC_TRACE_CONCAT(a, b) IPC_TRACE_CONCAT_(a, b)
+#ifdef IPC_TRACING
+#define IPC_TRACE_SPAN(name) IPCTraceSpan IPC_TRACE_CONCAT(ipcTraceSpan, __LINE__)(name)
+#else
+#define IPC_TRACE_SPAN(name)
+#endif
+
+#endif // IPCTRACER_H
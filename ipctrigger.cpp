@@ -0,0 +1,524 @@
+#include "ipctrigger.h"
+#include <QDebug>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Conditions searched by findFirst(), each with a scalar test and an SSE2 mask of two samples.
+ */
+struct Above {
+    explicit Above(double t) : threshold(t)
+#ifdef __SSE2__
+      , vThreshold(_mm_set1_pd(t))
+#endif
+    {}
+    bool test(double v) const {return v > threshold;}
+#ifdef __SSE2__
+    __m128d mask(__m128d v) const {return _mm_cmpgt_pd(v, vThreshold);}
+#endif
+    double threshold;
+#ifdef __SSE2__
+    __m128d vThreshold;
+#endif
+};
+
+struct Below {
+    explicit Below(double t) : threshold(t)
+#ifdef __SSE2__
+      , vThreshold(_mm_set1_pd(t))
+#endif
+    {}
+    bool test(double v) const {return v < threshold;}
+#ifdef __SSE2__
+    __m128d mask(__m128d v) const {return _mm_cmplt_pd(v, vThreshold);}
+#endif
+    double threshold;
+#ifdef __SSE2__
+    __m128d vThreshold;
+#endif
+};
+
+struct Inside {
+    Inside(double l, double h) : low(l), high(h)
+#ifdef __SSE2__
+      , vLow(_mm_set1_pd(l)), vHigh(_mm_set1_pd(h))
+#endif
+    {}
+    bool test(double v) const {return v >= low && v <= high;}
+#ifdef __SSE2__
+    __m128d mask(__m128d v) const {return _mm_and_pd(_mm_cmpge_pd(v, vLow), _mm_cmple_pd(v, vHigh));}
+#endif
+    double low;
+    double high;
+#ifdef __SSE2__
+    __m128d vLow;
+    __m128d vHigh;
+#endif
+};
+
+struct Outside {
+    Outside(double l, double h) : low(l), high(h)
+#ifdef __SSE2__
+      , vLow(_mm_set1_pd(l)), vHigh(_mm_set1_pd(h))
+#endif
+    {}
+    bool test(double v) const {return v < low || v > high;}
+#ifdef __SSE2__
+    __m128d mask(__m128d v) const {return _mm_or_pd(_mm_cmplt_pd(v, vLow), _mm_cmpgt_pd(v, vHigh));}
+#endif
+    double low;
+    double high;
+#ifdef __SSE2__
+    __m128d vLow;
+    __m128d vHigh;
+#endif
+};
+
+/*!
+ * \brief findFirst. Return the index of the first sample of [begin, end) meeting the condition, or end.
+ */
+template <typename Condition>
+static int findFirst(const double *x, int begin, int end, const Condition &condition)
+{
+    int i = begin;
+#ifdef __SSE2__
+    // 8 samples per iteration; the block holding the match is rescanned by the scalar loop
+    for(; i + 8 <= end; i += 8){
+        __m128d m01 = _mm_or_pd(condition.mask(_mm_loadu_pd(x + i)), condition.mask(_mm_loadu_pd(x + i + 2)));
+        __m128d m23 = _mm_or_pd(condition.mask(_mm_loadu_pd(x + i + 4)), condition.mask(_mm_loadu_pd(x + i + 6)));
+        if(_mm_movemask_pd(_mm_or_pd(m01, m23))){
+            break;
+        }
+    }
+#endif
+    for(; i < end; i++){
+        if(condition.test(x[i])){
+            return i;
+        }
+    }
+    return end;
+}
+
+/*!
+ * \brief IPCTrigger::IPCTrigger. Constructor. Rising edge on 0, auto mode, 500 samples before and after the trigger.
+ * \param parent
+ */
+IPCTrigger::IPCTrigger(QObject *parent) :
+    QObject(parent),
+    mType(ttEdge),
+    mSlope(tsRising),
+    mLevel(0.0),
+    mHysteresis(0.0),
+    mWindowLow(-1.0),
+    mWindowHigh(1.0),
+    mWindowEvent(weEnter),
+    mPulseMin(0.0),
+    mPulseMax(std::numeric_limits<double>::infinity()),
+    mMode(tmAuto),
+    mSampleRate(1.0),
+    mPreDepth(500),
+    mPostDepth(500),
+    mHoldoff(0.0),
+    mAutoTimeout(0.1)
+{
+    mTraceBuffer = new IPCTraceBuffer(this);
+    reset();
+    updateTimeAxis();
+}
+
+/*!
+ * \brief IPCTrigger::setType. Set the trigger condition type.
+ * \param type
+ */
+void IPCTrigger::setType(Type type)
+{
+    mType = type;
+    mArmState = asNone;
+}
+
+/*!
+ * \brief IPCTrigger::setSlope. Set the edge slope, or the pulse polarity.
+ * \param slope
+ */
+void IPCTrigger::setSlope(Slope slope)
+{
+    mSlope = slope;
+    mArmState = asNone;
+}
+
+/*!
+ * \brief IPCTrigger::setLevel. Set the level of the edge, level and pulse width triggers.
+ * \param level
+ */
+void IPCTrigger::setLevel(double level)
+{
+    mLevel = level;
+    mArmState = asNone;
+}
+
+/*!
+ * \brief IPCTrigger::setHysteresis. Set the distance to the level (or the window bounds) the signal must reach before
+ * the trigger is armed, so that noise around the level doesn't trigger.
+ * \param hysteresis
+ */
+void IPCTrigger::setHysteresis(double hysteresis)
+{
+    if(hysteresis < 0){
+        qDebug() << Q_FUNC_INFO << "Hysteresis can't be negative";
+        return;
+    }
+    mHysteresis = hysteresis;
+    mArmState = asNone;
+}
+
+/*!
+ * \brief IPCTrigger::setWindow. Set the bounds of the window trigger.
+ * \param low
+ * \param high
+ */
+void IPCTrigger::setWindow(double low, double high)
+{
+    if(low > high){
+        qDebug() << Q_FUNC_INFO << "Low bound above high bound";
+        return;
+    }
+    mWindowLow = low;
+    mWindowHigh = high;
+    mArmState = asNone;
+}
+
+/*!
+ * \brief IPCTrigger::setWindowEvent. Set whether the window trigger fires on entering or exiting the window.
+ * \param event
+ */
+void IPCTrigger::setWindowEvent(WindowEvent event)
+{
+    mWindowEvent = event;
+    mArmState = asNone;
+}
+
+/*!
+ * \brief IPCTrigger::setPulseWidth. Set the widths of the pulses triggering, in seconds. The trigger point is the end of
+ * the pulse.
+ * \param minSeconds 0 for pulses shorter than maxSeconds
+ * \param maxSeconds Infinity for pulses longer than minSeconds
+ */
+void IPCTrigger::setPulseWidth(double minSeconds, double maxSeconds)
+{
+    if(minSeconds < 0 || minSeconds > maxSeconds){
+        qDebug() << Q_FUNC_INFO << "Invalid pulse width range";
+        return;
+    }
+    mPulseMin = minSeconds;
+    mPulseMax = maxSeconds;
+    mArmState = asNone;
+}
+
+/*!
+ * \brief IPCTrigger::setMode. Set the acquisition mode. The trigger is re-armed.
+ * \param mode
+ */
+void IPCTrigger::setMode(Mode mode)
+{
+    mMode = mode;
+    arm();
+}
+
+/*!
+ * \brief IPCTrigger::setSampleRate. Set the sample rate of the stream, in Hz.
+ * \param sampleRate
+ */
+void IPCTrigger::setSampleRate(double sampleRate)
+{
+    if(sampleRate <= 0){
+        qDebug() << Q_FUNC_INFO << "Sample rate must be positive";
+        return;
+    }
+    mSampleRate = sampleRate;
+    updateTimeAxis();
+}
+
+/*!
+ * \brief IPCTrigger::setPreTriggerDepth. Set the number of samples captured before the trigger point.
+ * \param samples
+ */
+void IPCTrigger::setPreTriggerDepth(int samples)
+{
+    if(samples < 0){
+        qDebug() << Q_FUNC_INFO << "Depth can't be negative";
+        return;
+    }
+    mPreDepth = samples;
+    updateTimeAxis();
+}
+
+/*!
+ * \brief IPCTrigger::setPostTriggerDepth. Set the number of samples captured from the trigger point.
+ * \param samples
+ */
+void IPCTrigger::setPostTriggerDepth(int samples)
+{
+    if(samples < 0){
+        qDebug() << Q_FUNC_INFO << "Depth can't be negative";
+        return;
+    }
+    mPostDepth = samples;
+    updateTimeAxis();
+}
+
+/*!
+ * \brief IPCTrigger::setHoldoff. Set the minimum time between two triggers. The trigger is never re-armed before the
+ * post trigger samples are captured.
+ * \param seconds
+ */
+void IPCTrigger::setHoldoff(double seconds)
+{
+    mHoldoff = qMax(0.0, seconds);
+}
+
+/*!
+ * \brief IPCTrigger::setAutoTimeout. Set the time without trigger after which the auto mode captures the latest samples.
+ * \param seconds
+ */
+void IPCTrigger::setAutoTimeout(double seconds)
+{
+    mAutoTimeout = qMax(0.0, seconds);
+}
+
+/*!
+ * \brief IPCTrigger::arm. Re-arm the trigger: the search starts again from the next samples.
+ */
+void IPCTrigger::arm()
+{
+    mStopped = false;
+    mArmState = asNone;
+    mScanIndex = sampleCount();
+    mPulseStart = -1;
+    mPendingTrigger = -1;
+    mAutoReference = sampleCount();
+}
+
+/*!
+ * \brief IPCTrigger::reset. Drop the stream history and the counters, and re-arm the trigger.
+ */
+void IPCTrigger::reset()
+{
+    mBuffer.clear();
+    mBufferStart = 0;
+    mLastTriggerIndex = -1;
+    mTriggerCount = 0;
+    mForcedCount = 0;
+    arm();
+}
+
+/*!
+ * \brief IPCTrigger::updateTimeAxis. Compute the x values of a capture.
+ */
+void IPCTrigger::updateTimeAxis()
+{
+    mTimeAxis.resize(mPreDepth + mPostDepth);
+    double *x = mTimeAxis.data();
+    for(int i = 0; i < mTimeAxis.size(); i++){
+        x[i] = (i - mPreDepth) / mSampleRate;
+    }
+}
+
+/*!
+ * \brief IPCTrigger::addSamples. Feed a block of the stream. Triggers found in the block are captured as soon as their
+ * post trigger samples are available.
+ * \param samples
+ * \param count
+ */
+void IPCTrigger::addSamples(const double *samples, int count)
+{
+    if(samples == nullptr || count <= 0){
+        return;
+    }
+    int size = mBuffer.size();
+    mBuffer.resize(size + count);
+    std::copy(samples, samples + count, mBuffer.data() + size);
+    const qint64 streamEnd = sampleCount();
+    const qint64 rearmDelay = qMax<qint64>(1, qMax<qint64>(qRound64(mHoldoff * mSampleRate), mPostDepth));
+
+    forever{
+        if(mPendingTrigger >= 0){
+            if(streamEnd < mPendingTrigger + mPostDepth){
+                break;
+            }
+            qint64 triggerIndex = mPendingTrigger;
+            mPendingTrigger = -1;
+            capture(triggerIndex, false);
+        }
+        if(mStopped || mScanIndex >= streamEnd){
+            break;
+        }
+        int found;
+        if(search(int(mScanIndex - mBufferStart), mBuffer.size(), &found)){
+            mPendingTrigger = mBufferStart + found;
+            mArmState = asNone;
+            mScanIndex = mPendingTrigger + rearmDelay;
+        } else{
+            mScanIndex = streamEnd;
+        }
+    }
+
+    if(mMode == tmAuto && mPendingTrigger < 0 && streamEnd - mAutoReference >= qRound64(mAutoTimeout * mSampleRate)){
+        capture(qMax(mBufferStart, streamEnd - mPostDepth), true);
+    }
+    trimBuffer();
+}
+
+/*!
+ * \brief IPCTrigger::search. Search the trigger condition in the buffer, from the current arming state.
+ * \param begin First buffer index searched
+ * \param end Last buffer index searched, excluded
+ * \param found Buffer index of the trigger point
+ * \return true if the trigger fired
+ */
+bool IPCTrigger::search(int begin, int end, int *found)
+{
+    const double *x = mBuffer.constData();
+    const double h = mHysteresis;
+    int i = begin;
+    while(i < end){
+        int j = end;
+        switch(mType){
+        case ttEdge:
+            if(mArmState == asNone){
+                if(mSlope == tsRising){
+                    j = findFirst(x, i, end, Below(mLevel - h));
+                    mArmState = (j < end) ? asLow : asNone;
+                } else if(mSlope == tsFalling){
+                    j = findFirst(x, i, end, Above(mLevel + h));
+                    mArmState = (j < end) ? asHigh : asNone;
+                } else{
+                    j = findFirst(x, i, end, Outside(mLevel - h, mLevel + h));
+                    if(j < end){
+                        mArmState = (x[j] < mLevel) ? asLow : asHigh;
+                    }
+                }
+            } else{
+                j = (mArmState == asLow) ? findFirst(x, i, end, Above(mLevel)) : findFirst(x, i, end, Below(mLevel));
+                if(j < end){
+                    *found = j;
+                    return true;
+                }
+            }
+            break;
+        case ttLevel:
+            j = (mSlope == tsFalling) ? findFirst(x, i, end, Below(mLevel)) : findFirst(x, i, end, Above(mLevel));
+            if(j < end){
+                *found = j;
+                return true;
+            }
+            break;
+        case ttWindow:
+            // asLow: armed inside the window, asHigh: armed outside
+            if(mArmState == asNone){
+                int inside = end;
+                int outside = end;
+                if(mWindowEvent != weEnter){
+                    inside = findFirst(x, i, end, Inside(mWindowLow + h, mWindowHigh - h));
+                }
+                if(mWindowEvent != weExit){
+                    outside = findFirst(x, i, inside, Outside(mWindowLow - h, mWindowHigh + h));
+                }
+                if(outside < inside){
+                    j = outside;
+                    mArmState = asHigh;
+                } else if(inside < end){
+                    j = inside;
+                    mArmState = asLow;
+                }
+            } else{
+                j = (mArmState == asLow) ? findFirst(x, i, end, Outside(mWindowLow, mWindowHigh))
+                                         : findFirst(x, i, end, Inside(mWindowLow, mWindowHigh));
+                if(j < end){
+                    *found = j;
+                    return true;
+                }
+            }
+            break;
+        case ttPulseWidth:{
+            // asLow: armed outside a pulse, asPulse: inside a pulse started at mPulseStart
+            const bool positive = (mSlope != tsFalling);
+            if(mArmState == asNone){
+                j = positive ? findFirst(x, i, end, Below(mLevel - h)) : findFirst(x, i, end, Above(mLevel + h));
+                mArmState = (j < end) ? asLow : asNone;
+            } else if(mArmState == asLow){
+                j = positive ? findFirst(x, i, end, Above(mLevel)) : findFirst(x, i, end, Below(mLevel));
+                if(j < end){
+                    mArmState = asPulse;
+                    mPulseStart = mBufferStart + j;
+                }
+            } else{
+                j = positive ? findFirst(x, i, end, Below(mLevel - h)) : findFirst(x, i, end, Above(mLevel + h));
+                if(j < end){
+                    mArmState = asLow;
+                    double width = (mBufferStart + j - mPulseStart) / mSampleRate;
+                    if(width >= mPulseMin && width <= mPulseMax){
+                        *found = j;
+                        return true;
+                    }
+                }
+            }
+            break;
+        }
+        }
+        i = j + 1;
+    }
+    return false;
+}
+
+/*!
+ * \brief IPCTrigger::capture. Publish the samples around a trigger point. Near the start of the stream, the capture
+ * holds the samples available.
+ * \param triggerIndex Stream index of the trigger point
+ * \param forced true for a capture of the auto mode without trigger
+ */
+void IPCTrigger::capture(qint64 triggerIndex, bool forced)
+{
+    const qint64 streamEnd = sampleCount();
+    const qint64 first = qMax(triggerIndex - mPreDepth, mBufferStart);
+    const qint64 last = qMin(triggerIndex + mPostDepth, streamEnd);
+    const double *x = mTimeAxis.constData() + (first - (triggerIndex - mPreDepth));
+    const double *y = mBuffer.constData() + (first - mBufferStart);
+    mTraceBuffer->publish(x, y, int(last - first));
+
+    mLastTriggerIndex = triggerIndex;
+    if(forced){
+        mForcedCount++;
+        mAutoReference = streamEnd;
+    } else{
+        mTriggerCount++;
+        mAutoReference = triggerIndex;
+    }
+    emit triggered(triggerIndex, forced);
+    if(!forced && mMode == tmSingle){
+        mStopped = true;
+        emit stopped();
+    }
+}
+
+/*!
+ * \brief IPCTrigger::trimBuffer. Drop the samples no capture can reach anymore.
+ */
+void IPCTrigger::trimBuffer()
+{
+    const qint64 streamEnd = sampleCount();
+    qint64 keepFrom = qMin(mScanIndex, streamEnd) - mPreDepth;
+    if(mPendingTrigger >= 0){
+        keepFrom = qMin(keepFrom, mPendingTrigger - mPreDepth);
+    }
+    if(mMode == tmAuto){
+        keepFrom = qMin(keepFrom, streamEnd - mPreDepth - mPostDepth);
+    }
+    if(keepFrom > mBufferStart){
+        mBuffer.remove(0, int(keepFrom - mBufferStart));
+        mBufferStart = keepFrom;
+    }
+}
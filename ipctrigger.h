@@ -0,0 +1,143 @@
+#ifndef IPCTRIGGER_H
+#define IPCTRIGGER_H
+
+#include <QObject>
+#include <QVector>
+#include "ipctracebuffer.h"
+
+/*
+ * Triggered acquisition of a continuous sample stream. Blocks of samples are searched for the trigger condition; each
+ * trigger captures preTriggerDepth samples before the trigger point and postTriggerDepth samples from it. Captures are
+ * published to a trace buffer, to be attached to graphs, with x in seconds relative to the trigger point (kdTime markers
+ * read the time from the trigger).
+ *
+ * The search only compares samples to thresholds until the condition changes: these scans run on SSE2 vectors when
+ * available, 8 samples per iteration. The trigger is not thread safe, the stream must be fed from one thread.
+ */
+class IPCTrigger : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IPCTrigger(QObject *parent = nullptr);
+
+    enum Type { ttEdge         /// Crossing of the level, after leaving the hysteresis band on the other side
+               ,ttLevel        /// Signal above (rising slope) or below (falling slope) the level, without hysteresis
+               ,ttWindow       /// Signal entering or exiting the [low, high] window
+               ,ttPulseWidth   /// Pulse (positive for rising slope, negative for falling slope) of width in [min, max]
+              };
+    Q_ENUMS(Type)
+
+    enum Slope { tsRising      /// Rising edge, positive pulse
+                ,tsFalling     /// Falling edge, negative pulse
+                ,tsEither      /// Both edges. Level and pulse width triggers handle it as tsRising.
+               };
+    Q_ENUMS(Slope)
+
+    enum WindowEvent { weEnter     /// Signal entering the window
+                      ,weExit      /// Signal exiting the window
+                      ,weEither    /// Both
+                     };
+    Q_ENUMS(WindowEvent)
+
+    enum Mode { tmAuto     /// Trigger, or capture the latest samples when no trigger occurred for the auto timeout
+               ,tmNormal   /// Capture on each trigger
+               ,tmSingle   /// Capture on the next trigger, then stop until arm() is called
+              };
+    Q_ENUMS(Mode)
+
+    // Setters. Changing the condition re-arms the trigger.
+    void setType(Type type);
+    void setSlope(Slope slope);
+    void setLevel(double level);
+    void setHysteresis(double hysteresis);
+    void setWindow(double low, double high);
+    void setWindowEvent(WindowEvent event);
+    void setPulseWidth(double minSeconds, double maxSeconds);
+    void setMode(Mode mode);
+    void setSampleRate(double sampleRate);
+    void setPreTriggerDepth(int samples);
+    void setPostTriggerDepth(int samples);
+    void setHoldoff(double seconds);
+    void setAutoTimeout(double seconds);
+
+    // Getters
+    Type type() const {return mType;}
+    Slope slope() const {return mSlope;}
+    double level() const {return mLevel;}
+    double hysteresis() const {return mHysteresis;}
+    double windowLow() const {return mWindowLow;}
+    double windowHigh() const {return mWindowHigh;}
+    WindowEvent windowEvent() const {return mWindowEvent;}
+    Mode mode() const {return mMode;}
+    double sampleRate() const {return mSampleRate;}
+    int preTriggerDepth() const {return mPreDepth;}
+    int postTriggerDepth() const {return mPostDepth;}
+    double holdoff() const {return mHoldoff;}
+    double autoTimeout() const {return mAutoTimeout;}
+    bool isStopped() const {return mStopped;}
+    qint64 sampleCount() const {return mBufferStart + mBuffer.size();}
+    qint64 lastTriggerIndex() const {return mLastTriggerIndex;}
+    quint64 triggerCount() const {return mTriggerCount;}
+    quint64 forcedCount() const {return mForcedCount;}
+    IPCTraceBuffer *traceBuffer() const {return mTraceBuffer;}
+
+    // Streaming input
+    void addSamples(const double *samples, int count);
+
+public slots:
+    // Re-arm the trigger (required after a single capture)
+    void arm();
+    // Drop the stream history and the counters
+    void reset();
+
+signals:
+    // Emitted for each capture, once published. sampleIndex is the index of the trigger point in the stream.
+    void triggered(qint64 sampleIndex, bool forced);
+    // Emitted when a single capture completes
+    void stopped();
+
+private:
+    enum ArmState { asNone      /// Waiting for the arming condition
+                   ,asLow       /// Armed below the level (or inside the window)
+                   ,asHigh      /// Armed above the level (or outside the window)
+                   ,asPulse     /// Inside a pulse
+                  };
+    bool search(int begin, int end, int *found);
+    void capture(qint64 triggerIndex, bool forced);
+    void updateTimeAxis();
+    void trimBuffer();
+
+    Type mType;
+    Slope mSlope;
+    double mLevel;
+    double mHysteresis;
+    double mWindowLow;
+    double mWindowHigh;
+    WindowEvent mWindowEvent;
+    double mPulseMin;
+    double mPulseMax;
+    Mode mMode;
+    double mSampleRate;
+    int mPreDepth;
+    int mPostDepth;
+    double mHoldoff;
+    double mAutoTimeout;
+    // Stream history: mBuffer[0] is the sample of index mBufferStart in the stream
+    QVector<double> mBuffer;
+    qint64 mBufferStart;
+    // Search state, in stream indexes
+    ArmState mArmState;
+    qint64 mScanIndex;
+    qint64 mPulseStart;
+    qint64 mPendingTrigger;     // Trigger waiting for its post trigger samples, or -1
+    qint64 mAutoReference;      // Last capture, or arming, for the auto timeout
+    bool mStopped;
+    qint64 mLastTriggerIndex;
+    quint64 mTriggerCount;
+    quint64 mForcedCount;
+    // x values of a capture, in seconds from the trigger point
+    QVector<double> mTimeAxis;
+    IPCTraceBuffer *mTraceBuffer;
+};
+
+#endif // IPCTRIGGER_H
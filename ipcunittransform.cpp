@@ -0,0 +1,413 @@
+#include "ipcunittransform.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <QDebug>
+// The SSE2 loads and stores read a point as two doubles
+#if defined(__SSE2__) && !defined(QT_COORD_TYPE)
+#define IPC_UNIT_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * Kernels. With L the power in dBW, a dB unit u shows L + o(u) and a linear unit shows 10^((L + o(u))/k(u)), k being 10
+ * for power and 20 for amplitude.
+ */
+enum Kernel { tkIdentity    /// y
+             ,tkShift       /// y + b
+             ,tkLog         /// a*log10(y) + b
+             ,tkExp         /// 10^(a*y + b)
+             ,tkScale       /// a*y
+             ,tkSquare      /// a*y^2
+             ,tkSqrt        /// a*sqrt(y)
+            };
+
+static const double Ln10 = 2.30258509299404568402;
+static const double Log10E = 0.43429448190325182765;
+// Natural exponent range of the results, kept normal
+static const double ExpMin = -708.0;
+static const double ExpMax = 709.0;
+
+#ifdef IPC_UNIT_SSE2
+/*!
+ * \brief logPd. Natural logarithm of two doubles, Cephes' rational approximation (1 ulp). Inputs are clamped to the
+ * positive normal doubles.
+ */
+static inline __m128d logPd(__m128d x)
+{
+    x = _mm_min_pd(_mm_max_pd(x, _mm_set1_pd(DBL_MIN)), _mm_set1_pd(DBL_MAX));
+    // x = m*2^e, m in [0.5, 1)
+    const __m128i bits = _mm_castpd_si128(x);
+    const __m128i exponent = _mm_shuffle_epi32(_mm_srli_epi64(bits, 52), _MM_SHUFFLE(3, 3, 2, 0));
+    __m128d e = _mm_sub_pd(_mm_cvtepi32_pd(exponent), _mm_set1_pd(1022.0));
+    __m128d m = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, _mm_set_epi32(0x000FFFFF, -1, 0x000FFFFF, -1)),
+                                              _mm_set_epi32(0x3FE00000, 0, 0x3FE00000, 0)));
+    // m in [sqrt(1/2), sqrt(2)), minus 1
+    const __m128d small = _mm_cmplt_pd(m, _mm_set1_pd(0.70710678118654752440));
+    e = _mm_sub_pd(e, _mm_and_pd(small, _mm_set1_pd(1.0)));
+    m = _mm_sub_pd(_mm_add_pd(m, _mm_and_pd(small, m)), _mm_set1_pd(1.0));
+
+    const __m128d z = _mm_mul_pd(m, m);
+    __m128d p = _mm_set1_pd(1.01875663804580931796E-4);
+    p = _mm_add_pd(_mm_mul_pd(p, m), _mm_set1_pd(4.97494994976747001425E-1));
+    p = _mm_add_pd(_mm_mul_pd(p, m), _mm_set1_pd(4.70579119878881725854E0));
+    p = _mm_add_pd(_mm_mul_pd(p, m), _mm_set1_pd(1.44989225341610930846E1));
+    p = _mm_add_pd(_mm_mul_pd(p, m), _mm_set1_pd(1.79368678507819816313E1));
+    p = _mm_add_pd(_mm_mul_pd(p, m), _mm_set1_pd(7.70838733755885391666E0));
+    __m128d q = _mm_add_pd(m, _mm_set1_pd(1.12873587189167450590E1));
+    q = _mm_add_pd(_mm_mul_pd(q, m), _mm_set1_pd(4.52279145837532221105E1));
+    q = _mm_add_pd(_mm_mul_pd(q, m), _mm_set1_pd(8.29875266912776603211E1));
+    q = _mm_add_pd(_mm_mul_pd(q, m), _mm_set1_pd(7.11544750618563894466E1));
+    q = _mm_add_pd(_mm_mul_pd(q, m), _mm_set1_pd(2.31251620126765340583E1));
+
+    __m128d y = _mm_mul_pd(m, _mm_div_pd(_mm_mul_pd(z, p), q));
+    y = _mm_sub_pd(y, _mm_mul_pd(e, _mm_set1_pd(2.121944400546905827679E-4)));
+    y = _mm_sub_pd(y, _mm_mul_pd(z, _mm_set1_pd(0.5)));
+    return _mm_add_pd(_mm_add_pd(m, y), _mm_mul_pd(e, _mm_set1_pd(0.693359375)));
+}
+
+/*!
+ * \brief expPd. Natural exponential of two doubles, Cephes' Padé approximation (1 ulp). Inputs are clamped to
+ * [ExpMin, ExpMax].
+ */
+static inline __m128d expPd(__m128d x)
+{
+    x = _mm_min_pd(_mm_max_pd(x, _mm_set1_pd(ExpMin)), _mm_set1_pd(ExpMax));
+    // x = n*ln(2) + r, |r| <= ln(2)/2
+    const __m128i n = _mm_cvtpd_epi32(_mm_mul_pd(x, _mm_set1_pd(1.4426950408889634073599)));
+    const __m128d nd = _mm_cvtepi32_pd(n);
+    x = _mm_sub_pd(x, _mm_mul_pd(nd, _mm_set1_pd(6.93145751953125E-1)));
+    x = _mm_sub_pd(x, _mm_mul_pd(nd, _mm_set1_pd(1.42860682030941723212E-6)));
+
+    const __m128d xx = _mm_mul_pd(x, x);
+    __m128d p = _mm_set1_pd(1.26177193074810590878E-4);
+    p = _mm_add_pd(_mm_mul_pd(p, xx), _mm_set1_pd(3.02994407707441961300E-2));
+    p = _mm_add_pd(_mm_mul_pd(p, xx), _mm_set1_pd(9.99999999999999999910E-1));
+    p = _mm_mul_pd(p, x);
+    __m128d q = _mm_set1_pd(3.00198505138664455042E-6);
+    q = _mm_add_pd(_mm_mul_pd(q, xx), _mm_set1_pd(2.52448340349684104192E-3));
+    q = _mm_add_pd(_mm_mul_pd(q, xx), _mm_set1_pd(2.27265548208155028766E-1));
+    q = _mm_add_pd(_mm_mul_pd(q, xx), _mm_set1_pd(2.00000000000000000009E0));
+    x = _mm_add_pd(_mm_set1_pd(1.0), _mm_mul_pd(_mm_set1_pd(2.0), _mm_div_pd(p, _mm_sub_pd(q, p))));
+
+    // 2^n, built from its exponent bits
+    __m128i scale = _mm_unpacklo_epi32(_mm_add_epi32(n, _mm_set1_epi32(1023)), _mm_setzero_si128());
+    return _mm_mul_pd(x, _mm_castsi128_pd(_mm_slli_epi64(scale, 52)));
+}
+
+/*!
+ * \brief kernelPd. Transform two values.
+ */
+template <int K>
+static inline __m128d kernelPd(__m128d y, __m128d a, __m128d b)
+{
+    switch(K){
+    case tkShift:
+        return _mm_add_pd(y, b);
+    case tkLog:
+        // a is premultiplied by log10(e)
+        return _mm_add_pd(_mm_mul_pd(a, logPd(y)), b);
+    case tkExp:
+        // a and b are premultiplied by ln(10)
+        return expPd(_mm_add_pd(_mm_mul_pd(a, y), b));
+    case tkScale:
+        return _mm_mul_pd(a, y);
+    case tkSquare:
+        y = _mm_max_pd(y, _mm_setzero_pd());
+        return _mm_mul_pd(a, _mm_mul_pd(y, y));
+    case tkSqrt:
+        return _mm_mul_pd(a, _mm_sqrt_pd(_mm_max_pd(y, _mm_setzero_pd())));
+    default:
+        return y;
+    }
+}
+#else
+/*!
+ * \brief kernelSd. Transform one value.
+ */
+template <int K>
+static inline double kernelSd(double y, double a, double b)
+{
+    switch(K){
+    case tkShift:
+        return y + b;
+    case tkLog:
+        return a*std::log(qBound(DBL_MIN, y, DBL_MAX)) + b;
+    case tkExp:
+        return std::exp(qBound(ExpMin, a*y + b, ExpMax));
+    case tkScale:
+        return a*y;
+    case tkSquare:
+        y = qMax(y, 0.0);
+        return a*y*y;
+    case tkSqrt:
+        return a*std::sqrt(qMax(y, 0.0));
+    default:
+        return y;
+    }
+}
+#endif
+
+/*!
+ * \brief transformValue. Transform one value, through the same kernel as the points.
+ */
+template <int K>
+static double transformValue(double y, double a, double b)
+{
+#ifdef IPC_UNIT_SSE2
+    return _mm_cvtsd_f64(kernelPd<K>(_mm_set1_pd(y), _mm_set1_pd(a), _mm_set1_pd(b)));
+#else
+    return kernelSd<K>(y, a, b);
+#endif
+}
+
+/*!
+ * \brief transformPoints. Transform the y values of points, two points per iteration. out may be points.
+ */
+template <int K>
+static void transformPoints(const QPointF *points, int count, QPointF *out, double a, double b)
+{
+    int i = 0;
+#ifdef IPC_UNIT_SSE2
+    const __m128d va = _mm_set1_pd(a);
+    const __m128d vb = _mm_set1_pd(b);
+    const double *src = reinterpret_cast<const double *>(points);
+    double *dst = reinterpret_cast<double *>(out);
+    for(; i + 1 < count; i += 2){
+        const __m128d p0 = _mm_loadu_pd(src + 2*i);
+        const __m128d p1 = _mm_loadu_pd(src + 2*i + 2);
+        const __m128d y = kernelPd<K>(_mm_unpackhi_pd(p0, p1), va, vb);
+        const __m128d x = _mm_unpacklo_pd(p0, p1);
+        _mm_storeu_pd(dst + 2*i, _mm_unpacklo_pd(x, y));
+        _mm_storeu_pd(dst + 2*i + 2, _mm_unpackhi_pd(x, y));
+    }
+#endif
+    for(; i < count; i++){
+        out[i] = QPointF(points[i].x(), transformValue<K>(points[i].y(), a, b));
+    }
+}
+
+/*!
+ * \brief unitParameters. Describe a unit relative to the power in dBW: log is true for dB units, offset is o(u) and
+ * factor is k(u) (see the kernels).
+ */
+static void unitParameters(IPCUnitTransform::Unit unit, double impedance, bool *log, double *offset, double *factor)
+{
+    const double dbOhm = 10*std::log10(impedance);
+    *log = true;
+    *factor = 10;
+    switch(unit){
+    case IPCUnitTransform::utWatt:
+        *log = false;
+        *offset = 0;
+        break;
+    case IPCUnitTransform::utVolt:
+        *log = false;
+        *offset = dbOhm;
+        *factor = 20;
+        break;
+    case IPCUnitTransform::utDbm:
+        *offset = 30;
+        break;
+    case IPCUnitTransform::utDbv:
+        *offset = dbOhm;
+        break;
+    case IPCUnitTransform::utDbuv:
+        *offset = dbOhm + 120;
+        break;
+    case IPCUnitTransform::utDbw:
+    default:
+        *offset = 0;
+        break;
+    }
+}
+
+/*!
+ * \brief IPCUnitTransform::IPCUnitTransform. Constructor. Identity.
+ */
+IPCUnitTransform::IPCUnitTransform() :
+    mFrom(utNone),
+    mTo(utNone),
+    mImpedance(50),
+    mKernel(tkIdentity),
+    mA(1),
+    mB(0)
+{
+
+}
+
+/*!
+ * \brief IPCUnitTransform::IPCUnitTransform. Constructor. Transform from the stored unit to the shown unit. utNone only
+ * converts to utNone.
+ * \param from Unit of the stored values
+ * \param to Unit of the shown values
+ * \param impedance Impedance relating power and amplitude, in ohms
+ */
+IPCUnitTransform::IPCUnitTransform(Unit from, Unit to, double impedance) :
+    mFrom(from),
+    mTo(to),
+    mImpedance(impedance),
+    mKernel(tkIdentity),
+    mA(1),
+    mB(0)
+{
+    if(from == to){
+        return;
+    }
+    if((from == utNone) || (to == utNone)){
+        qDebug() << Q_FUNC_INFO << "No conversion between" << unitName(from) << "and" << unitName(to);
+        mTo = mFrom;
+        return;
+    }
+    if(!(impedance > 0)){
+        qDebug() << Q_FUNC_INFO << "Non positive impedance:" << impedance;
+        mImpedance = 50;
+    }
+    bool fromLog, toLog;
+    double fromOffset, toOffset, fromFactor, toFactor;
+    unitParameters(from, mImpedance, &fromLog, &fromOffset, &fromFactor);
+    unitParameters(to, mImpedance, &toLog, &toOffset, &toFactor);
+    const double shift = toOffset - fromOffset;
+    if(fromLog && toLog){
+        mKernel = tkShift;
+        mB = shift;
+    } else if(toLog){
+        mKernel = tkLog;
+        mA = fromFactor*Log10E;
+        mB = shift;
+    } else if(fromLog){
+        mKernel = tkExp;
+        mA = Ln10/toFactor;
+        mB = shift*Ln10/toFactor;
+    } else{
+        mA = std::pow(10.0, shift/toFactor);
+        mKernel = (fromFactor == toFactor) ? tkScale : ((fromFactor > toFactor) ? tkSquare : tkSqrt);
+    }
+}
+
+/*!
+ * \brief IPCUnitTransform::isIdentity. Return true if the values are shown as stored.
+ */
+bool IPCUnitTransform::isIdentity() const
+{
+    return mKernel == tkIdentity;
+}
+
+/*!
+ * \brief IPCUnitTransform::apply. Transform one value.
+ * \param y
+ * \return
+ */
+double IPCUnitTransform::apply(double y) const
+{
+    switch(mKernel){
+    case tkShift:
+        return transformValue<tkShift>(y, mA, mB);
+    case tkLog:
+        return transformValue<tkLog>(y, mA, mB);
+    case tkExp:
+        return transformValue<tkExp>(y, mA, mB);
+    case tkScale:
+        return transformValue<tkScale>(y, mA, mB);
+    case tkSquare:
+        return transformValue<tkSquare>(y, mA, mB);
+    case tkSqrt:
+        return transformValue<tkSqrt>(y, mA, mB);
+    default:
+        return y;
+    }
+}
+
+/*!
+ * \brief IPCUnitTransform::apply. Transform the y values of points, x values are copied. out may be points.
+ * \param points
+ * \param count
+ * \param out
+ */
+void IPCUnitTransform::apply(const QPointF *points, int count, QPointF *out) const
+{
+    switch(mKernel){
+    case tkShift:
+        transformPoints<tkShift>(points, count, out, mA, mB);
+        break;
+    case tkLog:
+        transformPoints<tkLog>(points, count, out, mA, mB);
+        break;
+    case tkExp:
+        transformPoints<tkExp>(points, count, out, mA, mB);
+        break;
+    case tkScale:
+        transformPoints<tkScale>(points, count, out, mA, mB);
+        break;
+    case tkSquare:
+        transformPoints<tkSquare>(points, count, out, mA, mB);
+        break;
+    case tkSqrt:
+        transformPoints<tkSqrt>(points, count, out, mA, mB);
+        break;
+    default:
+        if(out != points){
+            std::copy(points, points + count, out);
+        }
+        break;
+    }
+}
+
+/*!
+ * \brief IPCUnitTransform::apply. Return the points with their y values transformed. The identity shares the vector.
+ * \param points
+ * \return
+ */
+QVector<QPointF> IPCUnitTransform::apply(const QVector<QPointF> &points) const
+{
+    if(isIdentity()){
+        return points;
+    }
+    QVector<QPointF> out(points.size());
+    apply(points.constData(), points.size(), out.data());
+    return out;
+}
+
+/*!
+ * \brief IPCUnitTransform::inverted. Return the transform from the shown unit to the stored unit.
+ * \return
+ */
+IPCUnitTransform IPCUnitTransform::inverted() const
+{
+    return IPCUnitTransform(mTo, mFrom, mImpedance);
+}
+
+/*!
+ * \brief IPCUnitTransform::unitName. Return the symbol of a unit, empty for utNone.
+ * \param unit
+ * \return
+ */
+QString IPCUnitTransform::unitName(Unit unit)
+{
+    switch(unit){
+    case utWatt:
+        return QString("W");
+    case utVolt:
+        return QString("V");
+    case utDbw:
+        return QString("dBW");
+    case utDbm:
+        return QString("dBm");
+    case utDbv:
+        return QString("dBV");
+    case utDbuv:
+        return QString::fromUtf8("dB\xC2\xB5V");
+    default:
+        return QString();
+    }
+}
+
+/*!
+ * \brief IPCUnitTransform::isLogUnit. Return true for the dB units.
+ * \param unit
+ * \return
+ */
+bool IPCUnitTransform::isLogUnit(Unit unit)
+{
+    return (unit == utDbw) || (unit == utDbm) || (unit == utDbv) || (unit == utDbuv);
+}
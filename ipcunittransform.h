@@ -0,0 +1,58 @@
+#ifndef IPCUNITTRANSFORM_H
+#define IPCUNITTRANSFORM_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+#include <QPointF>
+
+/*
+ * Display transform of the y values of a graph, from the unit its data is stored in to the unit it is shown in. Power
+ * (W, dBW, dBm) and amplitude (V rms, dBV, dBµV) units convert into each other across the impedance. Any pair reduces
+ * to one kernel: a shift between dB units, a*log10(y) + b from a linear unit to a dB unit, 10^(a*y + b) from a dB unit
+ * to a linear unit, a*y^p between linear units. Linear values are magnitudes: negative values are taken as 0, and 0 as
+ * the smallest positive double in the logarithm. Every transform is then non decreasing, so min/max decimation and
+ * range tests can be done on the stored data. The kernels process two values per instruction with SSE2.
+ */
+class IPCUnitTransform
+{
+public:
+    enum Unit { utNone    /// No unit, the values are shown as stored
+               ,utWatt    /// Power, in W
+               ,utVolt    /// RMS amplitude, in V
+               ,utDbw     /// Power, in dB relative to 1 W
+               ,utDbm     /// Power, in dB relative to 1 mW
+               ,utDbv     /// Amplitude, in dB relative to 1 V
+               ,utDbuv    /// Amplitude, in dB relative to 1 µV
+              };
+
+    IPCUnitTransform();
+    IPCUnitTransform(Unit from, Unit to, double impedance = 50);
+
+    // Getters
+    Unit from() const {return mFrom;}
+    Unit to() const {return mTo;}
+    double impedance() const {return mImpedance;}
+    bool isIdentity() const;
+
+    // Transform of one value, of the y values of points (in place if out is points), of a vector
+    double apply(double y) const;
+    void apply(const QPointF *points, int count, QPointF *out) const;
+    QVector<QPointF> apply(const QVector<QPointF> &points) const;
+    // Transform from the shown unit back to the stored unit
+    IPCUnitTransform inverted() const;
+
+    static QString unitName(Unit unit);
+    static bool isLogUnit(Unit unit);
+
+private:
+    Unit mFrom;
+    Unit mTo;
+    double mImpedance;
+    // Kernel and its coefficients, see ipcunittransform.cpp
+    int mKernel;
+    double mA;
+    double mB;
+};
+
+#endif // IPCUNITTRANSFORM_H
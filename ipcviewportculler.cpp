@@ -0,0 +1,328 @@
+#include "ipcviewportculler.h"
+#include "ipcaxismapping.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+IPCViewportCuller::IPCViewportCuller() :
+    mSorted(true),
+    mLastDecimationWidth(0),
+    mGridValid(false),
+    mGridCols(0),
+    mGridRows(0)
+{
+}
+
+/*!
+ * \brief IPCViewportCuller::setSource. Set the full data of the graph. The vector is shared, not copied. Check once if
+ * the x values are monotonic, and invalidate the spatial grid.
+ * \param points
+ */
+void IPCViewportCuller::setSource(const QVector<QPointF> &points)
+{
+    mSource = points;
+    mSorted = true;
+    const QPointF *p = mSource.constData();
+    for(int i = 1; i < mSource.size(); i++){
+        // Written so that NaN values also flag the data as unsorted
+        if(!(p[i].x() >= p[i-1].x())){
+            mSorted = false;
+            break;
+        }
+    }
+    clearGrid();
+    mLastViewport = QRectF();
+}
+
+/*!
+ * \brief IPCViewportCuller::isCulled. Return true if the last call to cull() used the same viewport and decimation width.
+ * \param viewport
+ * \param decimationWidth
+ * \return
+ */
+bool IPCViewportCuller::isCulled(const QRectF &viewport, int decimationWidth) const
+{
+    return mLastViewport.isValid() && (mLastViewport == viewport) && (mLastDecimationWidth == decimationWidth);
+}
+
+/*!
+ * \brief IPCViewportCuller::cull. Return the points to render for the viewport. The source data is never modified, and
+ * is returned as is (shared) when it is entirely visible.
+ * \param viewport. Visible range in graph's coordinates.
+ * \param connected. True if the points are joined by lines (line and area graphs). Unsorted lines are not culled.
+ * \param decimationWidth. If positive, width in pixels of the plot area: connected points are decimated to a min/max per pixel column.
+ * \param xLog. True if the x axis is log scale, used for the pixel columns.
+ * \return
+ */
+QVector<QPointF> IPCViewportCuller::cull(const QRectF &viewport, bool connected, int decimationWidth, bool xLog)
+{
+    mLastViewport = viewport;
+    mLastDecimationWidth = decimationWidth;
+
+    const int n = mSource.size();
+    if((n == 0) || !viewport.isValid()){
+        return mSource;
+    }
+    const QPointF *begin = mSource.constData();
+    const QPointF *end = begin + n;
+
+    if(mSorted){
+        // Visible index range, plus one point beyond each edge
+        const QPointF *lo = std::lower_bound(begin, end, viewport.left(), [](const QPointF &p, double x){return p.x() < x;});
+        const QPointF *hi = std::upper_bound(begin, end, viewport.right(), [](double x, const QPointF &p){return x < p.x();});
+        int first = qMax(0, int(lo - begin) - 1);
+        int last = qMin(n - 1, int(hi - begin));
+        int count = last - first + 1;
+        if(connected && (decimationWidth > 0) && (count > 4*decimationWidth)){
+            return decimate(begin + first, count, viewport.left(), viewport.right(), decimationWidth, xLog);
+        }
+        if(count == n){
+            return mSource;
+        }
+        return mSource.mid(first, count);
+    }
+
+    if(connected){
+        // Removing points from unsorted lines would change the drawn segments
+        return mSource;
+    }
+
+    // Unsorted scatter: collect the points of the grid cells overlapping the viewport
+    if(!mGridValid){
+        buildGrid();
+    }
+    QVector<QPointF> result;
+    if((viewport.right() < mGridRect.left()) || (viewport.left() > mGridRect.right())
+            || (viewport.bottom() < mGridRect.top()) || (viewport.top() > mGridRect.bottom())){
+        return result;
+    }
+    double cellWidth = mGridRect.width() / mGridCols;
+    double cellHeight = mGridRect.height() / mGridRows;
+    auto column = [&](double x){ return (cellWidth > 0) ? qBound(0, int((x - mGridRect.left())/cellWidth), mGridCols-1) : 0; };
+    auto row = [&](double y){ return (cellHeight > 0) ? qBound(0, int((y - mGridRect.top())/cellHeight), mGridRows-1) : 0; };
+    int c0 = column(viewport.left());
+    int c1 = column(viewport.right());
+    int r0 = row(viewport.top());
+    int r1 = row(viewport.bottom());
+    const int *indices = mCellIndices.constData();
+    for(int r = r0; r <= r1; r++){
+        for(int c = c0; c <= c1; c++){
+            int cell = r*mGridCols + c;
+            int cellBegin = mCellStart.at(cell);
+            int cellEnd = mCellStart.at(cell+1);
+            bool border = (r == r0) || (r == r1) || (c == c0) || (c == c1);
+            for(int k = cellBegin; k < cellEnd; k++){
+                const QPointF &p = begin[indices[k]];
+                // Inner cells are entirely inside the viewport, only the border cells need a test
+                if(!border || ((p.x() >= viewport.left()) && (p.x() <= viewport.right()) && (p.y() >= viewport.top()) && (p.y() <= viewport.bottom()))){
+                    result.append(p);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+/*!
+ * \brief IPCViewportCuller::clearGrid. Drop the spatial grid. It is rebuilt on next use.
+ */
+void IPCViewportCuller::clearGrid()
+{
+    mGridValid = false;
+    mCellStart = QVector<int>();
+    mCellIndices = QVector<int>();
+}
+
+/*!
+ * \brief IPCViewportCuller::memoryUsage. Return the memory used by the spatial grid, in bytes. The source data is shared
+ * with the graph and isn't counted.
+ * \return
+ */
+qint64 IPCViewportCuller::memoryUsage() const
+{
+    return (qint64)(mCellStart.capacity() + mCellIndices.capacity())*sizeof(int);
+}
+
+/*!
+ * \brief IPCViewportCuller::buildGrid. Sort the point indices into a uniform grid covering the data, about 16 points per cell.
+ */
+void IPCViewportCuller::buildGrid()
+{
+    const int n = mSource.size();
+    const QPointF *p = mSource.constData();
+
+    // Bounding rect of the finite points
+    double xMin = std::numeric_limits<double>::max();
+    double xMax = -std::numeric_limits<double>::max();
+    double yMin = std::numeric_limits<double>::max();
+    double yMax = -std::numeric_limits<double>::max();
+    for(int i = 0; i < n; i++){
+        if(std::isfinite(p[i].x()) && std::isfinite(p[i].y())){
+            xMin = qMin(xMin, p[i].x());
+            xMax = qMax(xMax, p[i].x());
+            yMin = qMin(yMin, p[i].y());
+            yMax = qMax(yMax, p[i].y());
+        }
+    }
+    if(xMin > xMax){
+        xMin = xMax = yMin = yMax = 0;
+    }
+    mGridRect = QRectF(QPointF(xMin, yMin), QPointF(xMax, yMax));
+    int side = qBound(1, (int)std::sqrt(n/16.0), 1024);
+    mGridCols = side;
+    mGridRows = side;
+    double cellWidth = mGridRect.width() / mGridCols;
+    double cellHeight = mGridRect.height() / mGridRows;
+    auto cellOf = [&](const QPointF &point){
+        if(!std::isfinite(point.x()) || !std::isfinite(point.y())){
+            return -1;
+        }
+        int c = (cellWidth > 0) ? qBound(0, int((point.x() - xMin)/cellWidth), mGridCols-1) : 0;
+        int r = (cellHeight > 0) ? qBound(0, int((point.y() - yMin)/cellHeight), mGridRows-1) : 0;
+        return r*mGridCols + c;
+    };
+
+    // Counting sort of the indices by cell
+    mCellStart.fill(0, mGridCols*mGridRows + 1);
+    int *start = mCellStart.data();
+    for(int i = 0; i < n; i++){
+        int cell = cellOf(p[i]);
+        if(cell >= 0){
+            start[cell+1]++;
+        }
+    }
+    for(int c = 0; c < mGridCols*mGridRows; c++){
+        start[c+1] += start[c];
+    }
+    mCellIndices.resize(start[mGridCols*mGridRows]);
+    QVector<int> cursor = mCellStart;
+    int *cur = cursor.data();
+    int *indices = mCellIndices.data();
+    for(int i = 0; i < n; i++){
+        int cell = cellOf(p[i]);
+        if(cell >= 0){
+            indices[cur[cell]++] = i;
+        }
+    }
+    mGridValid = true;
+}
+
+/*!
+ * \brief decimatePoints. Min/max per pixel column decimation, for one x axis scale. The column of a point never decreases
+ * along sorted points: the end of each column is found by an exponential search, so the column is computed a few
+ * times per column instead of once per point, then the minimum and maximum of the column are searched in a plain loop.
+ * \param points
+ * \param count
+ * \param mapping
+ * \return
+ */
+template <typename XScale>
+static QVector<QPointF> decimatePoints(const QPointF *points, int count, const IPCColumnMapping<XScale> &mapping)
+{
+    QVector<QPointF> result;
+    if(!mapping.isValid()){
+        result.resize(count);
+        std::copy(points, points + count, result.begin());
+        return result;
+    }
+
+    result.reserve(4*(mapping.width() + 2));
+    auto inLaterColumn = [&](int column, const QPointF &point){return column < mapping.column(point.x());};
+    int first = 0;
+    while(first < count){
+        const int column = mapping.column(points[first].x());
+        // Exponential search of a point in a later column, then binary search of the first one
+        int low = first + 1;
+        int step = 1;
+        while((low + step < count) && !inLaterColumn(column, points[low + step])){
+            low += step;
+            step *= 2;
+        }
+        const int end = int(std::upper_bound(points + low, points + qMin(count, low + step + 1), column, inLaterColumn) - points);
+        int minIdx = first, maxIdx = first;
+        for(int i = first + 1; i < end; i++){
+            if(points[i].y() < points[minIdx].y()){
+                minIdx = i;
+            }
+            if(points[i].y() > points[maxIdx].y()){
+                maxIdx = i;
+            }
+        }
+        int idx[4] = {first, minIdx, maxIdx, end - 1};
+        std::sort(idx, idx + 4);
+        for(int k = 0; k < 4; k++){
+            if((k == 0) || (idx[k] != idx[k-1])){
+                result.append(points[idx[k]]);
+            }
+        }
+        first = end;
+    }
+    return result;
+}
+
+/*!
+ * \brief IPCViewportCuller::decimate. Reduce points sorted by x to at most 4 points per pixel column: the first, the minimum,
+ * the maximum and the last point of the column, in their original order. The drawn envelope is unchanged.
+ * Points beyond the edges of [xMin, xMax] are kept in their own column.
+ * \param points
+ * \param count
+ * \param xMin
+ * \param xMax
+ * \param width. Number of pixel columns.
+ * \param xLog. True if the pixel columns are log spaced.
+ * \return
+ */
+QVector<QPointF> IPCViewportCuller::decimate(const QPointF *points, int count, double xMin, double xMax, int width, bool xLog)
+{
+    if((count <= 0) || (width <= 0)){
+        return QVector<QPointF>();
+    }
+    if(xLog){
+        return decimatePoints(points, count, IPCColumnMapping<IPCLogScale>(xMin, xMax, width));
+    }
+    return decimatePoints(points, count, IPCColumnMapping<IPCLinearScale>(xMin, xMax, width));
+}
+
+/*!
+ * \brief IPCViewportCuller::mergeCollinear. Simplify a polyline: a point is dropped when it, and all the points dropped
+ * since the last kept one, lie between the last kept point and the next point, within the tolerance. Spikes and
+ * direction reversals are kept, so min/max decimated data keeps its envelope. Runs are bounded, which keeps the cost
+ * linear.
+ * \param points Points of the polyline, in graph's coordinates
+ * \param pixels The same points, in pixels
+ * \param tolerance Maximum distance, in pixels, between a dropped point and the drawn segment
+ * \return
+ */
+QVector<QPointF> IPCViewportCuller::mergeCollinear(const QVector<QPointF> &points, const QVector<QPointF> &pixels,
+                                                   double tolerance)
+{
+    const int maxRun = 64;
+    const int n = points.size();
+    if(n < 3 || pixels.size() != n){
+        return points;
+    }
+    QVector<QPointF> result;
+    result.reserve(n);
+    result.append(points.first());
+    const QPointF *px = pixels.constData();
+    const double tolerance2 = tolerance*tolerance;
+    int anchor = 0;
+    for(int i = 1; i < n-1; i++){
+        const QPointF d = px[i+1] - px[anchor];
+        const double length2 = d.x()*d.x() + d.y()*d.y();
+        bool drop = (length2 > 0) && (i - anchor <= maxRun);
+        for(int k = anchor+1; drop && (k <= i); k++){
+            const QPointF v = px[k] - px[anchor];
+            const double t = v.x()*d.x() + v.y()*d.y();
+            const double cross = v.x()*d.y() - v.y()*d.x();
+            // Projection inside the segment, and distance (cross/length) within the tolerance
+            drop = (t >= 0) && (t <= length2) && (cross*cross <= tolerance2*length2);
+        }
+        if(!drop){
+            result.append(points.at(i));
+            anchor = i;
+        }
+    }
+    result.append(points.last());
+    return result;
+}
@@ -0,0 +1,55 @@
+#ifndef IPCVIEWPORTCULLER_H
+#define IPCVIEWPORTCULLER_H
+
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+
+/*
+ * The culler keeps the full data of a graph and hands only the visible part to the renderer. Monotonic x data is
+ * detected once per frame and culled by binary search, keeping one point beyond each edge so that lines reach the
+ * border of the plot area. Unsorted scatter data is culled with a uniform grid built on first use.
+ * The culled points can also be decimated to a min/max per pixel column.
+ */
+class IPCViewportCuller
+{
+public:
+    IPCViewportCuller();
+
+    // Source data
+    void setSource(const QVector<QPointF> &points);
+    const QVector<QPointF> &source() const {return mSource;}
+    bool isSorted() const {return mSorted;}
+
+    // Return the points to render for a viewport given in graph's coordinates
+    QVector<QPointF> cull(const QRectF &viewport, bool connected, int decimationWidth = 0, bool xLog = false);
+    bool isCulled(const QRectF &viewport, int decimationWidth) const;
+
+    // Drop the spatial grid (rebuilt on next use)
+    void clearGrid();
+    qint64 memoryUsage() const;
+
+    // Min/max per pixel column decimation of points sorted by x
+    static QVector<QPointF> decimate(const QPointF *points, int count, double xMin, double xMax, int width, bool xLog);
+    // Drop the points of a polyline lying on the segment joining their neighbours, within a tolerance in pixels
+    static QVector<QPointF> mergeCollinear(const QVector<QPointF> &points, const QVector<QPointF> &pixels, double tolerance);
+
+private:
+    void buildGrid();
+
+    // Full data of the graph
+    QVector<QPointF> mSource;
+    bool mSorted;
+    // Last culled viewport
+    QRectF mLastViewport;
+    int mLastDecimationWidth;
+    // Uniform grid, compressed row storage: indices of the points in cell c are mCellIndices[mCellStart[c]..mCellStart[c+1]-1]
+    bool mGridValid;
+    QRectF mGridRect;
+    int mGridCols;
+    int mGridRows;
+    QVector<int> mCellStart;
+    QVector<int> mCellIndices;
+};
+
+#endif // IPCVIEWPORTCULLER_H
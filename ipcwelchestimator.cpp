@@ -0,0 +1,414 @@
+#include "ipcwelchestimator.h"
+#include <QDebug>
+#include <cmath>
+#include <algorithm>
+
+/*!
+ * \brief IPCWelchEstimator::IPCWelchEstimator. Constructor. Segments of 4096 samples, 50% overlap, Hann window, unlimited
+ * averaging, 100 bins per decade, no decimation stage.
+ */
+IPCWelchEstimator::IPCWelchEstimator() :
+    mSegmentSize(4096),
+    mOverlap(0.5),
+    mWindow(IPCSpectrum::swHann),
+    mKaiserBeta(9.0),
+    mSampleRate(1.0),
+    mAverageCount(0),
+    mBinsPerDecade(100),
+    mScale(IPCSpectrum::ssDbfs),
+    mFullScale(1.0),
+    mImpedance(50.0),
+    mSumSquares(0.0)
+{
+    mStages.append(Stage());
+    reset();
+}
+
+/*!
+ * \brief IPCWelchEstimator::decimationTaps. Return the low pass filter applied before each decimation. Its cutoff is the
+ * Nyquist frequency of the decimated stage; the band kept from a decimated stage (80% of its Nyquist frequency) is
+ * attenuated by more than 80 dB once aliased.
+ */
+const QVector<double> &IPCWelchEstimator::decimationTaps()
+{
+    static const QVector<double> taps = []() {
+        const int count = 127;
+        const int center = count / 2;
+        const double cutoff = 0.5 / DecimationFactor;
+        // A periodic window of count+1 points is symmetric around its middle point once its first point is dropped
+        QVector<double> window = IPCSpectrum::windowCoefficients(IPCSpectrum::swKaiser, count + 1, 8.0);
+        QVector<double> h(count);
+        double sum = 0.0;
+        for(int i = 0; i < count; i++){
+            double x = 2.0 * cutoff * (i - center);
+            double sinc = (i == center) ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+            h[i] = 2.0 * cutoff * sinc * window.at(i + 1);
+            sum += h[i];
+        }
+        for(int i = 0; i < count; i++){
+            h[i] /= sum;
+        }
+        return h;
+    }();
+    return taps;
+}
+
+/*!
+ * \brief IPCWelchEstimator::setSegmentSize. Set the number of samples of a segment. The bin width is sampleRate/size.
+ * \param size Power of two, at least 16
+ */
+void IPCWelchEstimator::setSegmentSize(int size)
+{
+    if(size < 16 || !IPCFft::isPowerOfTwo(size)){
+        qDebug() << Q_FUNC_INFO << "Segment size must be a power of two, at least 16";
+        return;
+    }
+    mSegmentSize = size;
+    reset();
+}
+
+/*!
+ * \brief IPCWelchEstimator::setOverlap. Set the overlap of consecutive segments.
+ * \param overlap Fraction of a segment, in [0, 0.95]
+ */
+void IPCWelchEstimator::setOverlap(double overlap)
+{
+    if(overlap < 0.0 || overlap > 0.95){
+        qDebug() << Q_FUNC_INFO << "Overlap must be in [0, 0.95]";
+        return;
+    }
+    mOverlap = overlap;
+    reset();
+}
+
+/*!
+ * \brief IPCWelchEstimator::setWindow. Set the window applied to the segments.
+ * \param window Window type
+ * \param kaiserBeta Shape of the Kaiser window, ignored by the other windows
+ */
+void IPCWelchEstimator::setWindow(IPCSpectrum::Window window, double kaiserBeta)
+{
+    mWindow = window;
+    mKaiserBeta = kaiserBeta;
+    reset();
+}
+
+/*!
+ * \brief IPCWelchEstimator::setSampleRate. Set the sample rate of the input, in Hz.
+ * \param sampleRate
+ */
+void IPCWelchEstimator::setSampleRate(double sampleRate)
+{
+    if(sampleRate <= 0){
+        qDebug() << Q_FUNC_INFO << "Sample rate must be positive";
+        return;
+    }
+    mSampleRate = sampleRate;
+    reset();
+}
+
+/*!
+ * \brief IPCWelchEstimator::setAverageCount. Set the number of segments averaged. Beyond it, the average becomes an
+ * exponential average of the same depth. 0 averages all the segments since the last reset.
+ * \param count
+ */
+void IPCWelchEstimator::setAverageCount(int count)
+{
+    mAverageCount = qMax(0, count);
+    reset();
+}
+
+/*!
+ * \brief IPCWelchEstimator::setBinsPerDecade. Set the density of the log spaced output bins.
+ * \param bins
+ */
+void IPCWelchEstimator::setBinsPerDecade(int bins)
+{
+    if(bins < 1){
+        qDebug() << Q_FUNC_INFO << "At least one bin per decade";
+        return;
+    }
+    mBinsPerDecade = bins;
+}
+
+/*!
+ * \brief IPCWelchEstimator::setDecimationStages. Set the number of decimation stages. Each stage lowers the bin width by
+ * DecimationFactor.
+ * \param stages
+ */
+void IPCWelchEstimator::setDecimationStages(int stages)
+{
+    if(stages < 0){
+        qDebug() << Q_FUNC_INFO << "Stage count can't be negative";
+        return;
+    }
+    while(mStages.size() > stages + 1){
+        mStages.removeLast();
+    }
+    while(mStages.size() < stages + 1){
+        mStages.append(Stage());
+    }
+    reset();
+}
+
+/*!
+ * \brief IPCWelchEstimator::reset. Drop the pending samples and the averaged segments.
+ */
+void IPCWelchEstimator::reset()
+{
+    mFft.setSize(mSegmentSize);
+    mCoefficients = IPCSpectrum::windowCoefficients(mWindow, mSegmentSize, mKaiserBeta);
+    mSumSquares = 0.0;
+    foreach(double w, mCoefficients){
+        mSumSquares += w * w;
+    }
+    double sampleRate = mSampleRate;
+    for(int i = 0; i < mStages.size(); i++){
+        Stage &stage = mStages[i];
+        stage.sampleRate = sampleRate;
+        stage.pending.clear();
+        stage.filter = QVector<double>(decimationTaps().size() - 1, 0.0);
+        stage.filterPhase = 0;
+        stage.power.clear();
+        stage.segmentCount = 0;
+        sampleRate /= DecimationFactor;
+    }
+}
+
+/*!
+ * \brief IPCWelchEstimator::segmentCount. Return the number of segments averaged by a stage.
+ * \param stage Stage index, 0 being the full rate
+ */
+int IPCWelchEstimator::segmentCount(int stage) const
+{
+    if(stage < 0 || stage >= mStages.size()){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << stage;
+        return 0;
+    }
+    return mStages.at(stage).segmentCount;
+}
+
+/*!
+ * \brief IPCWelchEstimator::enbw. Return the equivalent noise bandwidth of a stage, in Hz.
+ * \param stage Stage index, 0 being the full rate
+ */
+double IPCWelchEstimator::enbw(int stage) const
+{
+    if(stage < 0 || stage >= mStages.size()){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << stage;
+        return 0.0;
+    }
+    double sum = 0.0;
+    foreach(double w, mCoefficients){
+        sum += w;
+    }
+    if(sum <= 0){
+        return 0.0;
+    }
+    return mSumSquares / (sum * sum) * mStages.at(stage).sampleRate;
+}
+
+/*!
+ * \brief IPCWelchEstimator::addSamples. Feed samples. Each completed segment is transformed and averaged, the samples
+ * are decimated for the next stages.
+ * \param samples
+ * \param count
+ */
+void IPCWelchEstimator::addSamples(const double *samples, int count)
+{
+    if(samples == nullptr || count <= 0){
+        return;
+    }
+    QVector<double> input;
+    QVector<double> decimated;
+    const double *data = samples;
+    int n = count;
+    for(int i = 0; i < mStages.size() && n > 0; i++){
+        Stage &stage = mStages[i];
+        decimated.clear();
+        if(i + 1 < mStages.size()){
+            decimate(stage, data, n, decimated);
+        }
+        int pendingSize = stage.pending.size();
+        stage.pending.resize(pendingSize + n);
+        std::copy(data, data + n, stage.pending.data() + pendingSize);
+        while(stage.pending.size() >= mSegmentSize){
+            processSegment(stage);
+        }
+        input.swap(decimated);
+        data = input.constData();
+        n = input.size();
+    }
+}
+
+/*!
+ * \brief IPCWelchEstimator::decimate. Low pass filter and decimate samples, keeping the filter state between calls.
+ * \param stage Stage the samples are fed to
+ * \param samples
+ * \param count
+ * \param out Decimated samples, for the next stage
+ */
+void IPCWelchEstimator::decimate(Stage &stage, const double *samples, int count, QVector<double> &out) const
+{
+    const QVector<double> &taps = decimationTaps();
+    const int tapCount = taps.size();
+    const double *h = taps.constData();
+    QVector<double> buffer(stage.filter.size() + count);
+    std::copy(stage.filter.constBegin(), stage.filter.constEnd(), buffer.begin());
+    std::copy(samples, samples + count, buffer.begin() + stage.filter.size());
+    const double *x = buffer.constData();
+    const int size = buffer.size();
+
+    out.reserve(count / DecimationFactor + 1);
+    int i = tapCount - 1 + stage.filterPhase;
+    for(; i < size; i += DecimationFactor){
+        const double *p = x + i;
+        double sum = 0.0;
+        for(int j = 0; j < tapCount; j++){
+            sum += h[j] * p[-j];
+        }
+        out.append(sum);
+    }
+    stage.filterPhase = i - size;
+    std::copy(buffer.constEnd() - (tapCount - 1), buffer.constEnd(), stage.filter.begin());
+}
+
+/*!
+ * \brief IPCWelchEstimator::processSegment. Transform the first segment of pending samples, average its periodogram
+ * and move to the next segment.
+ * \param stage
+ */
+void IPCWelchEstimator::processSegment(Stage &stage)
+{
+    QVector<double> windowed(mSegmentSize);
+    const double *x = stage.pending.constData();
+    const double *w = mCoefficients.constData();
+    double *dst = windowed.data();
+    for(int i = 0; i < mSegmentSize; i++){
+        dst[i] = x[i] * w[i];
+    }
+    QVector<std::complex<double> > bins = mFft.transformReal(dst);
+    const int binCount = bins.size();
+
+    if(stage.power.size() != binCount){
+        stage.power = QVector<double>(binCount, 0.0);
+        stage.segmentCount = 0;
+    }
+    stage.segmentCount++;
+    int depth = (mAverageCount > 0) ? qMin(stage.segmentCount, mAverageCount) : stage.segmentCount;
+    const double weight = 1.0 / depth;
+    double *power = stage.power.data();
+    for(int k = 0; k < binCount; k++){
+        power[k] += (std::norm(bins.at(k)) - power[k]) * weight;
+    }
+
+    int hop = qMax(1, qRound(mSegmentSize * (1.0 - mOverlap)));
+    stage.pending.remove(0, hop);
+}
+
+/*!
+ * \brief IPCWelchEstimator::toDensityDb. Convert an averaged |X|^2 to a one sided density in the current scale.
+ * \param power Averaged |X|^2
+ * \param sampleRate Sample rate of the stage
+ * \param bin Bin index, DC and Nyquist are not folded
+ */
+double IPCWelchEstimator::toDensityDb(double power, double sampleRate, int bin) const
+{
+    double fold = (bin == 0 || bin == mSegmentSize / 2) ? 1.0 : 2.0;
+    double density = fold * power / (sampleRate * mSumSquares);
+    const double floor = 1e-30;
+    if(mScale == IPCSpectrum::ssDbm){
+        return 10.0 * std::log10(qMax(density / mImpedance / 1e-3, floor));
+    }
+    return 10.0 * std::log10(qMax(density / (mFullScale * mFullScale / 2.0), floor));
+}
+
+/*!
+ * \brief IPCWelchEstimator::stageRange. Return the frequency band a stage contributes to psd(): from the band of the
+ * next stage (if it has data) up to 80% of its Nyquist frequency (the full band for stage 0).
+ * \param stageIdx
+ * \param low Lowest frequency, included
+ * \param high Highest frequency, excluded except for stage 0
+ */
+void IPCWelchEstimator::stageRange(int stageIdx, double *low, double *high) const
+{
+    const Stage &stage = mStages.at(stageIdx);
+    *high = (stageIdx == 0) ? stage.sampleRate / 2.0 : 0.8 * stage.sampleRate / 2.0;
+    if(stageIdx + 1 < mStages.size() && mStages.at(stageIdx + 1).segmentCount > 0){
+        *low = 0.8 * mStages.at(stageIdx + 1).sampleRate / 2.0;
+    } else{
+        // DC has no place on a log axis
+        *low = stage.sampleRate / mSegmentSize;
+    }
+}
+
+/*!
+ * \brief IPCWelchEstimator::linearPsd. Return the density of all the bins of a stage, from DC to its Nyquist frequency.
+ * \param stage Stage index, 0 being the full rate
+ */
+QVector<QPointF> IPCWelchEstimator::linearPsd(int stage) const
+{
+    if(stage < 0 || stage >= mStages.size()){
+        qDebug() << Q_FUNC_INFO << "index out of range:" << stage;
+        return QVector<QPointF>();
+    }
+    const Stage &s = mStages.at(stage);
+    const int binCount = s.power.size();
+    const double df = s.sampleRate / mSegmentSize;
+    QVector<QPointF> points(binCount);
+    for(int k = 0; k < binCount; k++){
+        points[k] = QPointF(k * df, toDensityDb(s.power.at(k), s.sampleRate, k));
+    }
+    return points;
+}
+
+/*!
+ * \brief IPCWelchEstimator::psd. Return the log rebinned density over all the stages, sorted by frequency. The bins of
+ * a log bin are averaged in power at their mean frequency; a bin alone in its log bin is returned as is.
+ */
+QVector<QPointF> IPCWelchEstimator::psd() const
+{
+    QVector<QPointF> points;
+    int currentBin = 0;
+    double sumFrequency = 0.0;
+    double sumDensity = 0.0;
+    int merged = 0;
+    // Density in dB is averaged through its linear value
+    auto flush = [&]() {
+        if(merged > 0){
+            points.append(QPointF(sumFrequency / merged, 10.0 * std::log10(sumDensity / merged)));
+        }
+        sumFrequency = 0.0;
+        sumDensity = 0.0;
+        merged = 0;
+    };
+
+    // Lowest frequencies first, from the last stage
+    for(int i = mStages.size() - 1; i >= 0; i--){
+        const Stage &stage = mStages.at(i);
+        if(stage.segmentCount == 0){
+            continue;
+        }
+        double low, high;
+        stageRange(i, &low, &high);
+        const double df = stage.sampleRate / mSegmentSize;
+        const int binCount = stage.power.size();
+        int first = qMax(1, (int)std::ceil(low / df - 1e-9));
+        for(int k = first; k < binCount; k++){
+            double f = k * df;
+            if(f > high || (i > 0 && f >= high)){
+                break;
+            }
+            int logBin = (int)std::floor(std::log10(f) * mBinsPerDecade);
+            if(merged > 0 && logBin != currentBin){
+                flush();
+            }
+            currentBin = logBin;
+            sumFrequency += f;
+            sumDensity += std::pow(10.0, toDensityDb(stage.power.at(k), stage.sampleRate, k) / 10.0);
+            merged++;
+        }
+    }
+    flush();
+    return points;
+}
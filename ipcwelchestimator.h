@@ -0,0 +1,88 @@
+#ifndef IPCWELCHESTIMATOR_H
+#define IPCWELCHESTIMATOR_H
+
+#include <QVector>
+#include <QList>
+#include <QPointF>
+#include "ipcfft.h"
+#include "ipcspectrum.h"
+
+/*
+ * Streaming Welch power spectral density estimator. Samples are cut in overlapping windowed segments whose periodograms
+ * are averaged. The output is rebinned on log spaced bins: linear bins falling in the same log bin are merged, so the
+ * point count stays bounded over many decades while the low offsets, where bins are sparse, keep their full resolution.
+ * Optional decimation stages (each a low pass filter followed by a decimation by DecimationFactor) extend the estimate
+ * towards low frequencies with the same segment size, and average many more segments there than one long transform would.
+ */
+class IPCWelchEstimator
+{
+public:
+    IPCWelchEstimator();
+
+    // Setters. Changing a setting other than the output scale resets the estimate.
+    void setSegmentSize(int size);
+    void setOverlap(double overlap);
+    void setWindow(IPCSpectrum::Window window, double kaiserBeta = 9.0);
+    void setSampleRate(double sampleRate);
+    void setAverageCount(int count);
+    void setBinsPerDecade(int bins);
+    void setDecimationStages(int stages);
+    void setScale(IPCSpectrum::Scale scale){mScale = scale;}
+    void setFullScale(double amplitude){mFullScale = amplitude;}
+    void setImpedance(double ohms){mImpedance = ohms;}
+
+    // Getters
+    int segmentSize() const {return mSegmentSize;}
+    double overlap() const {return mOverlap;}
+    IPCSpectrum::Window window() const {return mWindow;}
+    double sampleRate() const {return mSampleRate;}
+    int averageCount() const {return mAverageCount;}
+    int binsPerDecade() const {return mBinsPerDecade;}
+    int decimationStages() const {return mStages.size() - 1;}
+    IPCSpectrum::Scale scale() const {return mScale;}
+    int segmentCount(int stage = 0) const;
+    double enbw(int stage = 0) const;
+
+    // Streaming input
+    void addSamples(const double *samples, int count);
+    void reset();
+
+    // Density in dBFS/Hz (0 dBFS being a full scale sine) or dBm/Hz. psd() is log rebinned and spans all the stages,
+    // linearPsd() gives the raw bins of one stage.
+    QVector<QPointF> psd() const;
+    QVector<QPointF> linearPsd(int stage = 0) const;
+
+    static const int DecimationFactor = 4;
+
+private:
+    struct Stage {
+        double sampleRate;
+        QVector<double> pending;    // Samples not consumed by a segment yet
+        QVector<double> filter;     // Last inputs of the decimation filter feeding the next stage
+        int filterPhase;            // Input samples to skip before the next decimated output
+        QVector<double> power;      // Averaged |X|^2 of the segments
+        int segmentCount;
+    };
+    void processSegment(Stage &stage);
+    void decimate(Stage &stage, const double *samples, int count, QVector<double> &out) const;
+    double toDensityDb(double power, double sampleRate, int bin) const;
+    void stageRange(int stageIdx, double *low, double *high) const;
+    static const QVector<double> &decimationTaps();
+
+    int mSegmentSize;
+    double mOverlap;
+    IPCSpectrum::Window mWindow;
+    double mKaiserBeta;
+    double mSampleRate;
+    int mAverageCount;
+    int mBinsPerDecade;
+    IPCSpectrum::Scale mScale;
+    double mFullScale;
+    double mImpedance;
+    IPCFft mFft;
+    QVector<double> mCoefficients;
+    double mSumSquares;
+    QList<Stage> mStages;
+};
+
+#endif // IPCWELCHESTIMATOR_H